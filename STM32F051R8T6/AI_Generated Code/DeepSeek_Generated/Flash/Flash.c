@@ -1,4 +1,4 @@
-#include "flash.h"
+#include "Flash.h"
 
 /**
   * @brief  Set Flash latency (wait states)
@@ -59,7 +59,7 @@ FLASH_Status_t FLASH_GetStatus(void)
   */
 FLASH_Status_t FLASH_ErasePage(uint32_t page_address)
 {
-    FLASH_Status_t status = FLASH_GET_STATUS();
+    FLASH_Status_t status = FLASH_GetStatus();
     
     if(status == FLASH_STATUS_READY) {
         /* Unlock Flash */
@@ -81,7 +81,7 @@ FLASH_Status_t FLASH_ErasePage(uint32_t page_address)
             FLASH_CLEAR_EOP();
             status = FLASH_STATUS_READY;
         } else {
-            status = FLASH_GET_STATUS();
+            status = FLASH_GetStatus();
         }
         
         /* Lock Flash */
@@ -99,7 +99,7 @@ FLASH_Status_t FLASH_ErasePage(uint32_t page_address)
   */
 FLASH_Status_t FLASH_ProgramHalfWord(uint32_t address, uint16_t data)
 {
-    FLASH_Status_t status = FLASH_GET_STATUS();
+    FLASH_Status_t status = FLASH_GetStatus();
     
     if(status == FLASH_STATUS_READY) {
         /* Unlock Flash */
@@ -109,7 +109,7 @@ FLASH_Status_t FLASH_ProgramHalfWord(uint32_t address, uint16_t data)
         SET_BIT(FLASH->CR, FLASH_CR_PG);
         
         /* Program the half-word */
-        *(__IO uint16_t*)address = data;
+        *(__IO uint16_t*)(uintptr_t)address = data;
         
         /* Wait for completion */
         FLASH_WAIT_FOR_BUSY();
@@ -120,7 +120,7 @@ FLASH_Status_t FLASH_ProgramHalfWord(uint32_t address, uint16_t data)
             FLASH_CLEAR_EOP();
             status = FLASH_STATUS_READY;
         } else {
-            status = FLASH_GET_STATUS();
+            status = FLASH_GetStatus();
         }
         
         /* Lock Flash */
@@ -130,6 +130,93 @@ FLASH_Status_t FLASH_ProgramHalfWord(uint32_t address, uint16_t data)
     return status;
 }
 
+/**
+  * @brief  Program one half-word with PG already set, then read it back
+  * @param  address: Destination address (must be half-word aligned)
+  * @param  data: 16-bit data to program
+  * @retval FLASH_Status_t: Operation status
+  */
+static FLASH_Status_t FLASH_StreamHalfWord(uint32_t address, uint16_t data)
+{
+    __IO uint16_t *dst = (__IO uint16_t*)(uintptr_t)address;
+    uint32_t sr;
+
+    *dst = data;
+    do {
+        sr = FLASH->SR;
+    } while(sr & FLASH_SR_BSY);
+
+    if(sr & FLASH_SR_WRPRTERR) {
+        return FLASH_STATUS_WRITE_PROTECT_ERROR;
+    }
+    if((sr & FLASH_SR_PGERR) || *dst != data) {
+        return FLASH_STATUS_PROGRAM_ERROR;
+    }
+    return FLASH_STATUS_READY;
+}
+
+/**
+  * @brief  Program a buffer to Flash in a single unlock/PG session
+  * @note   Flash is unlocked once and PG stays set for the whole buffer; each
+  *         half-word is polled on BSY and verified by read-back. An odd start
+  *         address or length is padded with 0xFF in the other byte, so the
+  *         half-word holding a head or tail byte must still be erased.
+  * @param  address: Destination address (any alignment)
+  * @param  data: Source buffer (any alignment)
+  * @param  length: Number of bytes to program
+  * @param  fail_address: If not NULL, receives the first byte address that
+  *         failed to program or verify (left untouched on success)
+  * @retval FLASH_Status_t: Operation status
+  */
+FLASH_Status_t FLASH_ProgramBuffer(uint32_t address, const uint8_t *data, uint32_t length, uint32_t *fail_address)
+{
+    FLASH_Status_t status = FLASH_STATUS_READY;
+    uint32_t end = address + length;
+    uint32_t at = address;
+
+    if(length == 0) {
+        return status;
+    }
+
+    FLASH_WAIT_FOR_BUSY();
+    FLASH_CLEAR_ERRORS();
+    FLASH_UNLOCK();
+    SET_BIT(FLASH->CR, FLASH_CR_PG);
+
+    /* Unaligned head byte goes in the upper half of the previous half-word */
+    if(at & 1U) {
+        status = FLASH_StreamHalfWord(at - 1U, (uint16_t)(0x00FFU | ((uint16_t)data[0] << 8)));
+        if(status == FLASH_STATUS_READY) {
+            at++;
+            data++;
+        }
+    }
+
+    /* Aligned body, assembled byte-wise so the source may be unaligned */
+    while(status == FLASH_STATUS_READY && end - at >= 2U) {
+        status = FLASH_StreamHalfWord(at, (uint16_t)(data[0] | ((uint16_t)data[1] << 8)));
+        if(status == FLASH_STATUS_READY) {
+            at += 2U;
+            data += 2U;
+        }
+    }
+
+    /* Unaligned tail byte goes in the lower half */
+    if(status == FLASH_STATUS_READY && at < end) {
+        status = FLASH_StreamHalfWord(at, (uint16_t)(0xFF00U | data[0]));
+    }
+
+    CLEAR_BIT(FLASH->CR, FLASH_CR_PG);
+    FLASH_CLEAR_EOP();
+    FLASH_CLEAR_ERRORS();
+    FLASH_LOCK();
+
+    if(status != FLASH_STATUS_READY && fail_address != 0) {
+        *fail_address = at;
+    }
+    return status;
+}
+
 /**
   * @brief  Configure Flash for specific system clock frequency
   * @param  sysclk_frequency: System clock frequency in Hz
@@ -12,8 +12,12 @@
 #define     __O     volatile             /*!< Defines 'write only' permissions */
 #define     __IO    volatile             /*!< Defines 'read/write' permissions */
 
-/* Flash Base Address */
+/* Flash Base Address (HOST_SIM builds use a simulated register block) */
+#ifdef HOST_SIM
+#include "sim_regs.h"
+#else
 #define FLASH_BASE        0x40022000UL
+#endif
 
 /* Flash Register Structure Definition */
 typedef struct {
@@ -272,6 +276,7 @@ FLASH_Status_t FLASH_ErasePage(uint32_t page_address);
 FLASH_Status_t FLASH_MassErase(void);
 FLASH_Status_t FLASH_ProgramHalfWord(uint32_t address, uint16_t data);
 FLASH_Status_t FLASH_ProgramWord(uint32_t address, uint32_t data);
+FLASH_Status_t FLASH_ProgramBuffer(uint32_t address, const uint8_t *data, uint32_t length, uint32_t *fail_address);
 
 /* Option byte operations */
 FLASH_Status_t FLASH_ProgramOptionByte(uint32_t address, uint16_t data);
@@ -93,6 +93,11 @@ void Example_Button_Read(void) {
  *============================================================================*/
 volatile uint8_t Interrupt_Count = 0;
 
+static void Button_Edge(uint32_t Line) {
+    (void)Line;
+    Interrupt_Count++;
+}
+
 void Example_EXTI_Interrupt(void) {
     GPIO_InitTypeDef GPIO_InitStruct = {0};
     
@@ -121,6 +126,7 @@ void Example_EXTI_Interrupt(void) {
     EXTI_RTSR |= EXTI_LINE_0;     /* Enable rising edge trigger */
     EXTI_FTSR &= ~EXTI_LINE_0;    /* Disable falling edge trigger */
     EXTI_PR = EXTI_LINE_0;        /* Clear pending bit */
+    EXTI_RegisterCallback(0, Button_Edge);
     
     /* Configure NVIC for EXTI0_1 IRQ */
     NVIC_EnableIRQ(EXTI0_1_IRQn);
@@ -287,46 +293,94 @@ void Example_Port_Operations(void) {
 }
 
 /*============================================================================
- * EXTI0_1 Interrupt Handler
+ * Example 8: EXTI Dispatcher Benchmark
  *============================================================================*/
-void EXTI0_1_IRQHandler(void) {
-    if (EXTI_GetFlag(EXTI_LINE_0)) {
-        /* Clear interrupt flag */
-        EXTI_ClearFlag(EXTI_LINE_0);
-        
-        /* Increment counter */
-        Interrupt_Count++;
+#define SYSTICK_CSR      (*(volatile uint32_t *)0xE000E010UL)
+#define SYSTICK_RVR      (*(volatile uint32_t *)0xE000E014UL)
+#define SYSTICK_CVR      (*(volatile uint32_t *)0xE000E018UL)
+
+#define BENCH_ROUNDS     100U
+
+volatile uint32_t Edge_Count = 0;
+volatile uint32_t Legacy_Cycles_Per_Edge = 0;
+volatile uint32_t Dispatch_Cycles_Per_Edge = 0;
+
+static void Count_Edge(uint32_t Line) {
+    (void)Line;
+    Edge_Count++;
+}
+
+/* Per-line flag check and clear, as the handlers did before EXTI_Dispatch */
+static void Legacy_Service_4_15(void) {
+    uint32_t i;
+
+    for (i = 4; i <= 15; i++) {
+        if (EXTI_GetFlag(1UL << i)) {
+            EXTI_ClearFlag(1UL << i);
+            Count_Edge(i);
+        }
     }
 }
 
-/*============================================================================
- * EXTI2_3 Interrupt Handler
- *============================================================================*/
-void EXTI2_3_IRQHandler(void) {
-    if (EXTI_GetFlag(EXTI_LINE_2)) {
-        EXTI_ClearFlag(EXTI_LINE_2);
-        /* Handle EXTI2 interrupt */
+/* SysTick cycles to service BENCH_ROUNDS bursts of all twelve 4-15 lines */
+static uint32_t Bench_Service(void (*Service)(void)) {
+    uint32_t round;
+    uint32_t start;
+
+    SYSTICK_RVR = 0x00FFFFFF;
+    SYSTICK_CVR = 0;
+    SYSTICK_CSR = 0x05;     /* Processor clock, no interrupt */
+
+    start = SYSTICK_CVR;
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        EXTI_SWIER = EXTI_GROUP_4_15;
+        Service();
     }
-    
-    if (EXTI_GetFlag(EXTI_LINE_3)) {
-        EXTI_ClearFlag(EXTI_LINE_3);
-        /* Handle EXTI3 interrupt */
+    return (start - SYSTICK_CVR) & 0x00FFFFFF;
+}
+
+static void Dispatch_Service_4_15(void) {
+    (void)EXTI_Dispatch(EXTI_GROUP_4_15);
+}
+
+void Example_EXTI_Dispatch_Benchmark(void) {
+    uint32_t edges = BENCH_ROUNDS * 12U;
+    uint32_t line;
+
+    /* Software-triggered lines with the vector masked, so only the
+     * servicing code is timed (the IRQ entry cost is the same per burst) */
+    NVIC_DisableIRQ(EXTI4_15_IRQn);
+    for (line = 4; line <= 15; line++) {
+        EXTI_RegisterCallback(line, Count_Edge);
+    }
+    EXTI_IMR |= EXTI_GROUP_4_15;
+
+    Edge_Count = 0;
+    Legacy_Cycles_Per_Edge = Bench_Service(Legacy_Service_4_15) / edges;
+    Edge_Count = 0;
+    Dispatch_Cycles_Per_Edge = Bench_Service(Dispatch_Service_4_15) / edges;
+
+    EXTI_IMR &= ~EXTI_GROUP_4_15;
+    SYSTICK_CSR = 0;
+
+    /* Inspect Legacy_Cycles_Per_Edge and Dispatch_Cycles_Per_Edge */
+    while (1) {
     }
 }
 
 /*============================================================================
- * EXTI4_15 Interrupt Handler
+ * EXTI Interrupt Handlers
  *============================================================================*/
+void EXTI0_1_IRQHandler(void) {
+    (void)EXTI_Dispatch(EXTI_GROUP_0_1);
+}
+
+void EXTI2_3_IRQHandler(void) {
+    (void)EXTI_Dispatch(EXTI_GROUP_2_3);
+}
+
 void EXTI4_15_IRQHandler(void) {
-    uint32_t pending_lines = (EXTI_PR >> 4) & 0xFFF;
-    uint32_t i;
-    
-    for (i = 4; i <= 15; i++) {
-        if (pending_lines & (1UL << i)) {
-            EXTI_ClearFlag(1UL << i);
-            /* Handle EXTIi interrupt */
-        }
-    }
+    (void)EXTI_Dispatch(EXTI_GROUP_4_15);
 }
 
 /*============================================================================
@@ -342,6 +396,7 @@ int main(void) {
     // Example_Alternate_Function();
     // Example_Open_Drain();
     // Example_Port_Operations();
+    // Example_EXTI_Dispatch_Benchmark();
     
     /* Default: LED blink */
     Example_LED_Blink();
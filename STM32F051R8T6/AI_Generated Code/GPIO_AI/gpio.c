@@ -6,6 +6,7 @@
  */
 
 #include "gpio.h"
+#include <stddef.h>
 
 /*============================================================================
  * GPIO Initialization and Configuration
@@ -113,7 +114,32 @@ void GPIO_ResetPin(GPIO_TypeDef *GPIOx, uint32_t Pin) {
  * @param  Pin: pin(s) to toggle (use GPIO_PIN_x defines)
  */
 void GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint32_t Pin) {
-    GPIOx->ODR ^= Pin;
+    GPIO_ToggleMasked(GPIOx, (uint16_t)Pin);
+}
+
+/**
+ * @brief  Drive the masked pins to the matching bits of Value in one store.
+ * @param  GPIOx: pointer to GPIO peripheral
+ * @param  Mask: pin(s) to update (use GPIO_PIN_x defines)
+ * @param  Value: new level for each pin in Mask
+ * @note   Uses both halves of BSRR, so pins outside Mask are never written.
+ */
+void GPIO_WriteMasked(GPIO_TypeDef *GPIOx, uint16_t Mask, uint16_t Value) {
+    uint32_t set = (uint32_t)(Value & Mask);
+    uint32_t reset = (uint32_t)(~Value & Mask);
+
+    GPIOx->BSRR = (reset << 16) | set;
+}
+
+/**
+ * @brief  Toggle the masked pins with one ODR read and one BSRR store.
+ * @param  GPIOx: pointer to GPIO peripheral
+ * @param  Mask: pin(s) to toggle (use GPIO_PIN_x defines)
+ */
+void GPIO_ToggleMasked(GPIO_TypeDef *GPIOx, uint16_t Mask) {
+    uint32_t odr = GPIOx->ODR;
+
+    GPIOx->BSRR = ((odr & Mask) << 16) | (~odr & Mask);
 }
 
 /**
@@ -141,7 +167,7 @@ uint16_t GPIO_ReadPort(GPIO_TypeDef *GPIOx) {
  * @param  PortVal: value to write (16-bit)
  */
 void GPIO_WritePort(GPIO_TypeDef *GPIOx, uint16_t PortVal) {
-    GPIOx->ODR = PortVal;
+    GPIO_WriteMasked(GPIOx, GPIO_PIN_ALL, PortVal);
 }
 
 /*============================================================================
@@ -330,6 +356,55 @@ void EXTI_ClearPending(uint32_t EXTI_Line) {
     EXTI_PR = EXTI_Line;
 }
 
+/* Callback per EXTI line, NULL when unused */
+static EXTI_CallbackTypeDef exti_callbacks[16];
+
+/* Bit index of a single set bit: (bit * 0x077CB531) >> 27 is unique per bit */
+static const uint8_t exti_debruijn_index[32] = {
+     0,  1, 28,  2, 29, 14, 24,  3, 30, 22, 20, 15, 25, 17,  4,  8,
+    31, 27, 13, 23, 21, 19, 16,  7, 26, 12, 18,  6, 11,  5, 10,  9
+};
+
+/**
+ * @brief  Register a callback for an EXTI line.
+ * @param  Line: EXTI line number (0-15)
+ * @param  Callback: function to call, or NULL to remove
+ */
+void EXTI_RegisterCallback(uint32_t Line, EXTI_CallbackTypeDef Callback) {
+    if (Line < 16) {
+        exti_callbacks[Line] = Callback;
+    }
+}
+
+/**
+ * @brief  Service every pending line of a vector group in one pass.
+ * @param  GroupMask: lines served by the calling vector (EXTI_GROUP_x)
+ * @return: Number of lines serviced
+ * @note   EXTI_PR is read once, masked with EXTI_IMR and cleared with a
+ *         single write. Set bits are then walked lowest first with a
+ *         de Bruijn multiply, since the Cortex-M0 has no CLZ instruction.
+ */
+uint32_t EXTI_Dispatch(uint32_t GroupMask) {
+    uint32_t pending = EXTI_PR & EXTI_IMR & GroupMask;
+    uint32_t serviced = 0;
+
+    EXTI_PR = pending;
+
+    while (pending != 0) {
+        uint32_t bit = pending & (0U - pending);
+        uint32_t line = exti_debruijn_index[(bit * 0x077CB531UL) >> 27];
+        EXTI_CallbackTypeDef callback = exti_callbacks[line];
+
+        pending ^= bit;
+        if (callback != NULL) {
+            callback(line);
+        }
+        serviced++;
+    }
+
+    return serviced;
+}
+
 /*============================================================================
  * NVIC Functions
  *============================================================================*/
@@ -174,6 +174,14 @@ typedef enum {
     EXTI_TRIGGER_BOTH      = 0x03   /*!< Rising and falling edge trigger */
 } EXTI_TriggerTypeDef;
 
+/* EXTI lines served by each interrupt vector */
+#define EXTI_GROUP_0_1     (0x0003UL)
+#define EXTI_GROUP_2_3     (0x000CUL)
+#define EXTI_GROUP_4_15    (0xFFF0UL)
+
+/* EXTI line callback, called with the line number (0-15) */
+typedef void (*EXTI_CallbackTypeDef)(uint32_t Line);
+
 /*============================================================================
  * NVIC Definitions
  *============================================================================*/
@@ -216,6 +224,8 @@ void GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint32_t Pin);
 uint8_t GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint32_t Pin);
 uint16_t GPIO_ReadPort(GPIO_TypeDef *GPIOx);
 void GPIO_WritePort(GPIO_TypeDef *GPIOx, uint16_t PortVal);
+void GPIO_WriteMasked(GPIO_TypeDef *GPIOx, uint16_t Mask, uint16_t Value);
+void GPIO_ToggleMasked(GPIO_TypeDef *GPIOx, uint16_t Mask);
 
 /* Clock Control */
 void GPIO_EnableClock(GPIO_TypeDef *GPIOx);
@@ -237,6 +247,8 @@ void EXTI_ClearFlag(uint32_t EXTI_Line);
 uint32_t EXTI_GetFlag(uint32_t EXTI_Line);
 uint32_t EXTI_GetPending(uint32_t EXTI_Line);
 void EXTI_ClearPending(uint32_t EXTI_Line);
+void EXTI_RegisterCallback(uint32_t Line, EXTI_CallbackTypeDef Callback);
+uint32_t EXTI_Dispatch(uint32_t GroupMask);
 
 /*============================================================================
  * IRQn_Type Definition (Simplified for STM32F0xx)
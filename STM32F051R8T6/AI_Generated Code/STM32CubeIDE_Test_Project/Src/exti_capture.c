@@ -0,0 +1,157 @@
+/**
+ * @file    exti_capture.c
+ * @brief   Timestamped EXTI edge capture for STM32F051R8T6
+ */
+
+#include "exti_capture.h"
+#include <stddef.h>
+
+/*============================================================================
+ * TIM2 (32-bit free-running timestamp counter)
+ *============================================================================*/
+#define TIM2_BASE          (0x40000000UL)
+#define TIM2_CR1           (*(volatile uint32_t *)(TIM2_BASE + 0x00))
+#define TIM2_EGR           (*(volatile uint32_t *)(TIM2_BASE + 0x14))
+#define TIM2_CNT           (*(volatile uint32_t *)(TIM2_BASE + 0x24))
+#define TIM2_PSC           (*(volatile uint32_t *)(TIM2_BASE + 0x28))
+#define TIM2_ARR           (*(volatile uint32_t *)(TIM2_BASE + 0x2C))
+
+#define RCC_APB1ENR        (*(volatile uint32_t *)(RCC_BASE + 0x1C))
+#define RCC_APB1ENR_TIM2EN (0x00000001UL)
+
+/* Keep the compiler from moving ring stores across index updates */
+#define EXTI_CAPTURE_BARRIER()  __asm volatile ("" ::: "memory")
+
+/*============================================================================
+ * Ring buffer state
+ *============================================================================*/
+static EXTI_Event capture_ring[EXTI_CAPTURE_SIZE];
+static volatile uint32_t capture_head;        /*!< Written by the ISR only */
+static volatile uint32_t capture_tail;        /*!< Written by the main loop only */
+static volatile uint32_t capture_overruns;
+static volatile uint32_t capture_high_water;
+static volatile uint32_t capture_total;
+static GPIO_TypeDef *capture_ports[16];
+
+/**
+ * @brief  Start the TIM2 timestamp counter and reset the ring.
+ */
+void EXTI_Capture_Init(void) {
+    RCC_APB1ENR |= RCC_APB1ENR_TIM2EN;
+
+    TIM2_CR1 = 0;
+    TIM2_PSC = 0;
+    TIM2_ARR = 0xFFFFFFFFUL;
+    TIM2_EGR = 0x01;        /* Load PSC/ARR */
+    TIM2_CNT = 0;
+    TIM2_CR1 = 0x01;        /* CEN */
+
+    capture_head = 0;
+    capture_tail = 0;
+    capture_overruns = 0;
+    capture_high_water = 0;
+    capture_total = 0;
+}
+
+/**
+ * @brief  Tell the capture service which port drives an EXTI line so the
+ *         handler can sample the pin level.
+ * @param  Line: EXTI line number (0-15)
+ * @param  GPIOx: port selected for this line in SYSCFG_EXTICRx
+ */
+void EXTI_Capture_AttachLine(uint8_t Line, GPIO_TypeDef *GPIOx) {
+    if (Line < 16) {
+        capture_ports[Line] = GPIOx;
+    }
+}
+
+/**
+ * @brief  Current timestamp (TIM2 count).
+ */
+uint32_t EXTI_Capture_Now(void) {
+    return TIM2_CNT;
+}
+
+/**
+ * @brief  Record one event per pending line. Call from the EXTI handler
+ *         after reading (and clearing) EXTI_PR.
+ * @param  Pending: EXTI_PR bits that were pending
+ * @note   The timestamp is taken once on entry and shared by all lines.
+ *         The edge comes from the trigger configuration (see EXTI_Edge).
+ *         When the ring is full the new event is dropped and counted.
+ */
+void EXTI_Capture_Record(uint32_t Pending) {
+    uint32_t now = TIM2_CNT;
+    uint32_t head = capture_head;
+    uint32_t rising = EXTI_RTSR;
+    uint32_t falling = EXTI_FTSR;
+    uint32_t line;
+
+    for (line = 0; line < 16 && Pending != 0; line++) {
+        uint32_t used;
+        EXTI_Event *event;
+
+        if ((Pending & (1UL << line)) == 0) {
+            continue;
+        }
+        Pending &= ~(1UL << line);
+
+        used = head - capture_tail;
+        if (used >= EXTI_CAPTURE_SIZE) {
+            capture_overruns++;
+            continue;
+        }
+
+        event = &capture_ring[head & (EXTI_CAPTURE_SIZE - 1U)];
+        event->timestamp = now;
+        event->line = (uint8_t)line;
+        event->level = (capture_ports[line] != NULL) ?
+                       (uint8_t)((capture_ports[line]->IDR >> line) & 0x01) : 0;
+        if ((falling & (1UL << line)) == 0) {
+            event->edge = EXTI_EDGE_RISING;
+        } else if ((rising & (1UL << line)) == 0) {
+            event->edge = EXTI_EDGE_FALLING;
+        } else {
+            event->edge = event->level ? EXTI_EDGE_RISING : EXTI_EDGE_FALLING;
+        }
+        head++;
+
+        if (used + 1U > capture_high_water) {
+            capture_high_water = used + 1U;
+        }
+        capture_total++;
+    }
+
+    EXTI_CAPTURE_BARRIER();
+    capture_head = head;
+}
+
+/**
+ * @brief  Copy up to Max queued events into Events and free their slots.
+ * @return Number of events copied
+ */
+uint32_t EXTI_Capture_Drain(EXTI_Event *Events, uint32_t Max) {
+    uint32_t tail = capture_tail;
+    uint32_t available = capture_head - tail;
+    uint32_t count = (available < Max) ? available : Max;
+    uint32_t i;
+
+    EXTI_CAPTURE_BARRIER();
+    for (i = 0; i < count; i++) {
+        Events[i] = capture_ring[(tail + i) & (EXTI_CAPTURE_SIZE - 1U)];
+    }
+    EXTI_CAPTURE_BARRIER();
+
+    capture_tail = tail + count;
+    return count;
+}
+
+/**
+ * @brief  Snapshot of the capture counters.
+ */
+void EXTI_Capture_GetStats(EXTI_CaptureStats *Stats) {
+    Stats->captured = capture_total;
+    Stats->overruns = capture_overruns;
+    Stats->high_water = capture_high_water;
+    Stats->capacity = EXTI_CAPTURE_SIZE;
+}
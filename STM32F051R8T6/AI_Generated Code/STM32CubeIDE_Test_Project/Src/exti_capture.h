@@ -0,0 +1,66 @@
+/**
+ * @file    exti_capture.h
+ * @brief   Timestamped EXTI edge capture for STM32F051R8T6
+ *
+ * Every EXTI edge is stored as {timestamp, line, edge, level} in a lock-free
+ * single-producer/single-consumer ring buffer. The EXTI interrupt handler is
+ * the only producer, the main loop the only consumer. Timestamps come from
+ * TIM2 running free at the timer clock (32-bit, no prescaler).
+ */
+
+#ifndef EXTI_CAPTURE_H
+#define EXTI_CAPTURE_H
+
+#include <stdint.h>
+#include "gpio.h"
+
+/*============================================================================
+ * Configuration
+ *============================================================================*/
+#ifndef EXTI_CAPTURE_SIZE
+#define EXTI_CAPTURE_SIZE    64U     /*!< Ring capacity, must be a power of two */
+#endif
+
+#if (EXTI_CAPTURE_SIZE & (EXTI_CAPTURE_SIZE - 1U)) != 0
+#error "EXTI_CAPTURE_SIZE must be a power of two"
+#endif
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+/**
+ * @brief  Edge that raised the event. A line triggered on one edge only
+ *         reports that edge (from EXTI_RTSR/EXTI_FTSR). A line triggered on
+ *         both can only be told apart by the level sampled in the handler,
+ *         which a pulse shorter than the interrupt latency gets wrong.
+ */
+typedef enum {
+    EXTI_EDGE_RISING = 0,
+    EXTI_EDGE_FALLING = 1
+} EXTI_Edge;
+
+typedef struct {
+    uint32_t timestamp;  /*!< TIM2 count when the handler ran */
+    uint8_t line;        /*!< EXTI line number (0-15) */
+    uint8_t edge;        /*!< EXTI_Edge */
+    uint8_t level;       /*!< Pin level sampled in the handler (0 or 1) */
+} EXTI_Event;
+
+typedef struct {
+    uint32_t captured;   /*!< Events stored since init */
+    uint32_t overruns;   /*!< Events dropped because the ring was full */
+    uint32_t high_water; /*!< Highest ring fill level seen */
+    uint32_t capacity;   /*!< EXTI_CAPTURE_SIZE */
+} EXTI_CaptureStats;
+
+/*============================================================================
+ * API Prototypes
+ *============================================================================*/
+void EXTI_Capture_Init(void);
+void EXTI_Capture_AttachLine(uint8_t Line, GPIO_TypeDef *GPIOx);
+void EXTI_Capture_Record(uint32_t Pending);
+uint32_t EXTI_Capture_Drain(EXTI_Event *Events, uint32_t Max);
+void EXTI_Capture_GetStats(EXTI_CaptureStats *Stats);
+uint32_t EXTI_Capture_Now(void);
+
+#endif /* EXTI_CAPTURE_H */
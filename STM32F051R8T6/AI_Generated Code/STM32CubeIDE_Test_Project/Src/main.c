@@ -19,12 +19,16 @@
 #include <stdint.h>
 #include "rcc.h"
 #include "gpio.h"
+#include "exti_capture.h"
 
 #if !defined(__SOFT_FP__) && defined(__ARM_FP)
   #warning "FPU is not initialized, but the project is compiling for an FPU. Please initialize the FPU before use."
 #endif
 
-volatile uint8_t Interrupt_Count = 0;
+#define EVENT_BATCH_SIZE   8U
+
+static EXTI_Event event_batch[EVENT_BATCH_SIZE];
+static uint32_t rising_edges = 0;
 
 void Delay_ms(uint32_t ms) {
     uint32_t i, j;
@@ -88,6 +92,9 @@ void Example_Pin_Init(void) {
     EXTI_FTSR &= ~EXTI_LINE_0;    /* Disable falling edge trigger */
     EXTI_PR = EXTI_LINE_0;        /* Clear pending bit */
 
+    /* Timestamp edges on line 0 and sample PA0 for the level */
+    EXTI_Capture_AttachLine(0, GPIOA);
+
     /* Configure NVIC for EXTI0_1 IRQ */
     NVIC_EnableIRQ(EXTI0_1_IRQn);
     NVIC_SetPriority(EXTI0_1_IRQn, 3);  /* Lowest priority */
@@ -98,6 +105,7 @@ int main(void) {
     // Configure system clock
 	SystemClock_Config_8MHz();
 	Example_LED_Blink();
+	EXTI_Capture_Init();
 	Example_Pin_Init();
 
     // Enable peripheral clocks as needed
@@ -107,11 +115,25 @@ int main(void) {
 
     /* Main loop */
     while (1) {
-        /* LED reflects interrupt count (mod 2) */
-        if (Interrupt_Count % 2) {
-            GPIO_SetPin(GPIOC, GPIO_PIN_9);
-        } else {
-            GPIO_ResetPin(GPIOC, GPIO_PIN_9);
+        /* Drain captured edges in batches */
+        uint32_t count = EXTI_Capture_Drain(event_batch, EVENT_BATCH_SIZE);
+        uint32_t i;
+
+        for (i = 0; i < count; i++) {
+            /* Rising-only trigger: every line 0 event is a rising edge,
+               whatever level PA0 has by the time the handler samples it */
+            if (event_batch[i].line == 0 && event_batch[i].edge == EXTI_EDGE_RISING) {
+                rising_edges++;
+            }
+        }
+
+        /* LED reflects rising edge count (mod 2) */
+        if (count != 0) {
+            if (rising_edges % 2) {
+                GPIO_SetPin(GPIOC, GPIO_PIN_9);
+            } else {
+                GPIO_ResetPin(GPIOC, GPIO_PIN_9);
+            }
         }
     }
     return 0;
@@ -119,11 +141,9 @@ int main(void) {
 
 
 void EXTI0_1_IRQHandler(void) {
-    if (EXTI_GetFlag(EXTI_LINE_0)) {
-        /* Clear interrupt flag */
-        EXTI_ClearFlag(EXTI_LINE_0);
+    /* Read and clear lines 0-1 once, then queue one event per edge */
+    uint32_t pending = EXTI_PR & (EXTI_LINE_0 | EXTI_LINE_1);
 
-        /* Increment counter */
-        Interrupt_Count++;
-    }
+    EXTI_PR = pending;
+    EXTI_Capture_Record(pending);
 }
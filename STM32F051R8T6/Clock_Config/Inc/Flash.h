@@ -2,6 +2,7 @@
 #define FLASH_H
 
 #include <stdint.h>
+#include "ramfunc.h"
 
 /* CMSIS-style memory access macros */
 #ifdef __cplusplus
@@ -12,8 +13,12 @@
 #define     __O     volatile             /*!< Defines 'write only' permissions */
 #define     __IO    volatile             /*!< Defines 'read/write' permissions */
 
-/* Flash Base Address */
+/* Flash Base Address (HOST_SIM builds use a simulated register block) */
+#ifdef HOST_SIM
+#include "sim_regs.h"
+#else
 #define FLASH_BASE        0x40022000UL
+#endif
 
 /* Flash Register Structure Definition */
 typedef struct {
@@ -265,12 +270,12 @@ typedef enum {
 void FLASH_SetLatency(FLASH_Latency_t latency);
 void FLASH_EnablePrefetchBuffer(void);
 void FLASH_DisablePrefetchBuffer(void);
-FLASH_Status_t FLASH_GetStatus(void);
+RAMFUNC FLASH_Status_t FLASH_GetStatus(void);
 
 /* Flash memory operations */
-FLASH_Status_t FLASH_ErasePage(uint32_t page_address);
+RAMFUNC FLASH_Status_t FLASH_ErasePage(uint32_t page_address);
 FLASH_Status_t FLASH_MassErase(void);
-FLASH_Status_t FLASH_ProgramHalfWord(uint32_t address, uint16_t data);
+RAMFUNC FLASH_Status_t FLASH_ProgramHalfWord(uint32_t address, uint16_t data);
 FLASH_Status_t FLASH_ProgramWord(uint32_t address, uint32_t data);
 
 /* Option byte operations */
@@ -0,0 +1,64 @@
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <stdint.h>
+
+// Boot-time profiler. Build with -DBOOT_PROFILE (C compiler and assembler)
+// to timestamp each boot phase from Reset_Handler to the main loop. SysTick
+// is started at reset and free-runs at HCLK; clock changes made through rcc
+// are followed, so every stamp is in microseconds since reset. Its wrap
+// interrupt (SysTick_Handler is defined here, and disabled at the READY
+// mark) keeps long waits such as the LSE start-up from losing whole periods.
+//
+// The table lives in .noinit RAM so the .bss zeroing does not wipe the
+// stamps taken before it. Read it with "print boot_profile" in GDB, or with
+// "mdw <address of boot_profile> 9" in OpenOCD (magic, then the stamps).
+// With -DBOOT_PROFILE_SEMIHOSTING, Boot_ProfileDump() also prints it through
+// semihosting (needs a debugger attached, otherwise the BKPT faults).
+// Without BOOT_PROFILE every hook compiles to nothing. The SysTick
+// benchmarks in main.c refuse to build with it.
+
+// Boot phases; each stamp is the time the phase ended. The values are used
+// by number in startup_stm32f051r8tx.s.
+typedef enum {
+    BOOT_PHASE_SYSTEMINIT = 0,   // SystemInit()
+    BOOT_PHASE_DATA = 1,         // .data and .RamFunc copy
+    BOOT_PHASE_BSS = 2,          // .bss zeroing
+    BOOT_PHASE_CTORS = 3,        // __libc_init_array, entering main()
+    BOOT_PHASE_CHECKS = 4,       // Device ID, image CRC, vectors to RAM
+    BOOT_PHASE_CLOCK = 5,        // Clock tree (RCC_Init)
+    BOOT_PHASE_PERIPH = 6,       // Peripheral init
+    BOOT_PHASE_READY = 7,        // Main loop reached
+    BOOT_PHASE_COUNT
+} Boot_Phase;
+
+#define BOOT_PROFILE_MAGIC   0xB0071A6EUL
+
+typedef struct {
+    uint32_t magic;                      // BOOT_PROFILE_MAGIC once complete
+    uint32_t stamp_us[BOOT_PHASE_COUNT]; // End of each phase, us since reset
+    uint32_t tick_hz;                    // SysTick rate for the current segment
+    uint32_t tick_mark;                  // SysTick value at the last step
+    uint32_t listening;                  // Clock listener registered
+    uint64_t elapsed_ns;
+} Boot_Profile;
+
+#ifdef BOOT_PROFILE
+
+extern Boot_Profile boot_profile;
+
+void Boot_ProfileStart(void);
+void Boot_ProfileMark(Boot_Phase phase);
+void Boot_ProfileDump(void);
+
+#define BOOT_MARK(phase)    Boot_ProfileMark(phase)
+#define BOOT_DUMP()         Boot_ProfileDump()
+
+#else
+
+#define BOOT_MARK(phase)    ((void)0)
+#define BOOT_DUMP()         ((void)0)
+
+#endif // BOOT_PROFILE
+
+#endif // BOOT_PROFILE_H
@@ -0,0 +1,37 @@
+#ifndef CLOCK_GOVERNOR_H
+#define CLOCK_GOVERNOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Runtime frequency scaling between fixed operating points, all from HSI
+// (no crystal needed). Flash latency is raised before speeding up and lowered
+// after slowing down. Drivers that depend on the clock register with
+// RCC_RegisterClockListener() and are notified around every transition.
+
+// Operating points
+typedef enum {
+    GOVERNOR_OPP_8MHZ = 0,   // HSI
+    GOVERNOR_OPP_24MHZ,      // HSI/2 x 6
+    GOVERNOR_OPP_32MHZ,      // HSI/2 x 8
+    GOVERNOR_OPP_48MHZ,      // HSI/2 x 12
+    GOVERNOR_OPP_COUNT
+} Governor_OPP;
+
+// Transition statistics. Times are measured with SysTick (Governor_Init
+// starts it if it is stopped) and converted using the clock in effect for
+// each step.
+typedef struct {
+    uint32_t transitions;
+    uint32_t last_transition_us;
+    uint32_t max_transition_us;
+} Governor_Stats;
+
+// Function prototypes
+void Governor_Init(void);
+bool Governor_SetOPP(Governor_OPP opp);
+Governor_OPP Governor_GetOPP(void);
+uint32_t Governor_GetOPPFrequency(Governor_OPP opp);
+void Governor_GetStats(Governor_Stats *stats);
+
+#endif // CLOCK_GOVERNOR_H
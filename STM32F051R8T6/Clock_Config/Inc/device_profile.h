@@ -0,0 +1,80 @@
+#ifndef DEVICE_PROFILE_H
+#define DEVICE_PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Device profile: what the selected STM32F0 part has, as compile-time
+// constants. Pick the part with a compiler define (-DSTM32F051x8,
+// -DSTM32F042x6, -DSTM32F072xB, -DSTM32F091xC); this board's F051R8 is the
+// default. Drivers test the DEVICE_HAS_* flags with #if so code for missing
+// peripherals is never built.
+
+#if !defined(STM32F051x8) && !defined(STM32F042x6) && \
+    !defined(STM32F072xB) && !defined(STM32F091xC)
+#define STM32F051x8
+#endif
+
+#if defined(STM32F051x8)
+#define DEVICE_NAME             "STM32F051x8"
+#define DEVICE_ID               0x440U      // DBGMCU_IDCODE DEV_ID
+#define DEVICE_FLASH_SIZE       (64U * 1024U)
+#define DEVICE_FLASH_PAGE_SIZE  1024U
+#define DEVICE_HAS_HSI48        0
+#define DEVICE_HAS_PLLSRC_HSI   0           // PLLSRC[0]: HSI/PREDIV and HSI48/PREDIV inputs
+#define DEVICE_HAS_USB          0
+#define DEVICE_HAS_DMA2         0
+#define DEVICE_HAS_DAC          1
+#define DEVICE_HAS_USART3       0
+
+#elif defined(STM32F042x6)
+#define DEVICE_NAME             "STM32F042x6"
+#define DEVICE_ID               0x445U
+#define DEVICE_FLASH_SIZE       (32U * 1024U)
+#define DEVICE_FLASH_PAGE_SIZE  1024U
+#define DEVICE_HAS_HSI48        1
+#define DEVICE_HAS_PLLSRC_HSI   1
+#define DEVICE_HAS_USB          1
+#define DEVICE_HAS_DMA2         0
+#define DEVICE_HAS_DAC          0
+#define DEVICE_HAS_USART3       0
+
+#elif defined(STM32F072xB)
+#define DEVICE_NAME             "STM32F072xB"
+#define DEVICE_ID               0x448U
+#define DEVICE_FLASH_SIZE       (128U * 1024U)
+#define DEVICE_FLASH_PAGE_SIZE  2048U
+#define DEVICE_HAS_HSI48        1
+#define DEVICE_HAS_PLLSRC_HSI   1
+#define DEVICE_HAS_USB          1
+#define DEVICE_HAS_DMA2         0
+#define DEVICE_HAS_DAC          1
+#define DEVICE_HAS_USART3       1
+
+#elif defined(STM32F091xC)
+#define DEVICE_NAME             "STM32F091xC"
+#define DEVICE_ID               0x442U
+#define DEVICE_FLASH_SIZE       (256U * 1024U)
+#define DEVICE_FLASH_PAGE_SIZE  2048U
+#define DEVICE_HAS_HSI48        1
+#define DEVICE_HAS_PLLSRC_HSI   1
+#define DEVICE_HAS_USB          0
+#define DEVICE_HAS_DMA2         1
+#define DEVICE_HAS_DAC          1
+#define DEVICE_HAS_USART3       1
+#endif
+
+// DBGMCU ID code register (DEV_ID in bits 11:0, REV_ID in bits 31:16)
+#define DBGMCU_IDCODE           (*(volatile uint32_t *)0x40015800UL)
+#define DBGMCU_IDCODE_DEV_ID    0xFFFU
+
+// Optional runtime check that the firmware runs on the part it was built for
+static inline bool Device_CheckID(void) {
+#ifdef HOST_SIM
+    return true;   // No DBGMCU on the host
+#else
+    return (DBGMCU_IDCODE & DBGMCU_IDCODE_DEV_ID) == DEVICE_ID;
+#endif
+}
+
+#endif // DEVICE_PROFILE_H
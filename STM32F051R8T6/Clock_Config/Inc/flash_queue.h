@@ -0,0 +1,60 @@
+#ifndef FLASH_QUEUE_H
+#define FLASH_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Flash.h"
+
+// Background flash job queue.
+// Erase and program requests are sequenced from FLASH_IRQHandler on the end
+// of operation (EOPIE) and error (ERRIE) interrupts instead of spinning on
+// BSY. A job is a list of steps (page erases, buffer writes) with one
+// completion callback; jobs run in submission order.
+//
+// The F0 flash has a single bank: while an operation runs, any fetch from
+// flash stalls until it ends. Flash-resident code gets the CPU between
+// operations; code that must keep running during them belongs in RAM
+// (RAMFUNC). Do not call the blocking FLASH_* functions while
+// FlashQueue_IsBusy().
+
+#define FLASH_QUEUE_DEPTH   4U      // Jobs queued or running at once
+
+// Step types
+typedef enum {
+    FLASH_STEP_ERASE = 0,   // Erase count pages, starting with the one holding address
+    FLASH_STEP_PROGRAM      // Write count bytes from data to address (half-word aligned)
+} FlashQueue_StepType;
+
+typedef struct {
+    FlashQueue_StepType type;
+    uint32_t address;
+    const void *data;       // FLASH_STEP_PROGRAM only; an odd last byte is padded with 0xFF
+    uint32_t count;         // Pages or bytes (at least 1)
+} FlashQueue_Step;
+
+typedef struct FlashQueue_Job FlashQueue_Job;
+
+// Called from the FLASH interrupt when a job completes or fails, after the
+// next job's first operation has started: a callback in flash stalls until
+// that operation ends, so callbacks with deadlines should be RAMFUNC
+typedef void (*FlashQueue_Callback)(FlashQueue_Job *job);
+
+// Job, owned by the caller and left untouched until it completes
+struct FlashQueue_Job {
+    const FlashQueue_Step *steps;
+    uint8_t step_count;
+    FlashQueue_Callback callback;       // Optional
+    void *context;                      // For the callback
+
+    // Filled in by the queue
+    volatile FLASH_Status_t status;     // FLASH_STATUS_BUSY until the job ends
+    uint32_t fail_address;              // Where it failed, if it did
+    uint8_t step;
+    uint32_t offset;
+};
+
+// Function Prototypes
+bool FlashQueue_Submit(FlashQueue_Job *job);
+bool FlashQueue_IsBusy(void);
+
+#endif // FLASH_QUEUE_H
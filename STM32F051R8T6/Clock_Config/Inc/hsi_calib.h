@@ -0,0 +1,52 @@
+#ifndef HSI_CALIB_H
+#define HSI_CALIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// HSI calibration: measure the HSI-derived timer clock against a reference
+// and step HSITRIM until the error is smallest. The reference is LSE or an
+// external edge on TIM14_CH1, both measured with TIM14 input capture, or a
+// measurement made elsewhere (e.g. a host sync frame timed by the firmware).
+// The chosen trim is kept in the last flash page so later boots can load it
+// instead of calibrating again. So is the finding that the reference is
+// missing (HSICal_SaveNoReference), so boards without the LSE crystal do
+// not wait for it on every boot; erase the CALIB page to try again.
+
+// Reference clocks
+typedef enum {
+    HSICAL_REF_LSE = 0,      // 32.768 kHz crystal through RTCCLK (TIM14 remap)
+    HSICAL_REF_EXTERNAL      // Edge on the TIM14_CH1 pin (PA4/PA7 AF4, PB1 AF0),
+                             // configured by the caller
+} HSICal_Reference;
+
+typedef enum {
+    HSICAL_OK = 0,
+    HSICAL_NOT_ON_HSI,       // SYSCLK is not derived from HSI
+    HSICAL_NO_REFERENCE,     // Reference did not start or stopped toggling
+    HSICAL_OUT_OF_RANGE,     // Trim reached 0 or 31 before the error was nulled
+    HSICAL_FLASH_ERROR
+} HSICal_Status;
+
+// What HSICal_LoadSaved() found
+typedef enum {
+    HSICAL_SAVED_NONE = 0,       // Nothing stored: calibrate
+    HSICAL_SAVED_TRIM,           // Stored trim applied
+    HSICAL_SAVED_NO_REFERENCE    // An earlier boot found no reference: factory trim kept
+} HSICal_Saved;
+
+#define HSICAL_LSE_FREQUENCY     32768UL
+#define HSICAL_MAX_STEPS         32U        // Trim steps tried per calibration
+#define HSICAL_CAPTURES          4U         // Captures averaged per measurement
+#define HSICAL_CAPTURE_LOOPS     1000000U   // Polls per capture (~1 s at 8 MHz)
+#define HSICAL_LSE_STARTUP_LOOPS 2000000U   // LSE start-up can take up to ~2 s
+
+// Function prototypes
+HSICal_Status HSICal_Calibrate(HSICal_Reference reference, uint32_t reference_hz);
+HSICal_Status HSICal_ApplyMeasurement(uint32_t measured_ticks, uint32_t expected_ticks);
+int32_t HSICal_GetErrorPPM(void);
+HSICal_Saved HSICal_LoadSaved(void);
+HSICal_Status HSICal_Save(void);
+HSICal_Status HSICal_SaveNoReference(void);
+
+#endif // HSI_CALIB_H
@@ -0,0 +1,51 @@
+#ifndef IMAGE_CRC_H
+#define IMAGE_CRC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Application image integrity check with the CRC peripheral.
+//
+// The linker script places an 8-byte record in the last word pair of FLASH
+// (.image_crc): the image length, filled in by the linker, then the expected
+// CRC, left at IMAGE_CRC_UNSET. The post-build step (Tools/image_crc_patch.py,
+// run from .cproject for both configurations) computes the CRC over the
+// first length bytes of the flashed image and patches it into the ELF; until
+// then every check returns IMAGE_CRC_NOT_SET, so builds made without the
+// step still run.
+//
+// CRC parameters (the CRC unit defaults): polynomial 0x04C11DB7, initial
+// value 0xFFFFFFFF, input fed as little-endian 32-bit words, MSB first, no
+// reflection, no final XOR.
+//
+// ImageCRC_Verify() checks the whole image at boot, streaming it into
+// CRC_DR with DMA1 channel 1 (memory-to-memory). ImageCRC_BackgroundStep(),
+// called from an idle tick, checks IMAGE_CRC_CHUNK bytes per call without
+// waiting: the running CRC is saved between chunks and reloaded through
+// CRC_INIT, so other CRC users in between do not disturb it.
+//
+// Time to verify: the CRC unit needs 4 AHB cycles per word and the DMA read
+// from flash adds about one, so a word costs ~5 HCLK cycles. The full 64 KB
+// (16384 words) is ~82k cycles: ~10 ms at the 8 MHz boot clock, ~2 ms at
+// 48 MHz with one wait state. These are figures from the reference manual
+// timings; ImageCRC_TimeFullFlash() (IMAGE_CRC_BENCHMARK in main.c) measures
+// the board. The boot check only covers the image length, so it costs
+// proportionally less.
+
+#define IMAGE_CRC_UNSET     0xFFFFFFFFUL
+#define IMAGE_CRC_CHUNK     2048U       // Bytes per background step
+
+typedef enum {
+    IMAGE_CRC_OK = 0,
+    IMAGE_CRC_BUSY,             // Background pass still running
+    IMAGE_CRC_MISMATCH,
+    IMAGE_CRC_NOT_SET           // No CRC patched into the image
+} ImageCRC_Status;
+
+// Function prototypes
+uint32_t ImageCRC_Compute(uint32_t address, uint32_t length);
+ImageCRC_Status ImageCRC_Verify(void);
+ImageCRC_Status ImageCRC_BackgroundStep(void);
+uint32_t ImageCRC_GetPassCount(void);
+
+#endif // IMAGE_CRC_H
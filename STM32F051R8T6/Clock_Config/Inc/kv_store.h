@@ -0,0 +1,55 @@
+#ifndef KV_STORE_H
+#define KV_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Log-structured key-value store over KV_PAGES flash pages reserved as
+// KVSTORE in the linker script, just below the HSI trim page.
+//
+// Every write appends a record to the newest page, so updating a value
+// costs a few half-word programs instead of a page erase. A RAM index keeps
+// the flash address of each key's newest record, so reads are a copy.
+// Pages are used in rotation: when the last free page is needed, the live
+// records of the oldest page are copied into it and the oldest page is
+// erased, which spreads erases evenly over the area.
+//
+// Power loss is safe at any point. Records carry a checksum written last.
+// A page being retired is marked obsolete only after its live records have
+// been copied and the new page's "copy complete" marker is set. KV_Init()
+// drops torn records, finishes an interrupted erase, discards a copy
+// without the marker and retires the source of a copy with it.
+//
+// Live data should fit in KV_PAGES - 2 pages, otherwise every write may end
+// up compacting.
+
+#define KV_PAGES             4U      // Pages in KVSTORE (ld script)
+#define KV_MAX_KEYS          32U     // Keys are 0 .. KV_MAX_KEYS - 1
+#define KV_MAX_VALUE         64U     // Bytes per value
+#define KV_FLASH_ENDURANCE   10000UL // Erase cycles per page (datasheet minimum)
+
+typedef enum {
+    KV_OK = 0,
+    KV_NOT_FOUND,        // Key never written, or deleted
+    KV_INVALID,          // Bad key, length or buffer
+    KV_FULL,             // Live data no longer fits after compaction
+    KV_FLASH_ERROR       // Erase or program failed
+} KV_Status;
+
+typedef struct {
+    uint32_t writes;         // Records appended since KV_Init()
+    uint32_t compactions;    // Pages rotated since KV_Init()
+    uint32_t pages_opened;   // Over the life of the store (~ erases)
+    uint32_t free_bytes;     // Left in the current page
+} KV_Stats;
+
+// Function prototypes
+KV_Status KV_Init(void);
+KV_Status KV_Write(uint16_t key, const void *data, uint16_t length);
+KV_Status KV_Read(uint16_t key, void *data, uint16_t size, uint16_t *length);
+KV_Status KV_Delete(uint16_t key);
+void KV_GetStats(KV_Stats *stats);
+uint32_t KV_ProjectedUpdates(uint16_t length);
+
+#endif // KV_STORE_H
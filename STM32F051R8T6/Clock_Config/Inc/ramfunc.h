@@ -0,0 +1,38 @@
+#ifndef RAMFUNC_H
+#define RAMFUNC_H
+
+#include <stdint.h>
+
+// Code that keeps running while the flash is busy. Any fetch from flash
+// during an erase (20-40 ms per page) or a program stalls the core until the
+// operation ends, so the flash primitives and the ISRs that must keep their
+// deadlines are placed in .RamFunc, which the startup code copies to SRAM.
+//
+// RAMFUNC goes on the prototype as well as the definition: RAM is out of BL
+// range from flash, so callers need long_call. A RAMFUNC function must only
+// call other RAMFUNC code and must not touch .rodata (lookup tables, switch
+// jump tables) or libgcc helpers such as the M0 division routines, which all
+// live in flash.
+//
+// Interrupts also need their vectors out of flash. The F0 has no VTOR, so
+// RAM_RelocateVectorTable() copies the table to the start of SRAM and maps
+// SRAM at 0x00000000 (SYSCFG MEM_MODE).
+//
+// In RAM: the flash primitives (Flash.c) and FLASH_IRQHandler with its
+// helpers (flash_queue.c). There is no delay tick to move: Delay_ms() in
+// main.c is a busy loop in its caller, which stalls with it. NMI_Handler
+// (CSS, rcc.c) and the boot profiler's SysTick_Handler stay in flash: both
+// need libgcc division (and the clock cache its .rodata tables), and both
+// still do their job when late (SYSCLK is already on HSI; the next SysTick
+// wrap is at least 349 ms away).
+#ifdef HOST_SIM
+#define RAMFUNC
+#else
+#define RAMFUNC     __attribute__((section(".RamFunc"), long_call, noinline))
+#endif
+
+#define RAM_VECTOR_WORDS    48U   // 16 system + 32 IRQ entries
+
+void RAM_RelocateVectorTable(void);
+
+#endif // RAMFUNC_H
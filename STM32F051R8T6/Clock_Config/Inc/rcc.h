@@ -3,24 +3,31 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "device_profile.h"
 
-// RCC Base Address
+// RCC and SysTick Base Addresses (HOST_SIM builds use simulated register blocks)
+#ifdef HOST_SIM
+#include "sim_regs.h"
+#else
 #define RCC_BASE        0x40021000UL
+#define SYSTICK_BASE    0xE000E010UL    // SysTick CSR; counts HCLK or HCLK/8
+#endif
 
 // Register offsets
 #define RCC_CR          (*(volatile uint32_t *)(RCC_BASE + 0x00))
 #define RCC_CFGR        (*(volatile uint32_t *)(RCC_BASE + 0x04))
 #define RCC_CIR         (*(volatile uint32_t *)(RCC_BASE + 0x08))
-#define RCC_APB2RSTR    (*(volatile uint32_t *)(RCC_BASE + 0x14))
+#define RCC_APB2RSTR    (*(volatile uint32_t *)(RCC_BASE + 0x0C))
 #define RCC_APB1RSTR    (*(volatile uint32_t *)(RCC_BASE + 0x10))
-#define RCC_AHBENR      (*(volatile uint32_t *)(RCC_BASE + 0x20))
-#define RCC_APB2ENR     (*(volatile uint32_t *)(RCC_BASE + 0x24))
-#define RCC_APB1ENR     (*(volatile uint32_t *)(RCC_BASE + 0x28))
-#define RCC_BDCR        (*(volatile uint32_t *)(RCC_BASE + 0x34))
-#define RCC_CSR         (*(volatile uint32_t *)(RCC_BASE + 0x38))
-#define RCC_CFGR2       (*(volatile uint32_t *)(RCC_BASE + 0x40))
-#define RCC_CFGR3       (*(volatile uint32_t *)(RCC_BASE + 0x44))
-#define RCC_CR2         (*(volatile uint32_t *)(RCC_BASE + 0x48))
+#define RCC_AHBENR      (*(volatile uint32_t *)(RCC_BASE + 0x14))
+#define RCC_APB2ENR     (*(volatile uint32_t *)(RCC_BASE + 0x18))
+#define RCC_APB1ENR     (*(volatile uint32_t *)(RCC_BASE + 0x1C))
+#define RCC_BDCR        (*(volatile uint32_t *)(RCC_BASE + 0x20))
+#define RCC_CSR         (*(volatile uint32_t *)(RCC_BASE + 0x24))
+#define RCC_AHBRSTR     (*(volatile uint32_t *)(RCC_BASE + 0x28))
+#define RCC_CFGR2       (*(volatile uint32_t *)(RCC_BASE + 0x2C))
+#define RCC_CFGR3       (*(volatile uint32_t *)(RCC_BASE + 0x30))
+#define RCC_CR2         (*(volatile uint32_t *)(RCC_BASE + 0x34))
 
 // Clock sources
 typedef enum {
@@ -77,55 +84,180 @@ typedef struct {
     bool pll_enabled;
     PLLSource pll_source;
     uint8_t pll_multiplier;  // 2-16 (refer to PLLMUL bits)
+    uint8_t pll_prediv;      // HSE divider for PLL_SOURCE_HSE, 1-16 (0 = 1)
     AHBPrescaler ahb_prescaler;
     APBPrescaler apb_prescaler;
     bool hsi48_enabled;      // For F04x/F07x/F09x only
     bool css_enabled;        // Clock Security System
+    uint32_t hse_hz;         // Fitted HSE the tree is built on (0 = RCC_SetHSEFrequency's)
 } RCC_Config;
 
+// Clock tree limits (STM32F05x datasheet)
+#define RCC_HSI_FREQUENCY       8000000UL
+#define RCC_HSI_TRIM_DEFAULT    16U
+#define RCC_HSI_TRIM_MAX        31U
+#define RCC_HSI_TRIM_STEP_HZ    40000UL     // Typical HSI change per HSITRIM step
+#define RCC_HSE_DEFAULT         8000000UL   // Until RCC_SetHSEFrequency() or a solved config says otherwise
+#define RCC_HSE_MIN             4000000UL
+#define RCC_HSE_MAX             32000000UL
+#define RCC_PLL_INPUT_MIN       1000000UL
+#define RCC_PLL_INPUT_MAX       24000000UL
+#define RCC_PLL_OUTPUT_MIN      16000000UL
+#define RCC_PLL_OUTPUT_MAX      48000000UL
+#define RCC_FLASH_0WS_MAX       24000000UL  // Highest SYSCLK with zero wait states
+
+// Requested clock tree for RCC_SolveConfig
+typedef struct {
+    uint32_t sysclk_hz;      // Required SYSCLK (0 = same as hclk_hz)
+    uint32_t hclk_hz;        // Required HCLK (0 = same as SYSCLK)
+    uint32_t pclk_hz;        // Required PCLK (0 = same as HCLK)
+    uint32_t hse_hz;         // Fitted HSE crystal/clock, 0 if none
+} RCC_ClockRequest;
+
+// Compile-time check of a constant request (mirrors RCC_SolveConfig)
+#define RCC_IS_AHB_DIV(d)       ((d) == 1 || (d) == 2 || (d) == 4 || (d) == 8 || (d) == 16 || \
+                                 (d) == 64 || (d) == 128 || (d) == 256 || (d) == 512)
+#define RCC_IS_APB_DIV(d)       ((d) == 1 || (d) == 2 || (d) == 4 || (d) == 8 || (d) == 16)
+#define RCC_PLL_REACHES(f, in)  ((in) >= RCC_PLL_INPUT_MIN && (in) <= RCC_PLL_INPUT_MAX && \
+                                 (f) >= RCC_PLL_OUTPUT_MIN && (f) <= RCC_PLL_OUTPUT_MAX && \
+                                 (f) % (in) == 0 && (f) / (in) >= 2 && (f) / (in) <= 16)
+#define RCC_PLL_REACHES_DIV(f, hse, d)  ((hse) % (d) == 0 && RCC_PLL_REACHES(f, (hse) / (d)))
+#define RCC_PLL_REACHES_HSE(f, hse) \
+    (RCC_PLL_REACHES_DIV(f, hse, 1) || RCC_PLL_REACHES_DIV(f, hse, 2) || \
+     RCC_PLL_REACHES_DIV(f, hse, 3) || RCC_PLL_REACHES_DIV(f, hse, 4) || \
+     RCC_PLL_REACHES_DIV(f, hse, 5) || RCC_PLL_REACHES_DIV(f, hse, 6) || \
+     RCC_PLL_REACHES_DIV(f, hse, 7) || RCC_PLL_REACHES_DIV(f, hse, 8) || \
+     RCC_PLL_REACHES_DIV(f, hse, 9) || RCC_PLL_REACHES_DIV(f, hse, 10) || \
+     RCC_PLL_REACHES_DIV(f, hse, 11) || RCC_PLL_REACHES_DIV(f, hse, 12) || \
+     RCC_PLL_REACHES_DIV(f, hse, 13) || RCC_PLL_REACHES_DIV(f, hse, 14) || \
+     RCC_PLL_REACHES_DIV(f, hse, 15) || RCC_PLL_REACHES_DIV(f, hse, 16))
+#define RCC_SYSCLK_REACHABLE(f, hse) \
+    ((f) == RCC_HSI_FREQUENCY || RCC_PLL_REACHES(f, RCC_HSI_FREQUENCY / 2) || \
+     ((hse) >= RCC_HSE_MIN && (hse) <= RCC_HSE_MAX && ((f) == (hse) || RCC_PLL_REACHES_HSE(f, hse))))
+#define RCC_CLOCKS_VALID(sysclk, hclk, pclk, hse) \
+    (RCC_SYSCLK_REACHABLE(sysclk, hse) && \
+     (hclk) != 0 && (sysclk) % (hclk) == 0 && RCC_IS_AHB_DIV((sysclk) / (hclk)) && \
+     (pclk) != 0 && (hclk) % (pclk) == 0 && RCC_IS_APB_DIV((hclk) / (pclk)))
+#define RCC_STATIC_ASSERT_CLOCKS(sysclk, hclk, pclk, hse) \
+    _Static_assert(RCC_CLOCKS_VALID(sysclk, hclk, pclk, hse), "clock tree not reachable")
+
+// Peripherals with a clock enable bit. Each ID is a bit position in a
+// peripheral set, so any group fits in one uint32_t:
+//   RCC_EnableClocks(RCC_PERIPH(PERIPH_GPIOA) | RCC_PERIPH(PERIPH_USART1));
+typedef enum {
+    PERIPH_GPIOA = 0,
+    PERIPH_GPIOB,
+    PERIPH_GPIOC,
+    PERIPH_GPIOD,
+    PERIPH_GPIOE,
+    PERIPH_GPIOF,
+    PERIPH_DMA1,
+    PERIPH_DMA2,    // For F09x only
+    PERIPH_CRC,
+    PERIPH_TSC,
+    PERIPH_TIM1,
+    PERIPH_TIM2,
+    PERIPH_TIM3,
+    PERIPH_TIM6,
+    PERIPH_TIM14,
+    PERIPH_TIM15,
+    PERIPH_TIM16,
+    PERIPH_TIM17,
+    PERIPH_USART1,
+    PERIPH_USART2,
+    PERIPH_USART3,  // For F07x/F09x only
+    PERIPH_SPI1,
+    PERIPH_SPI2,
+    PERIPH_I2C1,
+    PERIPH_I2C2,
+    PERIPH_ADC,
+    PERIPH_DAC,
+    PERIPH_USB,     // For F04x/F07x only
+    PERIPH_SYSCFG,
+    PERIPH_PWR,
+    PERIPH_WWDG,
+    PERIPH_CEC,
+    PERIPH_COUNT
+} RCC_Peripheral;
+
+#define RCC_PERIPH(p)   (1UL << (p))
+
+// Bounded waits, in polls of the ready flag (a poll is about 8 cycles, so at
+// the 8 MHz HSI 100000 polls is roughly 100 ms)
+#define RCC_OSC_STARTUP_LOOPS   5000U       // HSI/HSI48: a few microseconds
+#define RCC_HSE_STARTUP_LOOPS   100000U     // Crystal start-up, 2-10 ms typical
+#define RCC_PLL_LOCK_LOOPS      5000U       // PLL lock: under 200 us
+#define RCC_SWITCH_LOOPS        5000U       // SYSCLK switch
+
+// Non-blocking bring-up result
+typedef enum {
+    RCC_STARTUP_BUSY = 0,
+    RCC_STARTUP_DONE,        // Requested configuration running
+    RCC_STARTUP_FALLBACK,    // HSE or PLL failed; running from HSI (x PLL)
+    RCC_STARTUP_FAILED       // Could not switch at all
+} RCC_StartupStatus;
+
+// Clock change notification. PRE_CHANGE carries the clocks about to be left
+// (quiesce here); POST_CHANGE the clocks now running (recompute here).
+typedef enum {
+    RCC_CLOCK_PRE_CHANGE = 0,
+    RCC_CLOCK_POST_CHANGE
+} RCC_ClockEvent;
+
+typedef void (*RCC_ClockListener)(RCC_ClockEvent event, uint32_t hclk_hz, uint32_t pclk_hz);
+
+#define RCC_MAX_CLOCK_LISTENERS  8
+
+// Clock tree saved before STOP mode and restored on wake-up
+typedef struct {
+    uint32_t cr;
+    uint32_t cfgr;
+    uint32_t cfgr2;
+    uint32_t cfgr3;
+    uint32_t flash_acr;
+} RCC_Snapshot;
+
 // Function prototypes
-void RCC_Init(const RCC_Config *config);
-void RCC_EnableHSI(void);
-void RCC_EnableHSE(void);
-void RCC_EnablePLL(void);
-void RCC_EnableHSI48(void);  // For F04x/F07x/F09x only
+bool RCC_Init(const RCC_Config *config);
+void RCC_StartupBegin(const RCC_Config *config);
+RCC_StartupStatus RCC_StartupPoll(void);
+void RCC_GetActiveConfig(RCC_Config *config);
+void RCC_SetActiveConfig(const RCC_Config *config);
+uint32_t RCC_GetCSSEventCount(void);
+bool RCC_ServiceCSS(void);
+void RCC_SaveSnapshot(RCC_Snapshot *snapshot);
+void RCC_RestoreBegin(const RCC_Snapshot *snapshot);
+RCC_StartupStatus RCC_RestorePoll(void);
+bool RCC_RestoreComplete(void);
+uint32_t RCC_GetRestoreLatency(void);
+bool RCC_RegisterClockListener(RCC_ClockListener listener, uint8_t priority);
+bool RCC_UnregisterClockListener(RCC_ClockListener listener);
+void RCC_NotifyClockChange(RCC_ClockEvent event);
+bool RCC_SolveConfig(const RCC_ClockRequest *request, RCC_Config *config, uint8_t *flash_latency);
+uint8_t RCC_GetFlashLatency(uint32_t sysclk_hz);
+void RCC_SetFlashLatency(uint8_t latency);
+bool RCC_EnableHSI(void);
+bool RCC_EnableHSE(void);
+bool RCC_EnablePLL(void);
+bool RCC_EnableHSI48(void);  // For F04x/F07x/F09x only
 void RCC_DisableHSI(void);
 void RCC_DisableHSE(void);
-void RCC_DisablePLL(void);
+bool RCC_DisablePLL(void);
 void RCC_DisableHSI48(void); // For F04x/F07x/F09x only
-void RCC_SetSystemClockSource(ClockSource source);
+bool RCC_SetSystemClockSource(ClockSource source);
 void RCC_SetAHBPrescaler(AHBPrescaler prescaler);
 void RCC_SetAPBPrescaler(APBPrescaler prescaler);
 void RCC_SetPLLConfig(PLLSource source, uint8_t multiplier);
 uint32_t RCC_GetSystemClockFrequency(void);
-void RCC_EnablePeripheralClock(uint8_t peripheral_type, uint8_t peripheral_num);
-void RCC_DisablePeripheralClock(uint8_t peripheral_type, uint8_t peripheral_num);
-
-// Peripheral types for clock control
-#define PERIPH_GPIOA    0x01
-#define PERIPH_GPIOB    0x02
-#define PERIPH_GPIOC    0x04
-#define PERIPH_GPIOD    0x08
-#define PERIPH_GPIOE    0x10
-#define PERIPH_GPIOF    0x20
-#define PERIPH_DMA1     0x80
-#define PERIPH_DMA2     0x81  // For F09x only
-#define PERIPH_TIM1     0x90
-#define PERIPH_TIM2     0x91
-#define PERIPH_TIM3     0x92
-#define PERIPH_TIM14    0x93
-#define PERIPH_TIM15    0x94
-#define PERIPH_TIM16    0x95
-#define PERIPH_TIM17    0x96
-#define PERIPH_USART1   0xA0
-#define PERIPH_USART2   0xA1
-#define PERIPH_USART3   0xA2
-#define PERIPH_SPI1     0xB0
-#define PERIPH_SPI2     0xB1
-#define PERIPH_I2C1     0xC0
-#define PERIPH_I2C2     0xC1
-#define PERIPH_ADC      0xD0
-#define PERIPH_DAC      0xD1
-#define PERIPH_USB      0xE0  // For F04x/F07x only
+uint32_t RCC_GetHCLKFrequency(void);
+uint32_t RCC_GetPCLKFrequency(void);
+void RCC_SetHSEFrequency(uint32_t hse_hz);
+void RCC_SetHSITrim(uint8_t trim);
+uint8_t RCC_GetHSITrim(void);
+void RCC_EnableClocks(uint32_t set);
+void RCC_DisableClocks(uint32_t set);
+void RCC_ResetPeripherals(uint32_t set);
+void RCC_EnablePeripheralClock(RCC_Peripheral peripheral);
+void RCC_DisablePeripheralClock(RCC_Peripheral peripheral);
 
 #endif // RCC_H
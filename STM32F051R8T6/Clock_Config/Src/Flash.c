@@ -0,0 +1,81 @@
+#include "Flash.h"
+
+/* The status, erase and program paths run from RAM (ramfunc.h) so interrupt
+   handlers also in RAM keep running while the flash is busy */
+
+/* Current Flash operation status */
+RAMFUNC FLASH_Status_t FLASH_GetStatus(void)
+{
+    uint32_t sr = FLASH->SR;
+
+    if (sr & FLASH_SR_BSY) {
+        return FLASH_STATUS_BUSY;
+    }
+    if (sr & FLASH_SR_PGERR) {
+        return FLASH_STATUS_PROGRAM_ERROR;
+    }
+    if (sr & FLASH_SR_WRPRTERR) {
+        return FLASH_STATUS_WRITE_PROTECT_ERROR;
+    }
+    return FLASH_STATUS_READY;
+}
+
+/* Wait for the running operation, then report and clear its outcome */
+RAMFUNC static FLASH_Status_t FLASH_Finish(uint32_t cr_bit)
+{
+    FLASH_Status_t status;
+
+    FLASH_WAIT_FOR_BUSY();
+    status = FLASH_GetStatus();
+
+    CLEAR_BIT(FLASH->CR, cr_bit);
+    FLASH_CLEAR_EOP();
+    FLASH_CLEAR_ERRORS();
+    return status;
+}
+
+/* Erase the page containing page_address */
+RAMFUNC FLASH_Status_t FLASH_ErasePage(uint32_t page_address)
+{
+    FLASH_Status_t status;
+
+    FLASH_WAIT_FOR_BUSY();
+    FLASH_CLEAR_ERRORS();
+    FLASH_UNLOCK();
+
+    SET_BIT(FLASH->CR, FLASH_CR_PER);
+    FLASH->AR = page_address;
+    SET_BIT(FLASH->CR, FLASH_CR_STRT);
+    status = FLASH_Finish(FLASH_CR_PER);
+
+    FLASH_LOCK();
+    return status;
+}
+
+/* Program one half-word (the only write width the F0 flash accepts) */
+RAMFUNC FLASH_Status_t FLASH_ProgramHalfWord(uint32_t address, uint16_t data)
+{
+    FLASH_Status_t status;
+
+    FLASH_WAIT_FOR_BUSY();
+    FLASH_CLEAR_ERRORS();
+    FLASH_UNLOCK();
+
+    SET_BIT(FLASH->CR, FLASH_CR_PG);
+    *(__IO uint16_t *)(uintptr_t)address = data;
+    status = FLASH_Finish(FLASH_CR_PG);
+
+    FLASH_LOCK();
+    return status;
+}
+
+/* Program one word as two half-words, low half first */
+FLASH_Status_t FLASH_ProgramWord(uint32_t address, uint32_t data)
+{
+    FLASH_Status_t status = FLASH_ProgramHalfWord(address, (uint16_t)data);
+
+    if (status == FLASH_STATUS_READY) {
+        status = FLASH_ProgramHalfWord(address + 2, (uint16_t)(data >> 16));
+    }
+    return status;
+}
@@ -0,0 +1,142 @@
+#include "boot_profile.h"
+
+#ifdef BOOT_PROFILE
+
+#include "rcc.h"
+
+// SysTick
+#define SYST_CSR            (*(volatile uint32_t *)(SYSTICK_BASE + 0x0))
+#define SYST_RVR            (*(volatile uint32_t *)(SYSTICK_BASE + 0x4))
+#define SYST_CVR            (*(volatile uint32_t *)(SYSTICK_BASE + 0x8))
+#define SYST_CSR_ENABLE     (1U << 0)
+#define SYST_CSR_TICKINT    (1U << 1)
+#define SYST_CSR_CLKSOURCE  (1U << 2)   // 1 = HCLK
+#define SYST_RELOAD_MAX     0x00FFFFFFUL
+
+// Everything here runs before .data/.bss are set up, so all state lives in
+// this .noinit table and nothing relies on initialised statics.
+__attribute__((section(".noinit"))) Boot_Profile boot_profile;
+
+// Private: add the SysTick ticks since the last step at the current rate.
+// Steps must be less than one SysTick period apart (2 s at 8 MHz, 349 ms at
+// 48 MHz); the wrap interrupt below takes one when the boot code does not,
+// e.g. while HSICal_StartLSE() waits for the crystal.
+static void Boot_ProfileStep(void) {
+    uint32_t primask;
+
+    __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+    uint32_t now = SYST_CVR;
+    uint32_t mark = boot_profile.tick_mark;
+    uint32_t ticks = (mark >= now) ? (mark - now) : (mark + SYST_RELOAD_MAX + 1U - now);
+
+    boot_profile.elapsed_ns += ((uint64_t)ticks * 1000000000ULL) / boot_profile.tick_hz;
+    boot_profile.tick_mark = now;
+    __asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+}
+
+// SysTick wrap, taken only until the boot is profiled
+void SysTick_Handler(void) {
+    Boot_ProfileStep();
+}
+
+// Private: close the segment at the old clock, continue at the new one. The
+// transition itself is counted at the old clock, which runs for most of it.
+static void Boot_ProfileClockChanged(RCC_ClockEvent event, uint32_t hclk_hz, uint32_t pclk_hz) {
+    (void)pclk_hz;
+    Boot_ProfileStep();
+    if (event == RCC_CLOCK_POST_CHANGE) {
+        boot_profile.tick_hz = hclk_hz;
+    }
+}
+
+// Called first thing in Reset_Handler: SYSCLK is HSI at 8 MHz
+void Boot_ProfileStart(void) {
+    uint32_t i;
+
+    SYST_CSR = 0;
+    SYST_RVR = SYST_RELOAD_MAX;
+    SYST_CVR = 0;
+
+    boot_profile.magic = 0;
+    for (i = 0; i < BOOT_PHASE_COUNT; i++) {
+        boot_profile.stamp_us[i] = 0;
+    }
+    boot_profile.tick_hz = RCC_HSI_FREQUENCY;
+    boot_profile.tick_mark = 0;
+    boot_profile.listening = 0;
+    boot_profile.elapsed_ns = 0;
+
+    // Started last: the wrap interrupt steps the table set up above
+    SYST_CSR = SYST_CSR_ENABLE | SYST_CSR_TICKINT | SYST_CSR_CLKSOURCE;
+}
+
+// Stamp the end of a boot phase
+void Boot_ProfileMark(Boot_Phase phase) {
+    Boot_ProfileStep();
+    boot_profile.stamp_us[phase] = (uint32_t)(boot_profile.elapsed_ns / 1000U);
+
+    // The listener table is usable once .bss is zeroed
+    if (!boot_profile.listening && phase >= BOOT_PHASE_BSS) {
+        boot_profile.listening = RCC_RegisterClockListener(Boot_ProfileClockChanged, 0);
+    }
+    if (phase == BOOT_PHASE_READY) {
+        RCC_UnregisterClockListener(Boot_ProfileClockChanged);
+        SYST_CSR &= ~SYST_CSR_TICKINT;
+        boot_profile.listening = 0;
+        boot_profile.magic = BOOT_PROFILE_MAGIC;
+    }
+}
+
+#ifdef BOOT_PROFILE_SEMIHOSTING
+
+// Semihosting SYS_WRITE0: print a NUL-terminated string on the host console
+static void Boot_ProfileWrite(const char *text) {
+    register uint32_t r0 __asm("r0") = 0x04;
+    register const char *r1 __asm("r1") = text;
+    __asm volatile ("bkpt 0xAB" : "+r" (r0) : "r" (r1) : "memory");
+}
+
+// Print the table, one "phase: time us" line per phase
+void Boot_ProfileDump(void) {
+    static const char *const names[BOOT_PHASE_COUNT] = {
+        "SystemInit", ".data", ".bss", "ctors", "checks", "clock", "periph", "ready"
+    };
+    char line[32];
+    uint32_t i;
+
+    for (i = 0; i < BOOT_PHASE_COUNT; i++) {
+        char digits[10];
+        uint32_t value = boot_profile.stamp_us[i];
+        uint32_t n = 0;
+        uint32_t pos = 0;
+        const char *name = names[i];
+
+        while (*name != '\0' && pos < 16) {
+            line[pos++] = *name++;
+        }
+        line[pos++] = ':';
+        line[pos++] = ' ';
+        do {
+            digits[n++] = (char)('0' + value % 10U);
+            value /= 10U;
+        } while (value != 0);
+        while (n > 0) {
+            line[pos++] = digits[--n];
+        }
+        line[pos++] = ' ';
+        line[pos++] = 'u';
+        line[pos++] = 's';
+        line[pos++] = '\n';
+        line[pos] = '\0';
+        Boot_ProfileWrite(line);
+    }
+}
+
+#else
+
+void Boot_ProfileDump(void) {
+}
+
+#endif // BOOT_PROFILE_SEMIHOSTING
+
+#endif // BOOT_PROFILE
@@ -0,0 +1,209 @@
+#include "clock_governor.h"
+#include "rcc.h"
+
+// SysTick (used only to time transitions)
+#define SYST_CSR            (*(volatile uint32_t *)(SYSTICK_BASE + 0x0))
+#define SYST_RVR            (*(volatile uint32_t *)(SYSTICK_BASE + 0x4))
+#define SYST_CVR            (*(volatile uint32_t *)(SYSTICK_BASE + 0x8))
+#define SYST_CSR_ENABLE     (1U << 0)
+#define SYST_CSR_CLKSOURCE  (1U << 2)   // 1 = HCLK, 0 = HCLK/8
+#define SYST_RELOAD_MAX     0x00FFFFFFUL
+
+// Operating point table: SYSCLK and PLL multiplier on HSI/2 (0 = HSI direct)
+static const struct {
+    uint32_t sysclk_hz;
+    uint8_t pll_multiplier;
+} governor_opps[GOVERNOR_OPP_COUNT] = {
+    {  8000000UL,  0 },
+    { 24000000UL,  6 },
+    { 32000000UL,  8 },
+    { 48000000UL, 12 },
+};
+
+static Governor_OPP governor_opp = GOVERNOR_OPP_8MHZ;
+static Governor_Stats governor_stats;
+
+// Transition timer state
+static uint32_t governor_tick_mark;
+static uint32_t governor_tick_hclk;     // HCLK since the last mark
+static uint64_t governor_elapsed_ns;
+
+// Start timing (no-op when SysTick is stopped, see Governor_Init)
+static void Governor_TimerStart(void) {
+    governor_elapsed_ns = 0;
+    governor_tick_mark = SYST_CVR;
+    governor_tick_hclk = RCC_GetHCLKFrequency();
+}
+
+// Add the SysTick ticks since the last mark, counted at the HCLK saved at
+// that mark (the clock that ran during the step). Call right after every
+// change to HCLK; the new HCLK is saved for the next step.
+static void Governor_TimerStep(void) {
+    uint32_t now = SYST_CVR;
+    uint32_t csr = SYST_CSR;
+    uint32_t tick_hz = governor_tick_hclk;
+    uint32_t ticks;
+
+    governor_tick_hclk = RCC_GetHCLKFrequency();
+    if (!(csr & SYST_CSR_ENABLE) || tick_hz == 0) {
+        return;
+    }
+    if (!(csr & SYST_CSR_CLKSOURCE)) {
+        tick_hz /= 8;
+    }
+
+    // Down-counter, at most one reload during a step
+    ticks = (governor_tick_mark >= now) ? (governor_tick_mark - now)
+                                        : (governor_tick_mark + (SYST_RVR + 1U) - now);
+    governor_elapsed_ns += ((uint64_t)ticks * 1000000000ULL) / tick_hz;
+    governor_tick_mark = now;
+}
+
+// Private: true if the clock tree in CFGR is the one the operating point
+// sets up (SWS, PLL source and multiplier, both prescalers at 1). RCC_Init or
+// the CSS fallback may have changed it since the governor last ran.
+static bool Governor_IsRunning(Governor_OPP opp) {
+    uint32_t cfgr = RCC_CFGR;
+    uint8_t multiplier = governor_opps[opp].pll_multiplier;
+
+    if (cfgr & ((0xFU << 4) | (7U << 8))) {
+        return false;
+    }
+    if (multiplier == 0) {
+        return ((cfgr >> 2) & 3) == CLOCK_SOURCE_HSI;
+    }
+    return ((cfgr >> 2) & 3) == CLOCK_SOURCE_PLL &&
+           ((cfgr >> 15) & 3) == 0 &&
+           ((cfgr >> 18) & 0xF) == (uint32_t)(multiplier - 2U);
+}
+
+// Private: record the operating point as RCC's active configuration, so
+// RCC_GetActiveConfig() and the CSS fallback see it
+static void Governor_SetActiveConfig(Governor_OPP opp) {
+    RCC_Config config = {
+        .system_clock_source = governor_opps[opp].pll_multiplier ? CLOCK_SOURCE_PLL : CLOCK_SOURCE_HSI,
+        .target_frequency = (SystemClockFreq)governor_opps[opp].sysclk_hz,
+        .hse_enabled = false,
+        .pll_enabled = governor_opps[opp].pll_multiplier != 0,
+        .pll_source = PLL_SOURCE_HSI_DIV2,
+        .pll_multiplier = governor_opps[opp].pll_multiplier ? governor_opps[opp].pll_multiplier : 2,
+        .pll_prediv = 1,
+        .ahb_prescaler = AHB_PRESCALER_1,
+        .apb_prescaler = APB_PRESCALER_1,
+        .hsi48_enabled = false,
+        .css_enabled = false
+    };
+
+    RCC_SetActiveConfig(&config);
+}
+
+// Start at the 8 MHz operating point. Transitions are timed with SysTick:
+// if nothing has started it, it is left free-running from HCLK (no
+// interrupt), otherwise it is used as configured.
+void Governor_Init(void) {
+    if (!(SYST_CSR & SYST_CSR_ENABLE)) {
+        SYST_RVR = SYST_RELOAD_MAX;
+        SYST_CVR = 0;
+        SYST_CSR = SYST_CSR_ENABLE | SYST_CSR_CLKSOURCE;
+    }
+
+    governor_opp = GOVERNOR_OPP_COUNT;   // Force a full transition
+    Governor_SetOPP(GOVERNOR_OPP_8MHZ);
+}
+
+// Switch to an operating point. Returns false for an unknown one, if HSI
+// does not start (nothing is changed), or if the PLL did not lock (the clock
+// is then left at the 8 MHz point). Once PRE_CHANGE has gone out, every
+// path ends with POST_CHANGE. Asking for the current point does nothing
+// unless the clock tree no longer matches it.
+bool Governor_SetOPP(Governor_OPP opp) {
+    uint8_t latency;
+    uint8_t old_latency;
+    bool result = true;
+
+    if (opp >= GOVERNOR_OPP_COUNT) {
+        return false;
+    }
+    if (opp == governor_opp && Governor_IsRunning(opp)) {
+        return true;
+    }
+
+    // HSI must be on for the intermediate step and for PLL input. Checked
+    // before anything changes, so a failure needs no undo.
+    if (!RCC_EnableHSI()) {
+        return false;
+    }
+
+    latency = RCC_GetFlashLatency(governor_opps[opp].sysclk_hz);
+    old_latency = RCC_GetFlashLatency(RCC_GetSystemClockFrequency());
+    RCC_NotifyClockChange(RCC_CLOCK_PRE_CHANGE);
+    Governor_TimerStart();
+
+    // Speeding up: wait states first
+    if (latency > old_latency) {
+        RCC_SetFlashLatency(latency);
+    }
+
+    RCC_SetAHBPrescaler(AHB_PRESCALER_1);
+    RCC_SetAPBPrescaler(APB_PRESCALER_1);
+    Governor_TimerStep();
+
+    if (governor_opps[opp].pll_multiplier == 0) {
+        RCC_SetSystemClockSource(CLOCK_SOURCE_HSI);
+        Governor_TimerStep();
+        RCC_DisablePLL();
+    } else {
+        // The PLL cannot be reprogrammed while it drives SYSCLK
+        if (((RCC_CFGR >> 2) & 3) == CLOCK_SOURCE_PLL) {
+            RCC_SetSystemClockSource(CLOCK_SOURCE_HSI);
+            Governor_TimerStep();
+        }
+        RCC_DisablePLL();
+        RCC_SetPLLConfig(PLL_SOURCE_HSI_DIV2, governor_opps[opp].pll_multiplier);
+        if (!RCC_EnablePLL() || !RCC_SetSystemClockSource(CLOCK_SOURCE_PLL)) {
+            // No lock: stay on HSI at the 8 MHz point
+            RCC_SetSystemClockSource(CLOCK_SOURCE_HSI);
+            RCC_DisablePLL();
+            opp = GOVERNOR_OPP_8MHZ;
+            if (latency > old_latency) {
+                old_latency = latency;       // Raised above: lower it again
+            }
+            latency = RCC_GetFlashLatency(governor_opps[opp].sysclk_hz);
+            result = false;
+        }
+        Governor_TimerStep();
+    }
+
+    // Slowing down: wait states last
+    if (latency < old_latency) {
+        RCC_SetFlashLatency(latency);
+    }
+    Governor_TimerStep();
+
+    governor_opp = opp;
+    Governor_SetActiveConfig(opp);
+    governor_stats.transitions++;
+    governor_stats.last_transition_us = (uint32_t)(governor_elapsed_ns / 1000U);
+    if (governor_stats.last_transition_us > governor_stats.max_transition_us) {
+        governor_stats.max_transition_us = governor_stats.last_transition_us;
+    }
+
+    RCC_NotifyClockChange(RCC_CLOCK_POST_CHANGE);
+
+    return result;
+}
+
+// Current operating point
+Governor_OPP Governor_GetOPP(void) {
+    return governor_opp;
+}
+
+// SYSCLK of an operating point (0 if unknown)
+uint32_t Governor_GetOPPFrequency(Governor_OPP opp) {
+    return (opp < GOVERNOR_OPP_COUNT) ? governor_opps[opp].sysclk_hz : 0;
+}
+
+// Copy the transition statistics
+void Governor_GetStats(Governor_Stats *stats) {
+    *stats = governor_stats;
+}
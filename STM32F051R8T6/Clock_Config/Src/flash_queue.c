@@ -0,0 +1,186 @@
+#include "flash_queue.h"
+#include "device_profile.h"
+#include "ramfunc.h"
+#include <stddef.h>
+
+// NVIC (HOST_SIM builds use a simulated register block)
+#ifndef HOST_SIM
+#define NVIC_BASE           0xE000E100UL
+#endif
+#define NVIC_ISER           (*(volatile uint32_t *)(NVIC_BASE + 0x0))
+#define FLASH_IRQn          3
+
+#define FLASH_QUEUE_CR_OPS  (FLASH_CR_PG | FLASH_CR_PER)
+#define FLASH_QUEUE_CR_IE   (FLASH_CR_EOPIE | FLASH_CR_ERRIE)
+#define FLASH_QUEUE_SR_ALL  (FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR)
+
+static FlashQueue_Job *flash_queue[FLASH_QUEUE_DEPTH];
+static volatile uint8_t flash_queue_head;
+static volatile uint8_t flash_queue_count;
+static uint32_t flash_queue_address;    // Target of the running operation
+static uint16_t flash_queue_half;       // Half-word being programmed
+
+// Private: interrupts off, returning the previous PRIMASK. Host tests call
+// FLASH_IRQHandler from the same thread, so there is nothing to mask.
+static uint32_t FlashQueue_Lock(void) {
+    uint32_t primask = 0;
+
+#ifndef HOST_SIM
+    __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+#endif
+    return primask;
+}
+
+static void FlashQueue_Unlock(uint32_t primask) {
+#ifndef HOST_SIM
+    __asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+#else
+    (void)primask;
+#endif
+}
+
+// Private: start the operation at the job's current position
+RAMFUNC static void FlashQueue_Start(FlashQueue_Job *job) {
+    const FlashQueue_Step *step = &job->steps[job->step];
+
+    if (step->type == FLASH_STEP_ERASE) {
+        flash_queue_address = step->address + job->offset * DEVICE_FLASH_PAGE_SIZE;
+        MODIFY_REG(FLASH->CR, FLASH_QUEUE_CR_OPS, FLASH_CR_PER);
+        FLASH->AR = flash_queue_address;
+        SET_BIT(FLASH->CR, FLASH_CR_STRT);
+    } else {
+        const uint8_t *data = (const uint8_t *)step->data + job->offset;
+
+        flash_queue_address = step->address + job->offset;
+        flash_queue_half = data[0];
+        flash_queue_half |= (job->offset + 1U < step->count) ? (uint16_t)(data[1] << 8) : 0xFF00U;
+        MODIFY_REG(FLASH->CR, FLASH_QUEUE_CR_OPS, FLASH_CR_PG);
+        *(__IO uint16_t *)(uintptr_t)flash_queue_address = flash_queue_half;
+    }
+}
+
+// Private: unlock and start the first operation of the job at the head
+static void FlashQueue_Begin(void) {
+    FLASH->SR = FLASH_QUEUE_SR_ALL;
+    FLASH_UNLOCK();
+    SET_BIT(FLASH->CR, FLASH_QUEUE_CR_IE);
+    FlashQueue_Start(flash_queue[flash_queue_head]);
+}
+
+// Private: step past the finished operation. False once the job is done.
+RAMFUNC static bool FlashQueue_Advance(FlashQueue_Job *job) {
+    const FlashQueue_Step *step = &job->steps[job->step];
+
+    job->offset += (step->type == FLASH_STEP_ERASE) ? 1U : 2U;
+    if (job->offset >= step->count) {
+        job->step++;
+        job->offset = 0;
+    }
+    return job->step < job->step_count;
+}
+
+// Private: retire the head job, start the next one, then report. The
+// callback may submit another job.
+RAMFUNC static void FlashQueue_Finish(FlashQueue_Job *job, FLASH_Status_t status) {
+    CLEAR_BIT(FLASH->CR, FLASH_QUEUE_CR_OPS);
+    if (status != FLASH_STATUS_READY) {
+        job->fail_address = flash_queue_address;
+    }
+
+    flash_queue_head = (flash_queue_head + 1U == FLASH_QUEUE_DEPTH) ? 0U : (uint8_t)(flash_queue_head + 1U);
+    flash_queue_count--;
+    if (flash_queue_count > 0) {
+        FlashQueue_Start(flash_queue[flash_queue_head]);
+    } else {
+        CLEAR_BIT(FLASH->CR, FLASH_QUEUE_CR_IE);
+        FLASH_LOCK();
+    }
+
+    job->status = status;
+    if (job->callback != NULL) {
+        job->callback(job);
+    }
+}
+
+// Private: steps are non-empty, program steps are aligned and have data
+static bool FlashQueue_Valid(const FlashQueue_Job *job) {
+    uint8_t i;
+
+    if (job == NULL || job->steps == NULL || job->step_count == 0) {
+        return false;
+    }
+    for (i = 0; i < job->step_count; i++) {
+        const FlashQueue_Step *step = &job->steps[i];
+
+        if (step->count == 0 ||
+            (step->type == FLASH_STEP_PROGRAM && (step->data == NULL || (step->address & 1U)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Queue a job. Returns false if the queue is full or the job is invalid;
+// otherwise job->status stays FLASH_STATUS_BUSY until it completes.
+bool FlashQueue_Submit(FlashQueue_Job *job) {
+    uint32_t primask;
+    uint8_t slot;
+
+    if (!FlashQueue_Valid(job)) {
+        return false;
+    }
+    job->status = FLASH_STATUS_BUSY;
+    job->fail_address = 0;
+    job->step = 0;
+    job->offset = 0;
+
+    primask = FlashQueue_Lock();
+    if (flash_queue_count == FLASH_QUEUE_DEPTH) {
+        FlashQueue_Unlock(primask);
+        return false;
+    }
+    slot = flash_queue_head + flash_queue_count;
+    if (slot >= FLASH_QUEUE_DEPTH) {
+        slot -= FLASH_QUEUE_DEPTH;
+    }
+    flash_queue[slot] = job;
+    flash_queue_count++;
+
+    NVIC_ISER = (1U << FLASH_IRQn);
+    if (flash_queue_count == 1U) {
+        FlashQueue_Begin();
+    }
+    FlashQueue_Unlock(primask);
+    return true;
+}
+
+// True while any job is queued or running
+bool FlashQueue_IsBusy(void) {
+    return flash_queue_count != 0;
+}
+
+// End of operation or error: check the result, then start the next one.
+// Runs from RAM with its helpers, so it gets out of the way of the operation
+// it has just started instead of waiting on it.
+RAMFUNC void FLASH_IRQHandler(void) {
+    uint32_t sr = FLASH->SR;
+    FlashQueue_Job *job;
+
+    FLASH->SR = sr & FLASH_QUEUE_SR_ALL;
+    if (flash_queue_count == 0 || (sr & FLASH_SR_BSY)) {
+        return;
+    }
+    job = flash_queue[flash_queue_head];
+
+    if (sr & FLASH_SR_WRPRTERR) {
+        FlashQueue_Finish(job, FLASH_STATUS_WRITE_PROTECT_ERROR);
+    } else if ((sr & FLASH_SR_PGERR) ||
+               (job->steps[job->step].type == FLASH_STEP_PROGRAM &&
+                *(__IO uint16_t *)(uintptr_t)flash_queue_address != flash_queue_half)) {
+        FlashQueue_Finish(job, FLASH_STATUS_PROGRAM_ERROR);
+    } else if (FlashQueue_Advance(job)) {
+        FlashQueue_Start(job);
+    } else {
+        FlashQueue_Finish(job, FLASH_STATUS_READY);
+    }
+}
@@ -0,0 +1,303 @@
+#include "hsi_calib.h"
+#include "rcc.h"
+#include "Flash.h"
+
+// TIM14 (input capture on CH1)
+#define TIM14_BASE          0x40002000UL
+#define TIM14_CR1           (*(volatile uint32_t *)(TIM14_BASE + 0x00))
+#define TIM14_SR            (*(volatile uint32_t *)(TIM14_BASE + 0x10))
+#define TIM14_EGR           (*(volatile uint32_t *)(TIM14_BASE + 0x14))
+#define TIM14_CCMR1         (*(volatile uint32_t *)(TIM14_BASE + 0x18))
+#define TIM14_CCER          (*(volatile uint32_t *)(TIM14_BASE + 0x20))
+#define TIM14_PSC           (*(volatile uint32_t *)(TIM14_BASE + 0x28))
+#define TIM14_ARR           (*(volatile uint32_t *)(TIM14_BASE + 0x2C))
+#define TIM14_CCR1          (*(volatile uint32_t *)(TIM14_BASE + 0x34))
+#define TIM14_OR            (*(volatile uint32_t *)(TIM14_BASE + 0x50))
+
+#define TIM_CR1_CEN         (1U << 0)
+#define TIM_SR_CC1IF        (1U << 1)
+#define TIM_EGR_UG          (1U << 0)
+#define TIM_CCMR1_CC1S_TI1  (1U << 0)
+#define TIM_CCMR1_IC1PSC_8  (3U << 2)    // Capture every 8th edge
+#define TIM_CCER_CC1E       (1U << 0)
+#define TIM14_OR_RMP_GPIO   0U
+#define TIM14_OR_RMP_RTCCLK 1U
+
+#define HSICAL_EDGES_PER_CAPTURE  8U
+
+// PWR (backup domain write access for LSE)
+#define PWR_CR              (*(volatile uint32_t *)0x40007000UL)
+#define PWR_CR_DBP          (1U << 8)
+
+// RCC_BDCR bits
+#define RCC_BDCR_LSEON      (1U << 0)
+#define RCC_BDCR_LSERDY     (1U << 1)
+#define RCC_BDCR_RTCSEL     (3U << 8)
+#define RCC_BDCR_RTCSEL_LSE (1U << 8)
+
+// Stored trim records: the last flash page, reserved as CALIB in the linker
+// script. Records are appended until the page is full, so the page is only
+// erased once every 256 saves. The newest valid record wins; the "no
+// reference" marker is a record with a trim field no trim can have.
+#define HSICAL_FLASH_ADDRESS  (FLASH_BASE_ADDRESS + DEVICE_FLASH_SIZE - DEVICE_FLASH_PAGE_SIZE)
+#define HSICAL_RECORDS        (DEVICE_FLASH_PAGE_SIZE / 4U)
+#define HSICAL_MAGIC          0xCA1BU
+#define HSICAL_ERASED         0xFFFFFFFFUL
+#define HSICAL_RECORD(trim)   (((uint32_t)(((~(trim) & 0xFFU) << 8) | (trim)) << 16) | HSICAL_MAGIC)
+#define HSICAL_NO_REF_TRIM    0xFFU      // Trim field of the "no reference" marker
+
+static int32_t hsical_error_ppm;
+
+// Private: SYSCLK comes from HSI (directly or HSI/2 into the PLL)
+static bool HSICal_RunningOnHSI(void) {
+    uint32_t cfgr = RCC_CFGR;
+    uint32_t sws = (cfgr >> 2) & 3;
+
+    return sws == CLOCK_SOURCE_HSI ||
+           (sws == CLOCK_SOURCE_PLL && ((cfgr >> 15) & 3) == 0);
+}
+
+// Private: TIM14 kernel clock (x2 when the APB prescaler divides)
+static uint32_t HSICal_TimerClock(void) {
+    uint32_t pclk = RCC_GetPCLKFrequency();
+
+    return (RCC_CFGR & (1U << 10)) ? pclk * 2 : pclk;
+}
+
+// Private: start LSE and route it to RTCCLK
+static bool HSICal_StartLSE(void) {
+    uint32_t loops = HSICAL_LSE_STARTUP_LOOPS;
+
+    RCC_EnableClocks(RCC_PERIPH(PERIPH_PWR));
+    PWR_CR |= PWR_CR_DBP;
+
+    // RTCSEL can only be changed by a backup domain reset: accept LSE or unset
+    if ((RCC_BDCR & RCC_BDCR_RTCSEL) != 0 &&
+        (RCC_BDCR & RCC_BDCR_RTCSEL) != RCC_BDCR_RTCSEL_LSE) {
+        return false;
+    }
+
+    // No crystal: stop the oscillator rather than leave it driving the pins
+    RCC_BDCR |= RCC_BDCR_LSEON;
+    while (!(RCC_BDCR & RCC_BDCR_LSERDY)) {
+        if (loops-- == 0) {
+            RCC_BDCR &= ~RCC_BDCR_LSEON;
+            return false;
+        }
+    }
+    RCC_BDCR |= RCC_BDCR_RTCSEL_LSE;
+    return true;
+}
+
+// Private: wait for the next capture
+static bool HSICal_WaitCapture(uint16_t *capture) {
+    uint32_t loops = HSICAL_CAPTURE_LOOPS;
+
+    while (!(TIM14_SR & TIM_SR_CC1IF)) {
+        if (loops-- == 0) {
+            return false;
+        }
+    }
+    *capture = (uint16_t)TIM14_CCR1;   // Reading CCR1 clears CC1IF
+    return true;
+}
+
+// Private: timer ticks over HSICAL_CAPTURES captures. The first capture
+// after a trim change is dropped because it straddles the change.
+static bool HSICal_Measure(uint32_t *ticks) {
+    uint16_t previous;
+    uint16_t now;
+    uint32_t i;
+
+    *ticks = 0;
+    if (!HSICal_WaitCapture(&previous) || !HSICal_WaitCapture(&previous)) {
+        return false;
+    }
+    for (i = 0; i < HSICAL_CAPTURES; i++) {
+        if (!HSICal_WaitCapture(&now)) {
+            return false;
+        }
+        *ticks += (uint16_t)(now - previous);
+        previous = now;
+    }
+    return true;
+}
+
+// Calibrate HSI against a reference of reference_hz. SYSCLK must come from
+// HSI, since the timer counts HSI-derived ticks. Steps HSITRIM one code at a
+// time towards the reference and keeps the code with the smallest error.
+// The factory trim is restored if the reference fails.
+HSICal_Status HSICal_Calibrate(HSICal_Reference reference, uint32_t reference_hz) {
+    HSICal_Status status = HSICAL_OK;
+    uint8_t start_trim = RCC_GetHSITrim();
+    uint8_t trim = start_trim;
+    uint8_t best_trim = start_trim;
+    int32_t best_error = INT32_MAX;
+    int32_t previous_error = 0;
+    uint32_t timer_hz = HSICal_TimerClock();
+    uint32_t prescaler;
+    uint32_t expected;
+    uint32_t step;
+
+    if (!HSICal_RunningOnHSI()) {
+        return HSICAL_NOT_ON_HSI;
+    }
+    if (reference == HSICAL_REF_LSE) {
+        reference_hz = HSICAL_LSE_FREQUENCY;
+        if (!HSICal_StartLSE()) {
+            return HSICAL_NO_REFERENCE;
+        }
+    }
+    if (reference_hz == 0 || reference_hz > timer_hz / 16) {
+        return HSICAL_NO_REFERENCE;
+    }
+
+    // Keep one capture interval under half the 16-bit counter range
+    prescaler = (timer_hz / reference_hz * HSICAL_EDGES_PER_CAPTURE) / 0x8000U;
+    expected = (timer_hz / (prescaler + 1U)) * (HSICAL_EDGES_PER_CAPTURE * HSICAL_CAPTURES) /
+               reference_hz;
+
+    RCC_EnableClocks(RCC_PERIPH(PERIPH_TIM14));
+    TIM14_CR1 = 0;
+    TIM14_OR = (reference == HSICAL_REF_LSE) ? TIM14_OR_RMP_RTCCLK : TIM14_OR_RMP_GPIO;
+    TIM14_PSC = prescaler;
+    TIM14_ARR = 0xFFFFU;
+    TIM14_CCMR1 = TIM_CCMR1_CC1S_TI1 | TIM_CCMR1_IC1PSC_8;
+    TIM14_CCER = TIM_CCER_CC1E;
+    TIM14_EGR = TIM_EGR_UG;
+    TIM14_SR = 0;
+    TIM14_CR1 = TIM_CR1_CEN;
+
+    for (step = 0; step < HSICAL_MAX_STEPS; step++) {
+        uint32_t ticks;
+        int32_t error;
+
+        if (!HSICal_Measure(&ticks)) {
+            status = HSICAL_NO_REFERENCE;
+            best_trim = start_trim;
+            break;
+        }
+
+        // More ticks than expected: HSI is fast
+        error = (int32_t)ticks - (int32_t)expected;
+        if ((error < 0 ? -error : error) < (best_error < 0 ? -best_error : best_error)) {
+            best_error = error;
+            best_trim = trim;
+        }
+
+        // Done once the error is nulled or changes sign
+        if (error == 0 || (step > 0 && (error < 0) != (previous_error < 0))) {
+            break;
+        }
+        previous_error = error;
+
+        if ((error > 0 && trim == 0) || (error < 0 && trim == RCC_HSI_TRIM_MAX)) {
+            status = HSICAL_OUT_OF_RANGE;
+            break;
+        }
+        trim = (error > 0) ? trim - 1 : trim + 1;
+        RCC_SetHSITrim(trim);
+    }
+
+    TIM14_CR1 = 0;
+    TIM14_CCER = 0;
+    RCC_DisableClocks(RCC_PERIPH(PERIPH_TIM14));
+
+    RCC_SetHSITrim(best_trim);
+    hsical_error_ppm = (status == HSICAL_NO_REFERENCE) ? 0 :
+                       (int32_t)(((int64_t)best_error * 1000000) / (int32_t)expected);
+    return status;
+}
+
+// Apply a measurement made against an external time base, e.g. a host sync
+// frame of known length timed with an HSI-derived timer. Moves HSITRIM by
+// the number of steps that best cancels the error in one go.
+HSICal_Status HSICal_ApplyMeasurement(uint32_t measured_ticks, uint32_t expected_ticks) {
+    int32_t trim = RCC_GetHSITrim();
+    int64_t error_hz;
+    int32_t steps;
+
+    if (expected_ticks == 0) {
+        return HSICAL_NO_REFERENCE;
+    }
+
+    error_hz = ((int64_t)measured_ticks - (int64_t)expected_ticks) * (int64_t)RCC_HSI_FREQUENCY /
+               (int64_t)expected_ticks;
+    steps = (int32_t)((error_hz + (error_hz < 0 ? -(int64_t)RCC_HSI_TRIM_STEP_HZ / 2
+                                                : (int64_t)RCC_HSI_TRIM_STEP_HZ / 2)) /
+                      (int64_t)RCC_HSI_TRIM_STEP_HZ);
+    hsical_error_ppm = (int32_t)(error_hz * 1000000 / (int64_t)RCC_HSI_FREQUENCY);
+
+    trim -= steps;   // HSI fast: lower the trim
+    if (trim < 0 || trim > (int32_t)RCC_HSI_TRIM_MAX) {
+        RCC_SetHSITrim(trim < 0 ? 0 : RCC_HSI_TRIM_MAX);
+        return HSICAL_OUT_OF_RANGE;
+    }
+    RCC_SetHSITrim((uint8_t)trim);
+    return HSICAL_OK;
+}
+
+// Residual error of the last calibration, in ppm (positive = HSI fast)
+int32_t HSICal_GetErrorPPM(void) {
+    return hsical_error_ppm;
+}
+
+// Load the stored trim, if the newest record is one
+HSICal_Saved HSICal_LoadSaved(void) {
+    const volatile uint32_t *records = (const volatile uint32_t *)HSICAL_FLASH_ADDRESS;
+    HSICal_Saved saved = HSICAL_SAVED_NONE;
+    uint8_t saved_trim = 0;
+    uint32_t i;
+
+    for (i = 0; i < HSICAL_RECORDS && records[i] != HSICAL_ERASED; i++) {
+        uint8_t trim = (uint8_t)(records[i] >> 16);
+
+        if (records[i] != HSICAL_RECORD(trim)) {
+            continue;
+        }
+        if (trim <= RCC_HSI_TRIM_MAX) {
+            saved = HSICAL_SAVED_TRIM;
+            saved_trim = trim;
+        } else if (trim == HSICAL_NO_REF_TRIM) {
+            saved = HSICAL_SAVED_NO_REFERENCE;
+        }
+    }
+    if (saved == HSICAL_SAVED_TRIM) {
+        RCC_SetHSITrim(saved_trim);
+    }
+    return saved;
+}
+
+// Private: append a record (skipped when it is already the newest)
+static HSICal_Status HSICal_Append(uint32_t record) {
+    const volatile uint32_t *records = (const volatile uint32_t *)HSICAL_FLASH_ADDRESS;
+    uint32_t slot = 0;
+
+    while (slot < HSICAL_RECORDS && records[slot] != HSICAL_ERASED) {
+        slot++;
+    }
+    if (slot > 0 && records[slot - 1] == record) {
+        return HSICAL_OK;
+    }
+    if (slot == HSICAL_RECORDS) {
+        if (FLASH_ErasePage(HSICAL_FLASH_ADDRESS) != FLASH_STATUS_READY) {
+            return HSICAL_FLASH_ERROR;
+        }
+        slot = 0;
+    }
+
+    if (FLASH_ProgramWord(HSICAL_FLASH_ADDRESS + slot * 4U, record) != FLASH_STATUS_READY) {
+        return HSICAL_FLASH_ERROR;
+    }
+    return HSICAL_OK;
+}
+
+// Store the current trim
+HSICal_Status HSICal_Save(void) {
+    return HSICal_Append(HSICAL_RECORD(RCC_GetHSITrim()));
+}
+
+// Record that the reference is missing, so later boots skip calibration
+HSICal_Status HSICal_SaveNoReference(void) {
+    return HSICal_Append(HSICAL_RECORD(HSICAL_NO_REF_TRIM));
+}
@@ -0,0 +1,147 @@
+#include "image_crc.h"
+#include "rcc.h"
+
+// CRC and DMA1 base addresses (HOST_SIM builds use simulated register blocks)
+#ifndef HOST_SIM
+#define CRC_BASE            0x40023000UL
+#define DMA1_BASE           0x40020000UL
+#endif
+
+// CRC registers
+#define CRC_DR              (*(volatile uint32_t *)(CRC_BASE + 0x00))
+#define CRC_CR              (*(volatile uint32_t *)(CRC_BASE + 0x08))
+#define CRC_INIT            (*(volatile uint32_t *)(CRC_BASE + 0x10))
+#define CRC_CR_RESET        (1U << 0)   // Load CRC_INIT into CRC_DR
+#define CRC_INIT_DEFAULT    0xFFFFFFFFUL
+
+// DMA1 registers (channel 1, memory-to-memory)
+#define DMA1_ISR            (*(volatile uint32_t *)(DMA1_BASE + 0x00))
+#define DMA1_IFCR           (*(volatile uint32_t *)(DMA1_BASE + 0x04))
+#define DMA1_CCR1           (*(volatile uint32_t *)(DMA1_BASE + 0x08))
+#define DMA1_CNDTR1         (*(volatile uint32_t *)(DMA1_BASE + 0x0C))
+#define DMA1_CPAR1          (*(volatile uint32_t *)(DMA1_BASE + 0x10))
+#define DMA1_CMAR1          (*(volatile uint32_t *)(DMA1_BASE + 0x14))
+
+// DMA_CCR bits
+#define DMA_CCR_EN          (1U << 0)
+#define DMA_CCR_DIR         (1U << 4)   // Read from memory (CMAR), write CPAR
+#define DMA_CCR_MINC        (1U << 7)
+#define DMA_CCR_PSIZE_32    (2U << 8)
+#define DMA_CCR_MSIZE_32    (2U << 10)
+#define DMA_CCR_MEM2MEM     (1U << 14)
+
+// DMA_ISR/IFCR flags for channel 1
+#define DMA_GIF1            (1U << 0)
+#define DMA_TCIF1           (1U << 1)
+#define DMA_HTIF1           (1U << 2)
+#define DMA_TEIF1           (1U << 3)
+
+// Integrity record at the end of FLASH (.image_crc in the linker script)
+typedef struct {
+    uint32_t length;        // Image bytes covered, from the linker
+    uint32_t crc;           // Patched in after the build
+} ImageCRC_Record;
+
+extern const ImageCRC_Record _simage_crc;
+extern const uint32_t g_pfnVectors[];   // Image start
+
+// Placeholder for the CRC word, replaced by the post-build step
+__attribute__((section(".image_crc"), used))
+const uint32_t image_crc_value = IMAGE_CRC_UNSET;
+
+static uint32_t crc_bg_offset;      // Bytes checked in the current pass
+static uint32_t crc_bg_running;     // CRC so far, reloaded through CRC_INIT
+static uint32_t crc_bg_chunk;       // Bytes in flight, 0 when idle
+static uint32_t crc_bg_passes;
+
+// Private: stream words from address into CRC_DR, starting from initial
+static void ImageCRC_Start(uint32_t address, uint32_t words, uint32_t initial) {
+    RCC_EnableClocks(RCC_PERIPH(PERIPH_CRC) | RCC_PERIPH(PERIPH_DMA1));
+
+    CRC_INIT = initial;
+    CRC_CR = CRC_CR_RESET;
+
+    DMA1_CCR1 = 0;
+    DMA1_IFCR = DMA_GIF1 | DMA_TCIF1 | DMA_HTIF1 | DMA_TEIF1;
+    DMA1_CPAR1 = (uint32_t)(uintptr_t)&CRC_DR;
+    DMA1_CMAR1 = address;
+    DMA1_CNDTR1 = words;
+    DMA1_CCR1 = DMA_CCR_MEM2MEM | DMA_CCR_DIR | DMA_CCR_MINC |
+                DMA_CCR_PSIZE_32 | DMA_CCR_MSIZE_32 | DMA_CCR_EN;
+}
+
+// Private: stop the channel and clear its flags
+static void ImageCRC_Stop(void) {
+    DMA1_CCR1 = 0;
+    DMA1_IFCR = DMA_GIF1 | DMA_TCIF1 | DMA_HTIF1 | DMA_TEIF1;
+}
+
+// CRC of length bytes (a multiple of 4, up to 256 KB) at address. Blocks
+// until the DMA is done; a background chunk in flight is dropped and redone
+// on the next step.
+uint32_t ImageCRC_Compute(uint32_t address, uint32_t length) {
+    uint32_t crc;
+
+    crc_bg_chunk = 0;
+    ImageCRC_Start(address, length / 4U, CRC_INIT_DEFAULT);
+    while (!(DMA1_ISR & (DMA_TCIF1 | DMA_TEIF1)));
+    crc = CRC_DR;
+    ImageCRC_Stop();
+    return crc;
+}
+
+// Check the whole image (boot)
+ImageCRC_Status ImageCRC_Verify(void) {
+    if (_simage_crc.crc == IMAGE_CRC_UNSET) {
+        return IMAGE_CRC_NOT_SET;
+    }
+    if (ImageCRC_Compute((uint32_t)(uintptr_t)g_pfnVectors, _simage_crc.length) != _simage_crc.crc) {
+        return IMAGE_CRC_MISMATCH;
+    }
+    return IMAGE_CRC_OK;
+}
+
+// Advance the background check by one chunk. Returns IMAGE_CRC_BUSY until
+// a pass ends, then its result; the next call starts a new pass.
+ImageCRC_Status ImageCRC_BackgroundStep(void) {
+    uint32_t length = _simage_crc.length;
+    uint32_t chunk;
+
+    if (_simage_crc.crc == IMAGE_CRC_UNSET) {
+        return IMAGE_CRC_NOT_SET;
+    }
+
+    if (crc_bg_chunk != 0) {
+        if (!(DMA1_ISR & (DMA_TCIF1 | DMA_TEIF1))) {
+            return IMAGE_CRC_BUSY;
+        }
+        crc_bg_running = CRC_DR;
+        ImageCRC_Stop();
+        crc_bg_offset += crc_bg_chunk;
+        crc_bg_chunk = 0;
+
+        if (crc_bg_offset >= length) {
+            bool match = (crc_bg_running == _simage_crc.crc);
+
+            crc_bg_offset = 0;
+            crc_bg_passes++;
+            return match ? IMAGE_CRC_OK : IMAGE_CRC_MISMATCH;
+        }
+    }
+
+    if (crc_bg_offset == 0) {
+        crc_bg_running = CRC_INIT_DEFAULT;
+    }
+    chunk = length - crc_bg_offset;
+    if (chunk > IMAGE_CRC_CHUNK) {
+        chunk = IMAGE_CRC_CHUNK;
+    }
+    ImageCRC_Start((uint32_t)(uintptr_t)g_pfnVectors + crc_bg_offset, chunk / 4U, crc_bg_running);
+    crc_bg_chunk = chunk;
+    return IMAGE_CRC_BUSY;
+}
+
+// Completed background passes
+uint32_t ImageCRC_GetPassCount(void) {
+    return crc_bg_passes;
+}
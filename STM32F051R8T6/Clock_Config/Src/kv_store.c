@@ -0,0 +1,362 @@
+#include "kv_store.h"
+#include "Flash.h"
+#include "device_profile.h"
+
+#if KV_PAGES < 2
+#error "KV_PAGES: at least one page in use and one to rotate into"
+#endif
+
+// Store area: KV_PAGES pages right below the HSI trim page, reserved as
+// KVSTORE in the linker script
+#define KV_FLASH_ADDRESS    (FLASH_BASE_ADDRESS + DEVICE_FLASH_SIZE - (KV_PAGES + 1U) * DEVICE_FLASH_PAGE_SIZE)
+#define KV_PAGE_SIZE        DEVICE_FLASH_PAGE_SIZE
+#define KV_PAGE(p)          (KV_FLASH_ADDRESS + (uint32_t)(p) * KV_PAGE_SIZE)
+
+// Page header: magic (written last when a page is opened), obsolete flag
+// (cleared to 0 before the page is erased), sequence number, copy marker
+// (cleared to 0 once the page holds everything it was opened for: at once
+// for an empty page, after the last copied record for a compaction)
+#define KV_HDR_MAGIC        0U
+#define KV_HDR_OBSOLETE     2U
+#define KV_HDR_SEQUENCE     4U
+#define KV_HDR_COPIED       8U
+#define KV_HEADER_SIZE      12U
+#define KV_PAGE_MAGIC       0x4B56U     // "KV"
+#define KV_COPY_DONE        0x0000U
+#define KV_ERASED_HALF      0xFFFFU
+#define KV_ERASED           0xFFFFFFFFUL
+
+// Record: key and length half-words, value padded to a word, checksum word.
+// A length of 0 deletes the key.
+#define KV_RECORD_SIZE(len) (8U + (((uint32_t)(len) + 3U) & ~3U))
+#define KV_TOMBSTONE        0U
+
+// Index entries are word offsets from KV_FLASH_ADDRESS
+#define KV_NO_RECORD        0xFFFFU
+#define KV_OFFSET(addr)     ((uint16_t)(((addr) - KV_FLASH_ADDRESS) >> 2))
+#define KV_ADDRESS(offset)  (KV_FLASH_ADDRESS + ((uint32_t)(offset) << 2))
+
+#define KV_HALF(addr)       (*(const volatile uint16_t *)(uintptr_t)(addr))
+#define KV_WORD(addr)       (*(const volatile uint32_t *)(uintptr_t)(addr))
+
+static uint16_t kv_index[KV_MAX_KEYS];  // Newest record of each key
+static uint32_t kv_sequence;            // Sequence number of the head page
+static uint32_t kv_cursor;              // Next free address in the head page
+static uint8_t kv_head;                 // Page being appended to
+static uint8_t kv_tail;                 // Oldest page in use
+static uint8_t kv_used;                 // Pages in use, tail to head
+static bool kv_ready;
+static KV_Stats kv_stats;
+
+// Private: next page in rotation
+static uint8_t KV_Next(uint8_t page) {
+    return (page + 1U == KV_PAGES) ? 0U : (uint8_t)(page + 1U);
+}
+
+// Private: FNV-1a over key, length and value. Never the erased pattern, so an
+// unwritten checksum never matches.
+static uint32_t KV_Checksum(uint16_t key, uint16_t length, const uint8_t *value) {
+    uint32_t header = ((uint32_t)length << 16) | key;
+    uint32_t hash = 2166136261UL;
+    uint32_t i;
+
+    for (i = 0; i < 4U; i++) {
+        hash = (hash ^ ((header >> (8U * i)) & 0xFFU)) * 16777619UL;
+    }
+    for (i = 0; i < length; i++) {
+        hash = (hash ^ value[i]) * 16777619UL;
+    }
+    return (hash == KV_ERASED) ? 0U : hash;
+}
+
+// Private: header intact, contents complete and not retired
+static bool KV_PageInUse(uint32_t base) {
+    return KV_HALF(base + KV_HDR_MAGIC) == KV_PAGE_MAGIC &&
+           KV_HALF(base + KV_HDR_COPIED) == KV_COPY_DONE &&
+           KV_HALF(base + KV_HDR_OBSOLETE) == KV_ERASED_HALF;
+}
+
+// Private: every word still erased
+static bool KV_PageBlank(uint32_t base) {
+    uint32_t offset;
+
+    for (offset = 0; offset < KV_PAGE_SIZE; offset += 4U) {
+        if (KV_WORD(base + offset) != KV_ERASED) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Private: make a blank page the head. The sequence number goes first and
+// the magic last, so a page cut short while opening is not taken as in use.
+// A page opened for a compaction is left without its copy marker.
+static KV_Status KV_OpenPage(uint8_t page, bool copying) {
+    uint32_t base = KV_PAGE(page);
+
+    kv_sequence++;
+    if (FLASH_ProgramWord(base + KV_HDR_SEQUENCE, kv_sequence) != FLASH_STATUS_READY ||
+        (!copying && FLASH_ProgramHalfWord(base + KV_HDR_COPIED, KV_COPY_DONE) != FLASH_STATUS_READY) ||
+        FLASH_ProgramHalfWord(base + KV_HDR_MAGIC, KV_PAGE_MAGIC) != FLASH_STATUS_READY) {
+        return KV_FLASH_ERROR;
+    }
+    kv_head = page;
+    kv_cursor = base + KV_HEADER_SIZE;
+    kv_used++;
+    return KV_OK;
+}
+
+// Private: append one record at the cursor (room already checked). The
+// checksum goes last, so a record cut short by a reset is never valid.
+static KV_Status KV_Append(uint16_t key, const uint8_t *value, uint16_t length) {
+    uint32_t address = kv_cursor;
+    uint32_t i;
+
+    // The slot is used up even if programming fails part way
+    kv_cursor += KV_RECORD_SIZE(length);
+
+    if (FLASH_ProgramHalfWord(address, key) != FLASH_STATUS_READY ||
+        FLASH_ProgramHalfWord(address + 2U, length) != FLASH_STATUS_READY) {
+        return KV_FLASH_ERROR;
+    }
+    for (i = 0; i < length; i += 2U) {
+        uint16_t half = value[i];
+
+        half |= (i + 1U < length) ? (uint16_t)(value[i + 1U] << 8) : 0xFF00U;
+        if (FLASH_ProgramHalfWord(address + 4U + i, half) != FLASH_STATUS_READY) {
+            return KV_FLASH_ERROR;
+        }
+    }
+    if (FLASH_ProgramWord(kv_cursor - 4U, KV_Checksum(key, length, value)) != FLASH_STATUS_READY) {
+        return KV_FLASH_ERROR;
+    }
+
+    kv_index[key] = (length == KV_TOMBSTONE) ? KV_NO_RECORD : KV_OFFSET(address);
+    kv_stats.writes++;
+    return KV_OK;
+}
+
+// Private: mark the oldest page obsolete and erase it
+static KV_Status KV_Retire(void) {
+    uint32_t base = KV_PAGE(kv_tail);
+
+    if (FLASH_ProgramHalfWord(base + KV_HDR_OBSOLETE, 0x0000U) != FLASH_STATUS_READY ||
+        FLASH_ErasePage(base) != FLASH_STATUS_READY) {
+        return KV_FLASH_ERROR;
+    }
+    kv_tail = KV_Next(kv_tail);
+    kv_used--;
+    return KV_OK;
+}
+
+// Private: copy the live records of the oldest page into the last free page,
+// set its copy marker, then retire the oldest page. A reset before the
+// marker leaves a page KV_Init() does not take as in use, so it drops the
+// partial copy; a reset after it leaves every page in use, and KV_Init()
+// finishes the retirement.
+static KV_Status KV_Compact(void) {
+    uint32_t base = KV_PAGE(kv_tail);
+    KV_Status status = KV_OpenPage(KV_Next(kv_head), true);
+    uint16_t key;
+
+    for (key = 0; key < KV_MAX_KEYS && status == KV_OK; key++) {
+        uint32_t record = KV_ADDRESS(kv_index[key]);
+
+        if (kv_index[key] != KV_NO_RECORD && record - base < KV_PAGE_SIZE) {
+            status = KV_Append(key, (const uint8_t *)(uintptr_t)(record + 4U), KV_HALF(record + 2U));
+        }
+    }
+    if (status != KV_OK) {
+        return status;
+    }
+
+    if (FLASH_ProgramHalfWord(KV_PAGE(kv_head) + KV_HDR_COPIED, KV_COPY_DONE) != FLASH_STATUS_READY) {
+        return KV_FLASH_ERROR;
+    }
+    status = KV_Retire();
+    if (status == KV_OK) {
+        kv_stats.compactions++;
+    }
+    return status;
+}
+
+// Private: append, moving to the next page or compacting when the head is
+// full. Gives up once every page has been rotated without making room.
+static KV_Status KV_Store(uint16_t key, const uint8_t *value, uint16_t length) {
+    uint32_t size = KV_RECORD_SIZE(length);
+    uint32_t attempt;
+    KV_Status status;
+
+    for (attempt = 0; attempt <= KV_PAGES; attempt++) {
+        if (kv_cursor + size <= KV_PAGE(kv_head) + KV_PAGE_SIZE) {
+            return KV_Append(key, value, length);
+        }
+        status = (kv_used < KV_PAGES - 1U) ? KV_OpenPage(KV_Next(kv_head), false) : KV_Compact();
+        if (status != KV_OK) {
+            return status;
+        }
+    }
+    return KV_FULL;
+}
+
+// Private: index the valid records of one page and leave the cursor after
+// the last one. A torn header ends the page: its length cannot be trusted.
+static void KV_Replay(uint8_t page) {
+    uint32_t address = KV_PAGE(page) + KV_HEADER_SIZE;
+    uint32_t end = KV_PAGE(page) + KV_PAGE_SIZE;
+
+    while (address + 8U <= end && KV_WORD(address) != KV_ERASED) {
+        uint16_t key = KV_HALF(address);
+        uint16_t length = KV_HALF(address + 2U);
+        uint32_t size = KV_RECORD_SIZE(length);
+
+        if (length > KV_MAX_VALUE || address + size > end) {
+            address = end;
+            break;
+        }
+        if (key < KV_MAX_KEYS &&
+            KV_WORD(address + size - 4U) == KV_Checksum(key, length, (const uint8_t *)(uintptr_t)(address + 4U))) {
+            kv_index[key] = (length == KV_TOMBSTONE) ? KV_NO_RECORD : KV_OFFSET(address);
+        }
+        address += size;
+    }
+    kv_cursor = address;
+}
+
+// Mount the store: recover from an interrupted write, copy or erase, then
+// rebuild the index. Formats the area on first use.
+KV_Status KV_Init(void) {
+    uint8_t page;
+    uint32_t i;
+
+    kv_ready = false;
+    kv_used = 0;
+    kv_sequence = 0;
+    for (i = 0; i < KV_MAX_KEYS; i++) {
+        kv_index[i] = KV_NO_RECORD;
+    }
+
+    // Pages neither in use nor blank were being opened, filled by a
+    // compaction or erased: erase them
+    for (page = 0; page < KV_PAGES; page++) {
+        uint32_t base = KV_PAGE(page);
+
+        if (KV_PageInUse(base)) {
+            uint32_t sequence = KV_WORD(base + KV_HDR_SEQUENCE);
+
+            if (kv_used == 0 || sequence < KV_WORD(KV_PAGE(kv_tail) + KV_HDR_SEQUENCE)) {
+                kv_tail = page;
+            }
+            if (kv_used == 0 || sequence > kv_sequence) {
+                kv_head = page;
+                kv_sequence = sequence;
+            }
+            kv_used++;
+        } else if (!KV_PageBlank(base) && FLASH_ErasePage(base) != FLASH_STATUS_READY) {
+            return KV_FLASH_ERROR;
+        }
+    }
+
+    // No free page: a compaction finished its copy (the newest page has its
+    // copy marker) but not the retirement of its source, the oldest page
+    if (kv_used == KV_PAGES && KV_Retire() != KV_OK) {
+        return KV_FLASH_ERROR;
+    }
+
+    if (kv_used == 0) {
+        kv_tail = 0;
+        if (KV_OpenPage(0, false) != KV_OK) {
+            return KV_FLASH_ERROR;
+        }
+    } else {
+        for (i = 0, page = kv_tail; i < kv_used; i++, page = KV_Next(page)) {
+            KV_Replay(page);
+        }
+    }
+
+    kv_ready = true;
+    return KV_OK;
+}
+
+// Store a value (1 to KV_MAX_VALUE bytes). Writing the current value again
+// costs nothing.
+KV_Status KV_Write(uint16_t key, const void *data, uint16_t length) {
+    const uint8_t *value = (const uint8_t *)data;
+    uint16_t i;
+
+    if (!kv_ready || key >= KV_MAX_KEYS || data == NULL || length == 0 || length > KV_MAX_VALUE) {
+        return KV_INVALID;
+    }
+
+    if (kv_index[key] != KV_NO_RECORD) {
+        uint32_t record = KV_ADDRESS(kv_index[key]);
+
+        if (KV_HALF(record + 2U) == length) {
+            const uint8_t *stored = (const uint8_t *)(uintptr_t)(record + 4U);
+
+            for (i = 0; i < length && stored[i] == value[i]; i++);
+            if (i == length) {
+                return KV_OK;
+            }
+        }
+    }
+    return KV_Store(key, value, length);
+}
+
+// Copy a value into data (size bytes available). *length, if given, gets the
+// stored length, also when size is too small.
+KV_Status KV_Read(uint16_t key, void *data, uint16_t size, uint16_t *length) {
+    uint8_t *out = (uint8_t *)data;
+    const uint8_t *stored;
+    uint32_t record;
+    uint16_t stored_length;
+    uint16_t i;
+
+    if (!kv_ready || key >= KV_MAX_KEYS) {
+        return KV_INVALID;
+    }
+    if (kv_index[key] == KV_NO_RECORD) {
+        return KV_NOT_FOUND;
+    }
+
+    record = KV_ADDRESS(kv_index[key]);
+    stored_length = KV_HALF(record + 2U);
+    if (length != NULL) {
+        *length = stored_length;
+    }
+    if (data == NULL || size < stored_length) {
+        return KV_INVALID;
+    }
+
+    stored = (const uint8_t *)(uintptr_t)(record + 4U);
+    for (i = 0; i < stored_length; i++) {
+        out[i] = stored[i];
+    }
+    return KV_OK;
+}
+
+// Remove a key (appends a delete record)
+KV_Status KV_Delete(uint16_t key) {
+    if (!kv_ready || key >= KV_MAX_KEYS) {
+        return KV_INVALID;
+    }
+    if (kv_index[key] == KV_NO_RECORD) {
+        return KV_NOT_FOUND;
+    }
+    return KV_Store(key, NULL, KV_TOMBSTONE);
+}
+
+void KV_GetStats(KV_Stats *stats) {
+    *stats = kv_stats;
+    stats->pages_opened = kv_sequence;
+    stats->free_bytes = kv_ready ? KV_PAGE(kv_head) + KV_PAGE_SIZE - kv_cursor : 0U;
+}
+
+// Updates of one value of this length before the pages reach their rated
+// erase count. An upper bound: live records of other keys copied during
+// compaction take some of the room.
+uint32_t KV_ProjectedUpdates(uint16_t length) {
+    uint32_t per_page = (KV_PAGE_SIZE - KV_HEADER_SIZE) / KV_RECORD_SIZE(length);
+
+    return per_page * KV_PAGES * KV_FLASH_ENDURANCE;
+}
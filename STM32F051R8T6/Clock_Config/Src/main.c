@@ -1,56 +1,367 @@
 #include "rcc.h"
+#include "clock_governor.h"
+#include "hsi_calib.h"
+#include "boot_profile.h"
+#include "ramfunc.h"
+#include "Flash.h"
+#include "kv_store.h"
+#include "flash_queue.h"
+#include "image_crc.h"
 
-// Example configuration for 48MHz system clock using PLL from HSE
-void SystemClock_Config_48MHz(void) {
-    RCC_Config config = {
-        .system_clock_source = CLOCK_SOURCE_PLL,
-        .target_frequency = SYSTEM_CLOCK_48MHZ,
-        .hse_enabled = true,
-        .pll_enabled = true,
-        .pll_source = PLL_SOURCE_HSE,
-        .pll_multiplier = 6,  // HSE 8MHz * 6 = 48MHz
-        .ahb_prescaler = AHB_PRESCALER_1,
-        .apb_prescaler = APB_PRESCALER_1,
-        .hsi48_enabled = false,
-        .css_enabled = true
-    };
+// Key-value store keys
+#define KV_KEY_BOOT_COUNT   0U
+
+// Busy-wait delay kept in step with HCLK by a clock listener. The loop body
+// is about 4 cycles on the Cortex-M0.
+#define DELAY_CYCLES_PER_LOOP   4U
+
+static volatile uint32_t delay_loops_per_ms = RCC_HSI_FREQUENCY / (1000U * DELAY_CYCLES_PER_LOOP);
+
+static void Delay_ClockChanged(RCC_ClockEvent event, uint32_t hclk_hz, uint32_t pclk_hz) {
+    (void)pclk_hz;
+    if (event == RCC_CLOCK_POST_CHANGE) {
+        delay_loops_per_ms = hclk_hz / (1000U * DELAY_CYCLES_PER_LOOP);
+    }
+}
 
-    RCC_Init(&config);
+void Delay_ms(uint32_t ms) {
+    while (ms--) {
+        for (uint32_t i = delay_loops_per_ms; i != 0; i--) {
+            __asm volatile ("nop");
+        }
+    }
 }
 
-// Example configuration for 8MHz using HSI (no crystal needed)
+// Boot clock tree: checked at compile time, solved at run time. The board
+// has no HSE crystal fitted, so the solver settles on HSI.
+#define CLOCK_BOOT_HZ       8000000UL
+#define CLOCK_HSE_HZ        0UL
+
+// Build with -DCLOCK_LSE_FITTED=1 on boards with the 32.768 kHz crystal on
+// PC14/PC15 to trim HSI against it at boot. Waiting for a crystal that is
+// not there costs about two seconds, once (see below).
+#ifndef CLOCK_LSE_FITTED
+#define CLOCK_LSE_FITTED    0
+#endif
+
+RCC_STATIC_ASSERT_CLOCKS(CLOCK_BOOT_HZ, CLOCK_BOOT_HZ, CLOCK_BOOT_HZ, CLOCK_HSE_HZ);
+
+// Boot at 8MHz (HSI, no PLL). The governor raises the clock later.
 void SystemClock_Config_8MHz(void) {
-    RCC_Config config = {
-        .system_clock_source = CLOCK_SOURCE_HSI,
-        .target_frequency = SYSTEM_CLOCK_8MHZ,
-        .hse_enabled = false,
-        .pll_enabled = false,
-        .pll_source = PLL_SOURCE_HSI_DIV2,
-        .pll_multiplier = 2,
-        .ahb_prescaler = AHB_PRESCALER_1,
-        .apb_prescaler = APB_PRESCALER_1,
-        .hsi48_enabled = false,
-        .css_enabled = false
+    static const RCC_ClockRequest request = {
+        .sysclk_hz = CLOCK_BOOT_HZ,
+        .hclk_hz = CLOCK_BOOT_HZ,
+        .pclk_hz = CLOCK_BOOT_HZ,
+        .hse_hz = CLOCK_HSE_HZ
     };
+    RCC_Config config;
+
+    if (RCC_SolveConfig(&request, &config, NULL)) {
+        RCC_Init(&config);   // Sets the flash latency before switching
+    }
+}
+
+// STOP mode (regulator in low-power mode), woken by any EXTI line
+#define PWR_CR              (*(volatile uint32_t *)0x40007000UL)
+#define PWR_CR_LPDS         (1U << 0)
+#define PWR_CR_PDDS         (1U << 1)
+#define SCB_SCR             (*(volatile uint32_t *)0xE000ED10UL)
+#define SCB_SCR_SLEEPDEEP   (1U << 2)
+
+// Enter STOP and come back at the clock that was running. The PLL relocks
+// while the wake-up work runs on HSI; RCC_GetRestoreLatency() reports how
+// long it took to get back to full speed.
+void LowPower_Stop(void) {
+    RCC_Snapshot snapshot;
+
+    RCC_SaveSnapshot(&snapshot);
+    RCC_EnableClocks(RCC_PERIPH(PERIPH_PWR));
+    PWR_CR = (PWR_CR & ~PWR_CR_PDDS) | PWR_CR_LPDS;
+    SCB_SCR |= SCB_SCR_SLEEPDEEP;
+    __asm volatile ("wfi");
+    SCB_SCR &= ~SCB_SCR_SLEEPDEEP;
+
+    RCC_RestoreBegin(&snapshot);
+    // Wake-up work that is fine at 8 MHz goes here
+    RCC_RestoreComplete();
+}
+
+#if defined(FLASH_LATENCY_TEST) || defined(KV_BENCHMARK) || defined(IMAGE_CRC_BENCHMARK)
+
+// These reprogram SysTick during boot, which the boot profiler free-runs
+// from reset: its stamps would be garbage
+#ifdef BOOT_PROFILE
+#error "BOOT_PROFILE cannot be combined with FLASH_LATENCY_TEST, KV_BENCHMARK or IMAGE_CRC_BENCHMARK"
+#endif
+
+// SysTick
+#define SYST_CSR            (*(volatile uint32_t *)(SYSTICK_BASE + 0x0))
+#define SYST_RVR            (*(volatile uint32_t *)(SYSTICK_BASE + 0x4))
+#define SYST_CVR            (*(volatile uint32_t *)(SYSTICK_BASE + 0x8))
+#define SYST_CSR_ENABLE     (1U << 0)
+#define SYST_CSR_TICKINT    (1U << 1)
+#define SYST_CSR_CLKSOURCE  (1U << 2)   // 1 = HCLK
+#define SYST_RELOAD_MAX     0x00FFFFFFUL
+
+#endif
+
+#ifdef FLASH_LATENCY_TEST
+
+#define LATENCY_PERIOD      1000U   // HCLK cycles between probe interrupts
+#define LATENCY_SAMPLES     100U
+
+// Worst-case SysTick response, in HCLK cycles from the reload to the first
+// instruction of the handler plus a few cycles for the read itself
+typedef struct {
+    uint32_t idle_cycles;
+    uint32_t erase_cycles;
+    uint32_t erase_interrupts;   // Probes taken while the erase was running
+} Latency_Result;
+
+static volatile uint32_t latency_max;
+static volatile uint32_t latency_count;
+
+// Runs from RAM with its vector in RAM, so it is taken during an erase
+RAMFUNC void SysTick_Handler(void) {
+    uint32_t latency = SYST_RVR - SYST_CVR;
+
+    if (latency > latency_max) {
+        latency_max = latency;
+    }
+    latency_count++;
+}
+
+// Measure interrupt response while idle and while page_address is erased.
+// Without RAMFUNC on the handler or the erase, erase_interrupts drops to 0 or
+// 1 and erase_cycles grows to the length of the erase.
+void Latency_Test(uint32_t page_address, Latency_Result *result) {
+    SYST_CSR = 0;
+    SYST_RVR = LATENCY_PERIOD - 1U;
+    SYST_CVR = 0;
+    latency_max = 0;
+    latency_count = 0;
+    SYST_CSR = SYST_CSR_ENABLE | SYST_CSR_TICKINT | SYST_CSR_CLKSOURCE;
+
+    while (latency_count < LATENCY_SAMPLES);
+    result->idle_cycles = latency_max;
+
+    latency_max = 0;
+    latency_count = 0;
+    FLASH_ErasePage(page_address);
+    result->erase_cycles = latency_max;
+    result->erase_interrupts = latency_count;
+
+    SYST_CSR = 0;
+}
+
+#endif // FLASH_LATENCY_TEST
+
+#ifdef KV_BENCHMARK
+
+#define KV_BENCH_KEY        (KV_MAX_KEYS - 1U)
+#define KV_BENCH_UPDATES    500U
+#define KV_BENCH_READS      1000U
+
+// Update latency (average and worst, page switches and compactions
+// included), read rate and projected endurance for a 4-byte counter
+typedef struct {
+    uint32_t update_avg_us;
+    uint32_t update_max_us;
+    uint32_t reads_per_s;
+    uint32_t projected_updates;
+} KV_Benchmark;
 
-    RCC_Init(&config);
+// Private: SysTick ticks since start (less than one period)
+static uint32_t Bench_Elapsed(uint32_t start) {
+    return (start - SYST_CVR) & SYST_RELOAD_MAX;
 }
 
+// Count up a value in KV_BENCH_KEY, timing every update, then time reads
+void KV_RunBenchmark(KV_Benchmark *result) {
+    uint32_t hclk = RCC_GetHCLKFrequency();
+    uint32_t ticks_per_us = hclk / 1000000U;
+    uint32_t total = 0;
+    uint32_t worst = 0;
+    uint32_t counter;
+    uint32_t start;
+    uint32_t ticks;
+    uint32_t i;
+
+    SYST_CSR = 0;
+    SYST_RVR = SYST_RELOAD_MAX;
+    SYST_CVR = 0;
+    SYST_CSR = SYST_CSR_ENABLE | SYST_CSR_CLKSOURCE;
+
+    for (counter = 0; counter < KV_BENCH_UPDATES; counter++) {
+        start = SYST_CVR;
+        KV_Write(KV_BENCH_KEY, &counter, sizeof(counter));
+        ticks = Bench_Elapsed(start);
+        total += ticks;
+        if (ticks > worst) {
+            worst = ticks;
+        }
+    }
+    result->update_avg_us = total / KV_BENCH_UPDATES / ticks_per_us;
+    result->update_max_us = worst / ticks_per_us;
+
+    start = SYST_CVR;
+    for (i = 0; i < KV_BENCH_READS; i++) {
+        KV_Read(KV_BENCH_KEY, &counter, sizeof(counter), NULL);
+    }
+    ticks = Bench_Elapsed(start);
+    result->reads_per_s = (uint32_t)(((uint64_t)KV_BENCH_READS * hclk) / (ticks ? ticks : 1U));
+    result->projected_updates = KV_ProjectedUpdates(sizeof(counter));
+
+    SYST_CSR = 0;
+}
+
+#endif // KV_BENCHMARK
+
+#ifdef IMAGE_CRC_BENCHMARK
+
+// Time a DMA CRC pass over the whole 64 KB of flash, in microseconds
+uint32_t ImageCRC_TimeFullFlash(void) {
+    uint32_t start;
+    uint32_t ticks;
+
+    SYST_CSR = 0;
+    SYST_RVR = SYST_RELOAD_MAX;
+    SYST_CVR = 0;
+    SYST_CSR = SYST_CSR_ENABLE | SYST_CSR_CLKSOURCE;
+
+    start = SYST_CVR;
+    ImageCRC_Compute(FLASH_BASE_ADDRESS, DEVICE_FLASH_SIZE);
+    ticks = (start - SYST_CVR) & SYST_RELOAD_MAX;
+
+    SYST_CSR = 0;
+    return ticks / (RCC_GetHCLKFrequency() / 1000000U);
+}
+
+#endif // IMAGE_CRC_BENCHMARK
+
+#ifdef FLASH_QUEUE_DEMO
+
+// Background log write: erase two pages at FLASH_QUEUE_DEMO (a spare flash
+// address given with -DFLASH_QUEUE_DEMO=0x...) and write two buffers there
+// while the main loop keeps running
+static const uint8_t demo_header[] = "LOG1";
+static uint8_t demo_block[64];
+static volatile bool demo_flash_done;
+
+static const FlashQueue_Step demo_steps[] = {
+    { FLASH_STEP_ERASE,   FLASH_QUEUE_DEMO,       NULL,        2U },
+    { FLASH_STEP_PROGRAM, FLASH_QUEUE_DEMO,       demo_header, sizeof(demo_header) },
+    { FLASH_STEP_PROGRAM, FLASH_QUEUE_DEMO + 16U, demo_block,  sizeof(demo_block) }
+};
+
+static void Demo_FlashDone(FlashQueue_Job *job) {
+    (void)job;
+    demo_flash_done = true;
+}
+
+static FlashQueue_Job demo_job = {
+    .steps = demo_steps,
+    .step_count = sizeof(demo_steps) / sizeof(demo_steps[0]),
+    .callback = Demo_FlashDone
+};
+
+#endif // FLASH_QUEUE_DEMO
+
 int main(void) {
+    // Built for another part: stop before RCC is misprogrammed
+    if (!Device_CheckID()) {
+        while (1);
+    }
+
+    // Corrupted image: stop rather than run it (unpatched builds skip this)
+    if (ImageCRC_Verify() == IMAGE_CRC_MISMATCH) {
+        while (1);
+    }
+
+    // Vectors from SRAM, so RAMFUNC handlers run during flash erase/program
+    RAM_RelocateVectorTable();
+    RCC_RegisterClockListener(Delay_ClockChanged, 0);
+    BOOT_MARK(BOOT_PHASE_CHECKS);
+
     // Configure system clock
 	SystemClock_Config_8MHz();
+    BOOT_MARK(BOOT_PHASE_CLOCK);
+
+#if CLOCK_LSE_FITTED
+    // Trim HSI once against LSE, then reuse the stored trim on later boots.
+    // No crystal after all: record that, so later boots keep the factory trim
+    // instead of waiting for it again.
+    if (HSICal_LoadSaved() == HSICAL_SAVED_NONE) {
+        HSICal_Status status = HSICal_Calibrate(HSICAL_REF_LSE, 0);
+
+        if (status == HSICAL_OK) {
+            HSICal_Save();
+        } else if (status == HSICAL_NO_REFERENCE) {
+            HSICal_SaveNoReference();
+        }
+    }
+#else
+    // A trim stored from a measurement (HSICal_ApplyMeasurement)
+    HSICal_LoadSaved();
+#endif
+
+    // Persistent settings and counters
+    uint32_t boot_count = 0;
+    if (KV_Init() == KV_OK) {
+        KV_Read(KV_KEY_BOOT_COUNT, &boot_count, sizeof(boot_count), NULL);
+        boot_count++;
+        KV_Write(KV_KEY_BOOT_COUNT, &boot_count, sizeof(boot_count));
+    }
+
+#ifdef IMAGE_CRC_BENCHMARK
+    // Read crc_full_flash_us in the debugger
+    volatile uint32_t crc_full_flash_us = ImageCRC_TimeFullFlash();
+    (void)crc_full_flash_us;
+#endif
+
+#ifdef KV_BENCHMARK
+    KV_Benchmark kv_bench;
+    KV_RunBenchmark(&kv_bench);
+#endif
 
     // Enable peripheral clocks as needed
-    RCC_EnablePeripheralClock(PERIPH_GPIOA, 0);
-    RCC_EnablePeripheralClock(PERIPH_GPIOB, 0);
-    RCC_EnablePeripheralClock(PERIPH_USART1, 0);
-    RCC_EnablePeripheralClock(PERIPH_ADC, 0);
+    RCC_EnableClocks(RCC_PERIPH(PERIPH_GPIOA) | RCC_PERIPH(PERIPH_GPIOB) |
+                     RCC_PERIPH(PERIPH_USART1) | RCC_PERIPH(PERIPH_ADC));
+    BOOT_MARK(BOOT_PHASE_PERIPH);
+
+#ifdef FLASH_LATENCY_TEST
+    // Uses the HSI trim page and stores the trim again afterwards
+    Latency_Result latency;
+    Latency_Test(FLASH_BASE_ADDRESS + DEVICE_FLASH_SIZE - DEVICE_FLASH_PAGE_SIZE, &latency);
+    HSICal_Save();
+#endif
 
     // Get current system clock frequency
     uint32_t sysclk = RCC_GetSystemClockFrequency();
 
+    // Idle at 8 MHz, run bursts at 48 MHz
+    Governor_Init();
+    BOOT_MARK(BOOT_PHASE_READY);
+    BOOT_DUMP();
+
+#ifdef FLASH_QUEUE_DEMO
+    // Completes from the FLASH interrupt while the loop below runs
+    FlashQueue_Submit(&demo_job);
+#endif
+
     while (1) {
-        // Application code here
+        // HSE lost: the NMI only parked SYSCLK on HSI, finish here
+        RCC_ServiceCSS();
+
+        Governor_SetOPP(GOVERNOR_OPP_48MHZ);
+        // Burst work here
+        Delay_ms(10);
+        Governor_SetOPP(GOVERNOR_OPP_8MHZ);
+        // Idle work here: re-check a slice of the image each pass
+        if (ImageCRC_BackgroundStep() == IMAGE_CRC_MISMATCH) {
+            while (1);
+        }
+        Delay_ms(10);
     }
 
     return 0;
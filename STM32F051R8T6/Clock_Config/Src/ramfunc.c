@@ -0,0 +1,26 @@
+#include "ramfunc.h"
+#include "rcc.h"
+
+// SYSCFG
+#define SYSCFG_CFGR1            (*(volatile uint32_t *)0x40010000UL)
+#define SYSCFG_CFGR1_MEM_MODE   (3U << 0)   // 11 = SRAM at 0x00000000
+
+// From the startup code and the linker script
+extern const uint32_t g_pfnVectors[];
+extern uint32_t _sram_vector[];
+
+// Copy the vector table to SRAM and run from that copy. Handlers keep their
+// own addresses, so only those marked RAMFUNC avoid flash entirely.
+void RAM_RelocateVectorTable(void) {
+    uint32_t primask;
+    uint32_t i;
+
+    __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+    for (i = 0; i < RAM_VECTOR_WORDS; i++) {
+        _sram_vector[i] = g_pfnVectors[i];
+    }
+
+    RCC_EnableClocks(RCC_PERIPH(PERIPH_SYSCFG));
+    SYSCFG_CFGR1 = (SYSCFG_CFGR1 & ~SYSCFG_CFGR1_MEM_MODE) | SYSCFG_CFGR1_MEM_MODE;
+    __asm volatile ("dsb\n\tisb\n\tmsr primask, %0" :: "r" (primask) : "memory");
+}
@@ -1,135 +1,677 @@
 #include "rcc.h"
+#include "Flash.h"
 #include <stddef.h>  // Added for NULL definition
 
 // Private function prototypes
-static void RCC_ConfigurePLL(const RCC_Config *config);
-static void RCC_ConfigureClockTree(const RCC_Config *config);
-static uint32_t RCC_CalculatePLLFrequency(const RCC_Config *config);
-static bool RCC_IsDeviceF04xF07xF09x(void);
-
-// Initialize RCC with given configuration
-void RCC_Init(const RCC_Config *config) {
-    // 1. Enable HSI as fallback clock
-    RCC_EnableHSI();
+static void RCC_UpdateClockCache(void);
+static uint8_t RCC_GetPLLMultiplier(uint32_t output_hz, uint32_t input_hz);
+static uint8_t RCC_GetHSEPrediv(uint32_t output_hz, uint32_t hse_hz, uint8_t *multiplier);
+static uint32_t RCC_ConfigSysclk(const RCC_Config *config);
+
+// Cached clock frequencies, refreshed on every clock change made through this
+// driver so the getters are a single load
+static uint32_t rcc_hse_hz = RCC_HSE_DEFAULT;
+static uint32_t rcc_sysclk_hz = RCC_HSI_FREQUENCY;
+static uint32_t rcc_hclk_hz = RCC_HSI_FREQUENCY;
+static uint32_t rcc_pclk_hz = RCC_HSI_FREQUENCY;
+
+// HPRE and PPRE as right shifts (HPRE has no /32 step)
+static const uint8_t rcc_ahb_shift[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 6, 7, 8, 9 };
+static const uint8_t rcc_apb_shift[8] = { 0, 0, 0, 0, 1, 2, 3, 4 };
+
+// Bit positions
+#define RCC_CR_HSION        (1U << 0)
+#define RCC_CR_HSIRDY       (1U << 1)
+#define RCC_CR_HSEON        (1U << 16)
+#define RCC_CR_HSERDY       (1U << 17)
+#define RCC_CR_HSEBYP       (1U << 18)
+#define RCC_CR_CSSON        (1U << 19)
+#define RCC_CR_PLLON        (1U << 24)
+#define RCC_CR_PLLRDY       (1U << 25)
+#define RCC_CR2_HSI48ON     (1U << 16)
+#define RCC_CR2_HSI48RDY    (1U << 17)
+#define RCC_CIR_CSSF        (1U << 7)
+#define RCC_CIR_CSSC        (1U << 23)
+#define RCC_CFGR_SW_HPRE_PPRE  (3U | (0xFU << 4) | (7U << 8))
+
+// SysTick (used only to time STOP-mode restores)
+#define SYST_CSR            (*(volatile uint32_t *)(SYSTICK_BASE + 0x0))
+#define SYST_RVR            (*(volatile uint32_t *)(SYSTICK_BASE + 0x4))
+#define SYST_CVR            (*(volatile uint32_t *)(SYSTICK_BASE + 0x8))
+#define SYST_CSR_ENABLE     (1U << 0)
+#define SYST_CSR_CLKSOURCE  (1U << 2)   // 1 = HCLK, 0 = HCLK/8
+#define SYST_RELOAD_MAX     0x00FFFFFFUL
+
+// Clock bring-up state
+typedef enum {
+    RCC_STATE_IDLE = 0,
+    RCC_STATE_WAIT_OSC,      // HSI/HSE/HSI48 starting together
+    RCC_STATE_WAIT_PLL,      // PLL locking
+    RCC_STATE_WAIT_SWITCH,   // SWS catching up with SW
+    RCC_STATE_DONE
+} RCC_State;
+
+static struct {
+    RCC_Config config;       // Configuration being applied (may become the fallback)
+    RCC_State state;
+    RCC_StartupStatus result;
+    uint32_t budget;         // Polls left before the current step times out
+    uint8_t old_latency;
+    uint8_t new_latency;
+    bool notify_post;        // PRE_CHANGE sent, POST_CHANGE still owed
+} rcc_startup;
+
+// STOP-mode restore state
+static struct {
+    RCC_Snapshot snapshot;
+    RCC_State state;
+    RCC_StartupStatus result;
+    uint32_t budget;
+    uint32_t tick_mark;      // SysTick value at the last timing step
+    uint32_t tick_hz;        // SysTick rate while still running on HSI
+    uint64_t elapsed_ns;
+} rcc_restore;
+
+static uint32_t rcc_restore_latency_us;
+
+// Clock change listeners, sorted by priority (lowest value first)
+static struct {
+    RCC_ClockListener listener;
+    uint8_t priority;
+} rcc_listeners[RCC_MAX_CLOCK_LISTENERS];
+static uint8_t rcc_listener_count;
+
+static volatile uint32_t rcc_css_events;
+static volatile bool rcc_css_pending;   // Set by the NMI, cleared by RCC_ServiceCSS
+
+// Wait for (reg & mask) == value, at most loops polls
+static bool RCC_WaitBits(volatile uint32_t *reg, uint32_t mask, uint32_t value, uint32_t loops) {
+    while ((*reg & mask) != value) {
+        if (loops-- == 0) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    // 2. Configure HSE if needed
-    if (config->hse_enabled) {
-        RCC_EnableHSE();
+// Replace a configuration with the closest one that runs from HSI alone and
+// is never faster than the original
+static void RCC_MakeFallbackConfig(RCC_Config *config) {
+    uint32_t multiplier = RCC_ConfigSysclk(config) / (RCC_HSI_FREQUENCY / 2);
+
+    config->hse_enabled = false;
+    config->css_enabled = false;
+    config->pll_source = PLL_SOURCE_HSI_DIV2;
+    config->pll_prediv = 1;
+
+    // HSI/2 x 4..12 covers 16-48 MHz, rounded down. Below the PLL minimum
+    // plain HSI is the best that does not overclock.
+    if (multiplier < RCC_PLL_OUTPUT_MIN / (RCC_HSI_FREQUENCY / 2)) {
+        config->system_clock_source = CLOCK_SOURCE_HSI;
+        config->pll_enabled = false;
+        config->target_frequency = (SystemClockFreq)RCC_HSI_FREQUENCY;
+        return;
     }
+    if (multiplier > 12) multiplier = 12;
+    config->system_clock_source = CLOCK_SOURCE_PLL;
+    config->pll_enabled = true;
+    config->pll_multiplier = (uint8_t)multiplier;
+    config->target_frequency = (SystemClockFreq)(multiplier * (RCC_HSI_FREQUENCY / 2));
+}
+
+// Start the oscillators the configuration needs, all at once
+static void RCC_StartOscillators(void) {
+    const RCC_Config *config = &rcc_startup.config;
 
-    // 3. Configure HSI48 for specific devices
-    if (config->hsi48_enabled && RCC_IsDeviceF04xF07xF09x()) {
-        RCC_EnableHSI48();
+    RCC_CR |= RCC_CR_HSION | (config->hse_enabled ? RCC_CR_HSEON : 0);
+#if DEVICE_HAS_HSI48
+    if (config->hsi48_enabled) {
+        RCC_CR2 |= RCC_CR2_HSI48ON;
     }
+#endif
 
-    // 4. Configure PLL if enabled
+    // PLL settings can be written while the oscillators start
     if (config->pll_enabled) {
-        RCC_ConfigurePLL(config);
-        RCC_EnablePLL();
+        RCC_SetPLLConfig(config->pll_source, config->pll_multiplier);
+        if (config->pll_source == PLL_SOURCE_HSE && config->pll_prediv > 1) {
+            RCC_CFGR2 = (RCC_CFGR2 & ~0xFU) | (uint32_t)(config->pll_prediv - 1U);
+        }
     }
 
-    // 5. Configure clock tree
-    RCC_ConfigureClockTree(config);
+    rcc_startup.budget = config->hse_enabled ? RCC_HSE_STARTUP_LOOPS : RCC_OSC_STARTUP_LOOPS;
+    rcc_startup.state = RCC_STATE_WAIT_OSC;
+}
+
+// Raise latency if needed, set prescalers and request the new SYSCLK. The
+// latency comes from the clock tree itself, not from target_frequency.
+static void RCC_RequestSwitch(void) {
+    const RCC_Config *config = &rcc_startup.config;
 
-    // 6. Enable CSS if requested
-    if (config->css_enabled) {
-        RCC_CR |= (1 << 19); // Set CSSON bit
+    rcc_startup.new_latency = RCC_GetFlashLatency(RCC_ConfigSysclk(config));
+    if (rcc_startup.new_latency > rcc_startup.old_latency) {
+        RCC_SetFlashLatency(rcc_startup.new_latency);
     }
+
+    RCC_CFGR = (RCC_CFGR & ~((0xFU << 4) | (7U << 8) | 3U)) |
+               ((uint32_t)config->ahb_prescaler << 4) |
+               ((uint32_t)config->apb_prescaler << 8) |
+               (uint32_t)config->system_clock_source;
+
+    rcc_startup.budget = RCC_SWITCH_LOOPS;
+    rcc_startup.state = RCC_STATE_WAIT_SWITCH;
 }
 
-// Enable HSI oscillator
-void RCC_EnableHSI(void) {
-    RCC_CR |= (1 << 0); // Set HSION bit
+// Give up on HSE: stop it and restart from HSI
+static void RCC_FallBack(void) {
+    RCC_CR &= ~(RCC_CR_HSEON | RCC_CR_CSSON);
+    RCC_MakeFallbackConfig(&rcc_startup.config);
+    rcc_startup.result = RCC_STARTUP_FALLBACK;
+    RCC_StartOscillators();
+}
+
+// Begin applying a configuration without waiting on any ready flag.
+// Drive it with RCC_StartupPoll() until it stops returning RCC_STARTUP_BUSY.
+void RCC_StartupBegin(const RCC_Config *config) {
+    // A solved configuration knows the fitted HSE: latency and cache use it
+    if (config->hse_hz != 0) {
+        rcc_hse_hz = config->hse_hz;
+    }
+    rcc_startup.config = *config;
+    rcc_startup.result = RCC_STARTUP_DONE;
+    rcc_startup.old_latency = FLASH->ACR & FLASH_ACR_LATENCY_Msk;
+
+    RCC_NotifyClockChange(RCC_CLOCK_PRE_CHANGE);
+    rcc_startup.notify_post = true;
+
+#if !DEVICE_HAS_HSI48
+    // SW = 11 and PLLSRC = 11 are reserved on this part
+    if (config->system_clock_source == CLOCK_SOURCE_HSI48 ||
+        (config->pll_enabled && config->pll_source == PLL_SOURCE_HSI48_DIV2) ||
+        config->pll_prediv > 16) {
+        rcc_startup.result = RCC_STARTUP_FAILED;
+        rcc_startup.state = RCC_STATE_DONE;
+        return;
+    }
+#endif
+
+    // The PLL cannot be reprogrammed while it drives SYSCLK: park on HSI
+    if (config->pll_enabled && ((RCC_CFGR >> 2) & 3) == CLOCK_SOURCE_PLL) {
+        RCC_CR |= RCC_CR_HSION;
+        if (!RCC_WaitBits(&RCC_CR, RCC_CR_HSIRDY, RCC_CR_HSIRDY, RCC_OSC_STARTUP_LOOPS) ||
+            !RCC_SetSystemClockSource(CLOCK_SOURCE_HSI)) {
+            rcc_startup.result = RCC_STARTUP_FAILED;
+            rcc_startup.state = RCC_STATE_DONE;
+            return;
+        }
+    }
+    if (config->pll_enabled && !RCC_DisablePLL()) {
+        rcc_startup.result = RCC_STARTUP_FAILED;
+        rcc_startup.state = RCC_STATE_DONE;
+        return;
+    }
+
+    RCC_StartOscillators();
+}
+
+// Advance the bring-up by one step. Never blocks.
+RCC_StartupStatus RCC_StartupPoll(void) {
+    const RCC_Config *config = &rcc_startup.config;
+
+    switch (rcc_startup.state) {
+        case RCC_STATE_WAIT_OSC: {
+            bool hsi_ready = (RCC_CR & RCC_CR_HSIRDY) != 0;
+            bool hse_ready = !config->hse_enabled || (RCC_CR & RCC_CR_HSERDY);
+#if DEVICE_HAS_HSI48
+            bool hsi48_ready = !config->hsi48_enabled || (RCC_CR2 & RCC_CR2_HSI48RDY);
+#else
+            bool hsi48_ready = true;
+#endif
+
+            if (hsi_ready && hse_ready && hsi48_ready) {
+                if (config->pll_enabled) {
+                    RCC_CR |= RCC_CR_PLLON;
+                    rcc_startup.budget = RCC_PLL_LOCK_LOOPS;
+                    rcc_startup.state = RCC_STATE_WAIT_PLL;
+                } else {
+                    RCC_RequestSwitch();
+                }
+            } else if (rcc_startup.budget-- == 0) {
+                if (!hse_ready) {
+                    RCC_FallBack();
+                } else {
+                    rcc_startup.result = RCC_STARTUP_FAILED;
+                    rcc_startup.state = RCC_STATE_DONE;
+                }
+            }
+            break;
+        }
 
-    // Wait for HSI ready
-    while (!(RCC_CR & (1 << 1))) {
-        // Wait for HSIRDY
+        case RCC_STATE_WAIT_PLL:
+            if (RCC_CR & RCC_CR_PLLRDY) {
+                RCC_RequestSwitch();
+            } else if (rcc_startup.budget-- == 0) {
+                // No lock: run from HSI directly
+                RCC_CR &= ~(RCC_CR_PLLON | RCC_CR_HSEON | RCC_CR_CSSON);
+                rcc_startup.config.system_clock_source = CLOCK_SOURCE_HSI;
+                rcc_startup.config.pll_enabled = false;
+                rcc_startup.config.hse_enabled = false;
+                rcc_startup.config.target_frequency = (SystemClockFreq)RCC_HSI_FREQUENCY;
+                rcc_startup.result = RCC_STARTUP_FALLBACK;
+                RCC_RequestSwitch();
+            }
+            break;
+
+        case RCC_STATE_WAIT_SWITCH:
+            if (((RCC_CFGR >> 2) & 3) == config->system_clock_source) {
+                if (rcc_startup.new_latency < rcc_startup.old_latency) {
+                    RCC_SetFlashLatency(rcc_startup.new_latency);
+                }
+                // Stop what the new clock tree no longer uses
+                if (!config->pll_enabled) {
+                    RCC_CR &= ~RCC_CR_PLLON;
+                }
+                if (!config->hse_enabled) {
+                    RCC_CR &= ~(RCC_CR_HSEON | RCC_CR_CSSON);
+                }
+                if (config->css_enabled && config->hse_enabled) {
+                    RCC_CR |= RCC_CR_CSSON;
+                }
+                RCC_UpdateClockCache();
+                rcc_startup.state = RCC_STATE_DONE;
+            } else if (rcc_startup.budget-- == 0) {
+                rcc_startup.result = RCC_STARTUP_FAILED;
+                rcc_startup.state = RCC_STATE_DONE;
+            }
+            break;
+
+        case RCC_STATE_IDLE:
+            return rcc_startup.result;
+
+        case RCC_STATE_DONE:
+            break;
+    }
+
+    if (rcc_startup.state != RCC_STATE_DONE) {
+        return RCC_STARTUP_BUSY;
     }
+
+    // Whatever happened, listeners get the clocks that are now running
+    if (rcc_startup.notify_post) {
+        rcc_startup.notify_post = false;
+        RCC_UpdateClockCache();
+        RCC_NotifyClockChange(RCC_CLOCK_POST_CHANGE);
+    }
+    return rcc_startup.result;
 }
 
-// Enable HSE oscillator
-void RCC_EnableHSE(void) {
-    RCC_CR |= (1 << 16); // Set HSEON bit
+// Configuration actually applied by the last bring-up (differs from the
+// requested one after a fallback)
+void RCC_GetActiveConfig(RCC_Config *config) {
+    *config = rcc_startup.config;
+}
 
-    // Wait for HSE ready
-    while (!(RCC_CR & (1 << 17))) {
-        // Wait for HSERDY
+// Record a configuration applied through the individual setters (e.g. by
+// the governor) as the active one. Ignored while a bring-up is running.
+void RCC_SetActiveConfig(const RCC_Config *config) {
+    if (rcc_startup.state == RCC_STATE_IDLE || rcc_startup.state == RCC_STATE_DONE) {
+        rcc_startup.config = *config;
     }
 }
 
-// Enable HSI48 oscillator (F04x/F07x/F09x only)
-void RCC_EnableHSI48(void) {
-    if (!RCC_IsDeviceF04xF07xF09x()) return;
+// Number of HSE failures caught by the Clock Security System
+uint32_t RCC_GetCSSEventCount(void) {
+    return rcc_css_events;
+}
 
-    RCC_CR2 |= (1 << 16); // Set HSI48ON bit
+// Add a clock change listener. Listeners run in ascending priority order
+// (equal priorities in registration order), for PRE_CHANGE and POST_CHANGE
+// alike. Returns false if the table is full or the listener is already in it.
+bool RCC_RegisterClockListener(RCC_ClockListener listener, uint8_t priority) {
+    uint8_t i;
 
-    // Wait for HSI48 ready
-    while (!(RCC_CR2 & (1 << 17))) {
-        // Wait for HSI48RDY
+    if (listener == NULL || rcc_listener_count >= RCC_MAX_CLOCK_LISTENERS) {
+        return false;
+    }
+    for (i = 0; i < rcc_listener_count; i++) {
+        if (rcc_listeners[i].listener == listener) {
+            return false;
+        }
     }
+
+    // Insertion sort: shift later-priority entries up one slot
+    i = rcc_listener_count;
+    while (i > 0 && rcc_listeners[i - 1].priority > priority) {
+        rcc_listeners[i] = rcc_listeners[i - 1];
+        i--;
+    }
+    rcc_listeners[i].listener = listener;
+    rcc_listeners[i].priority = priority;
+    rcc_listener_count++;
+    return true;
 }
 
-// Enable PLL
-void RCC_EnablePLL(void) {
-    RCC_CR |= (1 << 24); // Set PLLON bit
+// Remove a clock change listener. Returns false if it was not registered.
+bool RCC_UnregisterClockListener(RCC_ClockListener listener) {
+    uint8_t i;
+
+    for (i = 0; i < rcc_listener_count; i++) {
+        if (rcc_listeners[i].listener == listener) {
+            for (; i + 1 < rcc_listener_count; i++) {
+                rcc_listeners[i] = rcc_listeners[i + 1];
+            }
+            rcc_listener_count--;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Call every listener with the cached HCLK/PCLK. RCC_Init does this around
+// each transition; code that changes clocks through the individual setters
+// (e.g. the governor) calls it itself.
+void RCC_NotifyClockChange(RCC_ClockEvent event) {
+    uint8_t i;
 
-    // Wait for PLL ready
-    while (!(RCC_CR & (1 << 25))) {
-        // Wait for PLLRDY
+    for (i = 0; i < rcc_listener_count; i++) {
+        rcc_listeners[i].listener(event, rcc_hclk_hz, rcc_pclk_hz);
     }
 }
 
+// Initialize RCC with given configuration (blocking, but every wait is
+// bounded). Flash latency follows the SYSCLK the configuration produces:
+// raised before the new SYSCLK is selected, lowered only after it is
+// running. Clock
+// listeners get PRE_CHANGE first and POST_CHANGE once the clock has settled.
+// Returns false if the requested configuration could not be applied; the
+// clock then runs from the HSI fallback, see RCC_GetActiveConfig().
+bool RCC_Init(const RCC_Config *config) {
+    RCC_StartupStatus status;
+
+    RCC_StartupBegin(config);
+    do {
+        status = RCC_StartupPoll();
+    } while (status == RCC_STARTUP_BUSY);
+
+    return status == RCC_STARTUP_DONE;
+}
+
+// Record the clock tree before entering STOP. SYSCLK wakes up on HSI with
+// HSE and PLL off; everything else here survives STOP but is saved anyway so
+// the snapshot is self-contained.
+void RCC_SaveSnapshot(RCC_Snapshot *snapshot) {
+    snapshot->cr = RCC_CR;
+    snapshot->cfgr = RCC_CFGR;
+    snapshot->cfgr2 = RCC_CFGR2;
+    snapshot->cfgr3 = RCC_CFGR3;
+    snapshot->flash_acr = FLASH->ACR;
+}
+
+// Private: add SysTick ticks since the last mark (at most one reload apart)
+static void RCC_RestoreTimerStep(void) {
+    uint32_t now = SYST_CVR;
+    uint32_t ticks;
+
+    if (rcc_restore.tick_hz == 0) {
+        return;
+    }
+    ticks = (rcc_restore.tick_mark >= now) ? (rcc_restore.tick_mark - now)
+                                           : (rcc_restore.tick_mark + (SYST_RVR + 1U) - now);
+    rcc_restore.elapsed_ns += ((uint64_t)ticks * 1000000000ULL) / rcc_restore.tick_hz;
+    rcc_restore.tick_mark = now;
+}
+
+// Private: select the saved SYSCLK and prescalers in one CFGR write
+static void RCC_RestoreSwitch(void) {
+    RCC_CFGR = (RCC_CFGR & ~RCC_CFGR_SW_HPRE_PPRE) |
+               (rcc_restore.snapshot.cfgr & RCC_CFGR_SW_HPRE_PPRE);
+    rcc_restore.budget = RCC_SWITCH_LOOPS;
+    rcc_restore.state = RCC_STATE_WAIT_SWITCH;
+}
+
+// Private: give up on the saved clock and stay on HSI. After a switch
+// timeout SW still selects the saved source, which could come up later: put
+// SW back on HSI and lower the latency only once SWS shows HSI.
+static void RCC_RestoreFallBack(void) {
+    RCC_CFGR &= ~3U;
+    if (RCC_WaitBits(&RCC_CFGR, 3U << 2, CLOCK_SOURCE_HSI << 2, RCC_SWITCH_LOOPS)) {
+        RCC_SetFlashLatency(RCC_GetFlashLatency(RCC_HSI_FREQUENCY));
+    }
+    RCC_CR &= ~(RCC_CR_PLLON | RCC_CR_HSEON);
+    rcc_restore.result = RCC_STARTUP_FALLBACK;
+    rcc_restore.state = RCC_STATE_DONE;
+}
+
+// Start restoring a snapshot right after waking from STOP (SYSCLK on HSI,
+// HSE and PLL off). Writes everything that needs no ready flag, starts HSE
+// and, for an HSI-fed PLL, the PLL straight away. Never blocks: do other
+// wake-up work, then finish with RCC_RestorePoll() or RCC_RestoreComplete().
+// The restore is timed with SysTick; if nothing has started it, it is left
+// free-running from HCLK (no interrupt).
+void RCC_RestoreBegin(const RCC_Snapshot *snapshot) {
+    uint32_t csr = SYST_CSR;
+    uint32_t cr = snapshot->cr;
+    bool pll_on_hse = ((snapshot->cfgr >> 15) & 3) == 2;
+
+    if (!(csr & SYST_CSR_ENABLE)) {
+        csr = SYST_CSR_ENABLE | SYST_CSR_CLKSOURCE;
+        SYST_RVR = SYST_RELOAD_MAX;
+        SYST_CVR = 0;
+        SYST_CSR = csr;
+    }
+
+    rcc_restore.snapshot = *snapshot;
+    rcc_restore.result = RCC_STARTUP_DONE;
+    rcc_restore.elapsed_ns = 0;
+    rcc_restore.tick_mark = SYST_CVR;
+    rcc_restore.tick_hz = RCC_HSI_FREQUENCY >> rcc_ahb_shift[(RCC_CFGR >> 4) & 0xF];
+    if (!(csr & SYST_CSR_CLKSOURCE)) {
+        rcc_restore.tick_hz /= 8;
+    }
+
+    // Target latency first: extra wait states are harmless on HSI
+    FLASH->ACR = snapshot->flash_acr;
+    RCC_CFGR2 = snapshot->cfgr2;
+    RCC_CFGR3 = snapshot->cfgr3;
+    RCC_CFGR = (snapshot->cfgr & ~RCC_CFGR_SW_HPRE_PPRE) | (RCC_CFGR & RCC_CFGR_SW_HPRE_PPRE);
+
+    RCC_CR |= cr & RCC_CR_HSEBYP;    // Must precede HSEON
+    RCC_CR |= cr & (RCC_CR_HSION | RCC_CR_HSEON);
+    if ((cr & RCC_CR_PLLON) && !pll_on_hse) {
+        RCC_CR |= RCC_CR_PLLON;      // HSI is already running: lock now
+    }
+
+    rcc_restore.budget = (cr & RCC_CR_HSEON) ? RCC_HSE_STARTUP_LOOPS : RCC_OSC_STARTUP_LOOPS;
+    rcc_restore.state = RCC_STATE_WAIT_OSC;
+}
+
+// Advance a restore by one step. Never blocks.
+RCC_StartupStatus RCC_RestorePoll(void) {
+    uint32_t cr = rcc_restore.snapshot.cr;
+
+    switch (rcc_restore.state) {
+        case RCC_STATE_WAIT_OSC:
+            if (!(cr & RCC_CR_HSEON) || (RCC_CR & RCC_CR_HSERDY)) {
+                if (!(cr & RCC_CR_PLLON)) {
+                    RCC_RestoreSwitch();
+                } else {
+                    RCC_CR |= RCC_CR_PLLON;   // No-op if already started
+                    rcc_restore.budget = RCC_PLL_LOCK_LOOPS;
+                    rcc_restore.state = RCC_STATE_WAIT_PLL;
+                }
+            } else if (rcc_restore.budget-- == 0) {
+                RCC_RestoreFallBack();
+            }
+            break;
+
+        case RCC_STATE_WAIT_PLL:
+            if (RCC_CR & RCC_CR_PLLRDY) {
+                RCC_RestoreSwitch();
+            } else if (rcc_restore.budget-- == 0) {
+                RCC_RestoreFallBack();
+            }
+            break;
+
+        case RCC_STATE_WAIT_SWITCH:
+            if (((RCC_CFGR >> 2) & 3) == (rcc_restore.snapshot.cfgr & 3)) {
+                RCC_CR |= cr & RCC_CR_CSSON;
+                rcc_restore.state = RCC_STATE_DONE;
+            } else if (rcc_restore.budget-- == 0) {
+                RCC_RestoreFallBack();
+            }
+            break;
+
+        case RCC_STATE_IDLE:
+        case RCC_STATE_DONE:
+            return rcc_restore.result;
+    }
+
+    RCC_RestoreTimerStep();
+    if (rcc_restore.state != RCC_STATE_DONE) {
+        return RCC_STARTUP_BUSY;
+    }
+
+    rcc_restore_latency_us = (uint32_t)(rcc_restore.elapsed_ns / 1000U);
+    RCC_UpdateClockCache();
+    RCC_NotifyClockChange(RCC_CLOCK_POST_CHANGE);
+    return rcc_restore.result;
+}
+
+// Finish a restore (bounded wait). Returns false if the saved clock could
+// not be brought back; SYSCLK then stays on HSI.
+bool RCC_RestoreComplete(void) {
+    RCC_StartupStatus status;
+
+    do {
+        status = RCC_RestorePoll();
+    } while (status == RCC_STARTUP_BUSY);
+
+    return status == RCC_STARTUP_DONE;
+}
+
+// Time from RCC_RestoreBegin() to the saved SYSCLK running, in microseconds
+// (SysTick is started by RCC_RestoreBegin() if needed). Ticks are converted at the HSI rate, which is
+// what runs until the final switch.
+uint32_t RCC_GetRestoreLatency(void) {
+    return rcc_restore_latency_us;
+}
+
+// Clock Security System: HSE failed and hardware has already switched SYSCLK
+// to HSI and stopped HSE (and an HSE-fed PLL). Only make that state safe
+// here: clear the flag, make sure SYSCLK is on HSI (any latency is fine at
+// 8 MHz), refresh the cache and leave the rest to RCC_ServiceCSS().
+void NMI_Handler(void) {
+    if (!(RCC_CIR & RCC_CIR_CSSF)) {
+        return;
+    }
+
+    RCC_CIR |= RCC_CIR_CSSC;
+    if (((RCC_CFGR >> 2) & 3) != CLOCK_SOURCE_HSI) {
+        RCC_CFGR &= ~3U;
+    }
+    RCC_UpdateClockCache();
+    rcc_css_events++;
+    rcc_css_pending = true;
+}
+
+// Finish handling a CSS event in thread context (call from the main loop):
+// bring up the HSI equivalent of the active configuration and notify the
+// clock listeners. Returns true if an event was handled. While a bring-up
+// is still in progress the event is kept for a later call.
+bool RCC_ServiceCSS(void) {
+    RCC_Config fallback;
+
+    if (!rcc_css_pending ||
+        (rcc_startup.state != RCC_STATE_IDLE && rcc_startup.state != RCC_STATE_DONE)) {
+        return false;
+    }
+    rcc_css_pending = false;
+
+    fallback = rcc_startup.config;
+    RCC_MakeFallbackConfig(&fallback);
+    RCC_Init(&fallback);
+    return true;
+}
+
+// Enable HSI oscillator
+bool RCC_EnableHSI(void) {
+    RCC_CR |= RCC_CR_HSION;
+    return RCC_WaitBits(&RCC_CR, RCC_CR_HSIRDY, RCC_CR_HSIRDY, RCC_OSC_STARTUP_LOOPS);
+}
+
+// Enable HSE oscillator. Returns false if the crystal does not start.
+bool RCC_EnableHSE(void) {
+    RCC_CR |= RCC_CR_HSEON;
+    if (!RCC_WaitBits(&RCC_CR, RCC_CR_HSERDY, RCC_CR_HSERDY, RCC_HSE_STARTUP_LOOPS)) {
+        RCC_CR &= ~RCC_CR_HSEON;
+        return false;
+    }
+    return true;
+}
+
+// Enable HSI48 oscillator (F04x/F07x/F09x only)
+bool RCC_EnableHSI48(void) {
+#if DEVICE_HAS_HSI48
+    RCC_CR2 |= RCC_CR2_HSI48ON;
+    return RCC_WaitBits(&RCC_CR2, RCC_CR2_HSI48RDY, RCC_CR2_HSI48RDY, RCC_OSC_STARTUP_LOOPS);
+#else
+    return false;
+#endif
+}
+
+// Enable PLL
+bool RCC_EnablePLL(void) {
+    RCC_CR |= RCC_CR_PLLON;
+    return RCC_WaitBits(&RCC_CR, RCC_CR_PLLRDY, RCC_CR_PLLRDY, RCC_PLL_LOCK_LOOPS);
+}
+
 // Disable HSI oscillator
 void RCC_DisableHSI(void) {
-    RCC_CR &= ~(1 << 0); // Clear HSION bit
+    RCC_CR &= ~RCC_CR_HSION;
 }
 
 // Disable HSE oscillator
 void RCC_DisableHSE(void) {
-    RCC_CR &= ~(1 << 16); // Clear HSEON bit
+    RCC_CR &= ~RCC_CR_HSEON;
 }
 
-// Disable PLL
-void RCC_DisablePLL(void) {
-    RCC_CR &= ~(1 << 24); // Clear PLLON bit
-
-    // Wait for PLL to stop
-    while (RCC_CR & (1 << 25)) {
-        // Wait for PLLRDY to clear
-    }
+// Disable PLL. Fails if the PLL is still the system clock.
+bool RCC_DisablePLL(void) {
+    RCC_CR &= ~RCC_CR_PLLON;
+    return RCC_WaitBits(&RCC_CR, RCC_CR_PLLRDY, 0, RCC_PLL_LOCK_LOOPS);
 }
 
 // Disable HSI48 oscillator (F04x/F07x/F09x only)
 void RCC_DisableHSI48(void) {
-    if (!RCC_IsDeviceF04xF07xF09x()) return;
-
-    RCC_CR2 &= ~(1 << 16); // Clear HSI48ON bit
+#if DEVICE_HAS_HSI48
+    RCC_CR2 &= ~RCC_CR2_HSI48ON;
+#endif
 }
 
-// Set system clock source
-void RCC_SetSystemClockSource(ClockSource source) {
-    // Clear SW bits
-    RCC_CFGR &= ~(3 << 0);
+// Set system clock source (single SW write, bounded wait for SWS)
+bool RCC_SetSystemClockSource(ClockSource source) {
+    bool switched;
 
-    // Set new source
-    RCC_CFGR |= (source << 0);
+    RCC_CFGR = (RCC_CFGR & ~3U) | (uint32_t)source;
+    switched = RCC_WaitBits(&RCC_CFGR, 3U << 2, (uint32_t)source << 2, RCC_SWITCH_LOOPS);
 
-    // Wait for switch
-    while (((RCC_CFGR >> 2) & 3) != source) {
-        // Wait for SWS to match
-    }
+    RCC_UpdateClockCache();
+    return switched;
 }
 
 // Set AHB prescaler
 void RCC_SetAHBPrescaler(AHBPrescaler prescaler) {
     RCC_CFGR &= ~(0xF << 4);    // Clear HPRE bits
     RCC_CFGR |= (prescaler << 4); // Set new prescaler
+
+    RCC_UpdateClockCache();
 }
 
 // Set APB prescaler (APB1 and APB2 share same prescaler in F0)
 void RCC_SetAPBPrescaler(APBPrescaler prescaler) {
     RCC_CFGR &= ~(7 << 8);     // Clear PPRE bits
     RCC_CFGR |= (prescaler << 8); // Set new prescaler
+
+    RCC_UpdateClockCache();
 }
 
 // Configure PLL source and multiplier
@@ -140,267 +682,399 @@ void RCC_SetPLLConfig(PLLSource source, uint8_t multiplier) {
         RCC_DisablePLL();
     }
 
-    // Configure PLL source
-    if (RCC_IsDeviceF04xF07xF09x()) {
-        RCC_CFGR &= ~(3 << 15); // Clear PLLSRC bits
-        RCC_CFGR |= (source << 15);
-    } else {
-        // F03x/F05x devices
-        RCC_CFGR &= ~(1 << 16); // Clear PLLSRC bit
-        RCC_CFGR |= ((source & 0x01) << 16);
+    // Configure PLL source: PLLSRC (CFGR bits 16:15) and PREDIV (CFGR2 bits 3:0)
+    // 00 = HSI/2, 10 = HSE/PREDIV, 11 = HSI48/PREDIV (F04x/F07x/F09x only).
+    // Parts without PLLSRC[0] (F051) only see bit 16, so 0 and 2 are valid there.
+    uint32_t pllsrc = 0;
+    uint32_t prediv = 0;
+    switch (source) {
+        case PLL_SOURCE_HSI_DIV2:   pllsrc = 0; prediv = 0; break;
+        case PLL_SOURCE_HSE:        pllsrc = 2; prediv = 0; break;
+        case PLL_SOURCE_HSE_DIV2:   pllsrc = 2; prediv = 1; break;
+        case PLL_SOURCE_HSI48_DIV2:
+#if DEVICE_HAS_HSI48
+            pllsrc = 3; prediv = 1;
+            break;
+#else
+            return;
+#endif
     }
+    RCC_CFGR2 = (RCC_CFGR2 & ~0xFU) | prediv;
+    RCC_CFGR = (RCC_CFGR & ~(3U << 15)) | (pllsrc << 15);
 
     // Configure PLL multiplier (2-16)
     if (multiplier >= 2 && multiplier <= 16) {
         RCC_CFGR &= ~(0xF << 18); // Clear PLLMUL bits
 
-        // Convert multiplier to PLLMUL encoding
-        uint8_t pllmul_encoding;
-        if (multiplier == 16) pllmul_encoding = 0x7; // 0111 for x16
-        else if (multiplier >= 6 && multiplier <= 15) pllmul_encoding = multiplier - 2;
-        else if (multiplier == 5) pllmul_encoding = 0x3; // 0011 for x5
-        else if (multiplier == 4) pllmul_encoding = 0x2; // 0010 for x4
-        else if (multiplier == 3) pllmul_encoding = 0x1; // 0001 for x3
-        else pllmul_encoding = 0x0; // 0000 for x2
-
-        RCC_CFGR |= (pllmul_encoding << 18);
+        // PLLMUL encoding is multiplier - 2 (0000 = x2 ... 1110 = x16)
+        RCC_CFGR |= ((uint32_t)(multiplier - 2) << 18);
     }
 
     // Re-enable PLL if it was enabled
     if (pll_was_enabled) {
         RCC_EnablePLL();
     }
+
+    RCC_UpdateClockCache();
 }
 
-// Get current system clock frequency
+// Get current system clock frequency (cached)
 uint32_t RCC_GetSystemClockFrequency(void) {
-    ClockSource source = (RCC_CFGR >> 2) & 3; // Read SWS bits
+    return rcc_sysclk_hz;
+}
 
-    switch (source) {
-        case CLOCK_SOURCE_HSI:
-            return 8000000UL; // 8 MHz HSI
+// Get current AHB clock frequency (cached)
+uint32_t RCC_GetHCLKFrequency(void) {
+    return rcc_hclk_hz;
+}
 
-        case CLOCK_SOURCE_HSE:
-            return 8000000UL; // Default HSE frequency (adjust based on crystal)
+// Get current APB clock frequency (cached)
+uint32_t RCC_GetPCLKFrequency(void) {
+    return rcc_pclk_hz;
+}
 
-        case CLOCK_SOURCE_PLL:
-            // Pass NULL since we don't have a config structure here
-            return RCC_CalculatePLLFrequency(NULL);
+// Set the HSI trim (RCC_CR HSITRIM, bits 7:3, reset value 16). Each step
+// moves HSI by roughly 40 kHz.
+void RCC_SetHSITrim(uint8_t trim) {
+    if (trim > RCC_HSI_TRIM_MAX) trim = RCC_HSI_TRIM_MAX;
+    RCC_CR = (RCC_CR & ~(0x1FU << 3)) | ((uint32_t)trim << 3);
+}
 
-        case CLOCK_SOURCE_HSI48:
-            return 48000000UL; // 48 MHz HSI48
+// Current HSI trim
+uint8_t RCC_GetHSITrim(void) {
+    return (uint8_t)((RCC_CR >> 3) & 0x1FU);
+}
 
-        default:
-            return 8000000UL; // Default to HSI
-    }
+// Tell the driver which HSE crystal/clock is fitted (default 8 MHz)
+void RCC_SetHSEFrequency(uint32_t hse_hz) {
+    rcc_hse_hz = hse_hz;
+    RCC_UpdateClockCache();
 }
 
-// Enable peripheral clock
-void RCC_EnablePeripheralClock(uint8_t peripheral_type, uint8_t peripheral_num) {
-    uint8_t peripheral_group = peripheral_type >> 4;
-    uint8_t peripheral_index = peripheral_type & 0x0F;
+// Flash wait states needed for a SYSCLK frequency (unknown = worst case)
+uint8_t RCC_GetFlashLatency(uint32_t sysclk_hz) {
+    return (sysclk_hz == 0 || sysclk_hz > RCC_FLASH_0WS_MAX) ? 1 : 0;
+}
 
-    switch (peripheral_group) {
-        case 0x0: // GPIOs
-            RCC_AHBENR |= (1 << (17 + peripheral_index));
-            break;
+// Program flash wait states (prefetch stays enabled)
+void RCC_SetFlashLatency(uint8_t latency) {
+    FLASH->ACR = (FLASH->ACR & ~FLASH_ACR_LATENCY_Msk) | FLASH_ACR_PRFTBE | latency;
 
-        case 0x8: // DMA
-            if (peripheral_num == 1) RCC_AHBENR |= (1 << 0);
-            else if (peripheral_num == 2 && RCC_IsDeviceF04xF07xF09x())
-                RCC_AHBENR |= (1 << 1);
-            break;
+    // Wait for the new latency to take effect
+    while ((FLASH->ACR & FLASH_ACR_LATENCY_Msk) != latency) {
+    }
+}
 
-        case 0x9: // Timers
-            switch (peripheral_num) {
-                case 1: RCC_APB2ENR |= (1 << 11); break;
-                case 2: RCC_APB1ENR |= (1 << 0); break;
-                case 3: RCC_APB1ENR |= (1 << 1); break;
-                case 14: RCC_APB1ENR |= (1 << 8); break;
-                case 15: RCC_APB2ENR |= (1 << 16); break;
-                case 16: RCC_APB2ENR |= (1 << 17); break;
-                case 17: RCC_APB2ENR |= (1 << 18); break;
-            }
-            break;
+// Work out an RCC_Config that produces the requested SYSCLK/HCLK/PCLK exactly.
+// Candidates are tried from lowest to highest power: HSI alone, HSE alone,
+// PLL from HSI/2, PLL from HSE/PREDIV (smallest PREDIV first, e.g. 12 MHz
+// HSE /3 x10 for 40 MHz). Returns false if no setup hits every target.
+bool RCC_SolveConfig(const RCC_ClockRequest *request, RCC_Config *config, uint8_t *flash_latency) {
+    static const uint16_t ahb_dividers[] = { 1, 2, 4, 8, 16, 64, 128, 256, 512 };
+    static const AHBPrescaler ahb_codes[] = {
+        AHB_PRESCALER_1, AHB_PRESCALER_2, AHB_PRESCALER_4, AHB_PRESCALER_8, AHB_PRESCALER_16,
+        AHB_PRESCALER_64, AHB_PRESCALER_128, AHB_PRESCALER_256, AHB_PRESCALER_512
+    };
+    static const uint8_t apb_dividers[] = { 1, 2, 4, 8, 16 };
+    static const APBPrescaler apb_codes[] = {
+        APB_PRESCALER_1, APB_PRESCALER_2, APB_PRESCALER_4, APB_PRESCALER_8, APB_PRESCALER_16
+    };
+    uint32_t sysclk = request->sysclk_hz ? request->sysclk_hz : request->hclk_hz;
+    uint32_t hclk = request->hclk_hz ? request->hclk_hz : sysclk;
+    uint32_t pclk = request->pclk_hz ? request->pclk_hz : hclk;
+    uint32_t hse = request->hse_hz;
+    uint8_t multiplier;
+    uint8_t prediv;
+    uint32_t i;
+
+    if (sysclk == 0 || (hse != 0 && (hse < RCC_HSE_MIN || hse > RCC_HSE_MAX))) {
+        return false;
+    }
 
-        case 0xA: // USARTs
-            switch (peripheral_num) {
-                case 1: RCC_APB2ENR |= (1 << 14); break;
-                case 2: RCC_APB1ENR |= (1 << 17); break;
-                case 3: RCC_APB1ENR |= (1 << 18); break;
-            }
-            break;
+    config->target_frequency = (SystemClockFreq)sysclk;
+    config->hse_enabled = false;
+    config->pll_enabled = false;
+    config->pll_source = PLL_SOURCE_HSI_DIV2;
+    config->pll_multiplier = 2;
+    config->pll_prediv = 1;
+    config->hsi48_enabled = false;
+    config->css_enabled = false;
+    config->hse_hz = hse;
+
+    // SYSCLK source
+    if (sysclk == RCC_HSI_FREQUENCY) {
+        config->system_clock_source = CLOCK_SOURCE_HSI;
+    } else if (hse != 0 && sysclk == hse) {
+        config->system_clock_source = CLOCK_SOURCE_HSE;
+        config->hse_enabled = true;
+    } else if ((multiplier = RCC_GetPLLMultiplier(sysclk, RCC_HSI_FREQUENCY / 2)) != 0) {
+        config->system_clock_source = CLOCK_SOURCE_PLL;
+        config->pll_enabled = true;
+        config->pll_multiplier = multiplier;
+    } else if (hse != 0 && (prediv = RCC_GetHSEPrediv(sysclk, hse, &multiplier)) != 0) {
+        config->system_clock_source = CLOCK_SOURCE_PLL;
+        config->hse_enabled = true;
+        config->pll_enabled = true;
+        config->pll_source = PLL_SOURCE_HSE;
+        config->pll_multiplier = multiplier;
+        config->pll_prediv = prediv;
+    } else {
+        return false;
+    }
 
-        case 0xB: // SPI
-            if (peripheral_num == 1) RCC_APB2ENR |= (1 << 12);
-            else if (peripheral_num == 2) RCC_APB1ENR |= (1 << 14);
+    // Prescalers must divide exactly
+    for (i = 0; i < sizeof(ahb_dividers) / sizeof(ahb_dividers[0]); i++) {
+        if ((uint64_t)hclk * ahb_dividers[i] == sysclk) {
             break;
+        }
+    }
+    if (i == sizeof(ahb_dividers) / sizeof(ahb_dividers[0])) {
+        return false;
+    }
+    config->ahb_prescaler = ahb_codes[i];
 
-        case 0xC: // I2C
-            if (peripheral_num == 1) RCC_APB1ENR |= (1 << 21);
-            else if (peripheral_num == 2) RCC_APB1ENR |= (1 << 22);
+    for (i = 0; i < sizeof(apb_dividers) / sizeof(apb_dividers[0]); i++) {
+        if ((uint64_t)pclk * apb_dividers[i] == hclk) {
             break;
+        }
+    }
+    if (i == sizeof(apb_dividers) / sizeof(apb_dividers[0])) {
+        return false;
+    }
+    config->apb_prescaler = apb_codes[i];
 
-        case 0xD: // ADC/DAC
-            if (peripheral_num == 0) RCC_APB2ENR |= (1 << 9); // ADC
-            else if (peripheral_num == 1) RCC_APB1ENR |= (1 << 29); // DAC
-            break;
+    if (flash_latency != NULL) {
+        *flash_latency = RCC_GetFlashLatency(sysclk);
+    }
+    return true;
+}
 
-        case 0xE: // USB (F04x/F07x only)
-            if (RCC_IsDeviceF04xF07xF09x()) {
-                RCC_APB1ENR |= (1 << 23);
-            }
-            break;
+// Peripheral clock descriptors: enable register and bit for each PERIPH_* ID.
+// Peripherals the device does not have use RCC_BUS_NONE.
+typedef enum {
+    RCC_BUS_NONE = 0,
+    RCC_BUS_AHB,
+    RCC_BUS_APB1,
+    RCC_BUS_APB2
+} RCC_Bus;
+
+typedef struct {
+    uint8_t bus;    // RCC_Bus
+    uint8_t bit;    // Bit in xxxENR (and xxxRSTR where the peripheral has one)
+} RCC_PeriphDesc;
+
+#define RCC_DESC(present, bus, bit)  { (present) ? (bus) : RCC_BUS_NONE, (bit) }
+
+_Static_assert(PERIPH_COUNT == 32, "peripheral sets are 32-bit masks");
+
+static const RCC_PeriphDesc rcc_periph_desc[PERIPH_COUNT] = {
+    [PERIPH_GPIOA]  = { RCC_BUS_AHB, 17 },
+    [PERIPH_GPIOB]  = { RCC_BUS_AHB, 18 },
+    [PERIPH_GPIOC]  = { RCC_BUS_AHB, 19 },
+    [PERIPH_GPIOD]  = { RCC_BUS_AHB, 20 },
+    [PERIPH_GPIOE]  = { RCC_BUS_AHB, 21 },
+    [PERIPH_GPIOF]  = { RCC_BUS_AHB, 22 },
+    [PERIPH_DMA1]   = { RCC_BUS_AHB, 0 },
+    [PERIPH_DMA2]   = RCC_DESC(DEVICE_HAS_DMA2, RCC_BUS_AHB, 1),
+    [PERIPH_CRC]    = { RCC_BUS_AHB, 6 },
+    [PERIPH_TSC]    = { RCC_BUS_AHB, 24 },
+    [PERIPH_TIM1]   = { RCC_BUS_APB2, 11 },
+    [PERIPH_TIM2]   = { RCC_BUS_APB1, 0 },
+    [PERIPH_TIM3]   = { RCC_BUS_APB1, 1 },
+    [PERIPH_TIM6]   = { RCC_BUS_APB1, 4 },
+    [PERIPH_TIM14]  = { RCC_BUS_APB1, 8 },
+    [PERIPH_TIM15]  = { RCC_BUS_APB2, 16 },
+    [PERIPH_TIM16]  = { RCC_BUS_APB2, 17 },
+    [PERIPH_TIM17]  = { RCC_BUS_APB2, 18 },
+    [PERIPH_USART1] = { RCC_BUS_APB2, 14 },
+    [PERIPH_USART2] = { RCC_BUS_APB1, 17 },
+    [PERIPH_USART3] = RCC_DESC(DEVICE_HAS_USART3, RCC_BUS_APB1, 18),
+    [PERIPH_SPI1]   = { RCC_BUS_APB2, 12 },
+    [PERIPH_SPI2]   = { RCC_BUS_APB1, 14 },
+    [PERIPH_I2C1]   = { RCC_BUS_APB1, 21 },
+    [PERIPH_I2C2]   = { RCC_BUS_APB1, 22 },
+    [PERIPH_ADC]    = { RCC_BUS_APB2, 9 },
+    [PERIPH_DAC]    = RCC_DESC(DEVICE_HAS_DAC, RCC_BUS_APB1, 29),
+    [PERIPH_USB]    = RCC_DESC(DEVICE_HAS_USB, RCC_BUS_APB1, 23),
+    [PERIPH_SYSCFG] = { RCC_BUS_APB2, 0 },
+    [PERIPH_PWR]    = { RCC_BUS_APB1, 28 },
+    [PERIPH_WWDG]   = { RCC_BUS_APB1, 11 },
+    [PERIPH_CEC]    = { RCC_BUS_APB1, 30 },
+};
+
+// AHBRSTR only has reset bits for the GPIO ports and TSC
+#define RCC_AHBRSTR_VALID   ((0x3FU << 17) | (1U << 24))
+
+// Private: fold a peripheral set into one mask per bus
+static void RCC_CollectMasks(uint32_t set, uint32_t mask[4]) {
+    uint32_t id;
+
+    mask[RCC_BUS_NONE] = 0;
+    mask[RCC_BUS_AHB] = 0;
+    mask[RCC_BUS_APB1] = 0;
+    mask[RCC_BUS_APB2] = 0;
+
+    for (id = 0; set != 0; id++, set >>= 1) {
+        if (set & 1U) {
+            mask[rcc_periph_desc[id].bus] |= 1U << rcc_periph_desc[id].bit;
+        }
     }
 }
 
-// Disable peripheral clock
-void RCC_DisablePeripheralClock(uint8_t peripheral_type, uint8_t peripheral_num) {
-    uint8_t peripheral_group = peripheral_type >> 4;
-    uint8_t peripheral_index = peripheral_type & 0x0F;
+// Enable the clocks of every peripheral in set (one write per ENR register)
+void RCC_EnableClocks(uint32_t set) {
+    uint32_t mask[4];
 
-    switch (peripheral_group) {
-        case 0x0: // GPIOs
-            RCC_AHBENR &= ~(1 << (17 + peripheral_index));
-            break;
+    RCC_CollectMasks(set, mask);
+    if (mask[RCC_BUS_AHB]) RCC_AHBENR |= mask[RCC_BUS_AHB];
+    if (mask[RCC_BUS_APB1]) RCC_APB1ENR |= mask[RCC_BUS_APB1];
+    if (mask[RCC_BUS_APB2]) RCC_APB2ENR |= mask[RCC_BUS_APB2];
+}
 
-        case 0x8: // DMA
-            if (peripheral_num == 1) RCC_AHBENR &= ~(1 << 0);
-            else if (peripheral_num == 2 && RCC_IsDeviceF04xF07xF09x())
-                RCC_AHBENR &= ~(1 << 1);
-            break;
+// Disable the clocks of every peripheral in set (one write per ENR register)
+void RCC_DisableClocks(uint32_t set) {
+    uint32_t mask[4];
 
-        case 0x9: // Timers
-            switch (peripheral_num) {
-                case 1: RCC_APB2ENR &= ~(1 << 11); break;
-                case 2: RCC_APB1ENR &= ~(1 << 0); break;
-                case 3: RCC_APB1ENR &= ~(1 << 1); break;
-                case 14: RCC_APB1ENR &= ~(1 << 8); break;
-                case 15: RCC_APB2ENR &= ~(1 << 16); break;
-                case 16: RCC_APB2ENR &= ~(1 << 17); break;
-                case 17: RCC_APB2ENR &= ~(1 << 18); break;
-            }
+    RCC_CollectMasks(set, mask);
+    if (mask[RCC_BUS_AHB]) RCC_AHBENR &= ~mask[RCC_BUS_AHB];
+    if (mask[RCC_BUS_APB1]) RCC_APB1ENR &= ~mask[RCC_BUS_APB1];
+    if (mask[RCC_BUS_APB2]) RCC_APB2ENR &= ~mask[RCC_BUS_APB2];
+}
+
+// Pulse the reset line of every peripheral in set. Peripherals without a
+// reset bit (DMA, CRC) are skipped.
+void RCC_ResetPeripherals(uint32_t set) {
+    uint32_t mask[4];
+
+    RCC_CollectMasks(set, mask);
+    mask[RCC_BUS_AHB] &= RCC_AHBRSTR_VALID;
+
+    if (mask[RCC_BUS_AHB]) RCC_AHBRSTR |= mask[RCC_BUS_AHB];
+    if (mask[RCC_BUS_APB1]) RCC_APB1RSTR |= mask[RCC_BUS_APB1];
+    if (mask[RCC_BUS_APB2]) RCC_APB2RSTR |= mask[RCC_BUS_APB2];
+
+    if (mask[RCC_BUS_AHB]) RCC_AHBRSTR &= ~mask[RCC_BUS_AHB];
+    if (mask[RCC_BUS_APB1]) RCC_APB1RSTR &= ~mask[RCC_BUS_APB1];
+    if (mask[RCC_BUS_APB2]) RCC_APB2RSTR &= ~mask[RCC_BUS_APB2];
+}
+
+// Enable one peripheral clock
+void RCC_EnablePeripheralClock(RCC_Peripheral peripheral) {
+    RCC_EnableClocks(RCC_PERIPH(peripheral));
+}
+
+// Disable one peripheral clock
+void RCC_DisablePeripheralClock(RCC_Peripheral peripheral) {
+    RCC_DisableClocks(RCC_PERIPH(peripheral));
+}
+
+// Private: Decode RCC_CFGR/RCC_CFGR2 into the cached frequencies
+static void RCC_UpdateClockCache(void) {
+    uint32_t cfgr = RCC_CFGR;
+    uint32_t sysclk;
+
+    switch ((cfgr >> 2) & 3) {   // SWS
+        case CLOCK_SOURCE_HSE:
+            sysclk = rcc_hse_hz;
             break;
 
-        case 0xA: // USARTs
-            switch (peripheral_num) {
-                case 1: RCC_APB2ENR &= ~(1 << 14); break;
-                case 2: RCC_APB1ENR &= ~(1 << 17); break;
-                case 3: RCC_APB1ENR &= ~(1 << 18); break;
+        case CLOCK_SOURCE_PLL: {
+            uint32_t prediv = (RCC_CFGR2 & 0xFU) + 1;
+            uint32_t multiplier = ((cfgr >> 18) & 0xFU) + 2;
+            uint32_t input;
+
+#if DEVICE_HAS_PLLSRC_HSI
+            switch ((cfgr >> 15) & 3) {   // PLLSRC
+                case 0:  input = RCC_HSI_FREQUENCY / 2; break;
+                case 1:  input = RCC_HSI_FREQUENCY / prediv; break;
+                case 2:  input = rcc_hse_hz / prediv; break;
+                default: input = 48000000UL / prediv; break;
             }
+#else
+            // Only PLLSRC[1] exists: HSI/2 or HSE/PREDIV
+            input = (cfgr & (1U << 16)) ? rcc_hse_hz / prediv : RCC_HSI_FREQUENCY / 2;
+#endif
+            sysclk = input * (multiplier > 16 ? 16 : multiplier);
             break;
+        }
 
-        case 0xB: // SPI
-            if (peripheral_num == 1) RCC_APB2ENR &= ~(1 << 12);
-            else if (peripheral_num == 2) RCC_APB1ENR &= ~(1 << 14);
+#if DEVICE_HAS_HSI48
+        case CLOCK_SOURCE_HSI48:
+            sysclk = 48000000UL;
             break;
+#endif
 
-        case 0xC: // I2C
-            if (peripheral_num == 1) RCC_APB1ENR &= ~(1 << 21);
-            else if (peripheral_num == 2) RCC_APB1ENR &= ~(1 << 22);
+        default:
+            sysclk = RCC_HSI_FREQUENCY;
             break;
+    }
 
-        case 0xD: // ADC/DAC
-            if (peripheral_num == 0) RCC_APB2ENR &= ~(1 << 9); // ADC
-            else if (peripheral_num == 1) RCC_APB1ENR &= ~(1 << 29); // DAC
-            break;
+    rcc_sysclk_hz = sysclk;
+    rcc_hclk_hz = sysclk >> rcc_ahb_shift[(cfgr >> 4) & 0xF];
+    rcc_pclk_hz = rcc_hclk_hz >> rcc_apb_shift[(cfgr >> 8) & 0x7];
+}
 
-        case 0xE: // USB (F04x/F07x only)
-            if (RCC_IsDeviceF04xF07xF09x()) {
-                RCC_APB1ENR &= ~(1 << 23);
-            }
-            break;
+// Private: PLL multiplier giving exactly output_hz from input_hz, 0 if none
+static uint8_t RCC_GetPLLMultiplier(uint32_t output_hz, uint32_t input_hz) {
+    uint32_t multiplier;
+
+    if (input_hz < RCC_PLL_INPUT_MIN || input_hz > RCC_PLL_INPUT_MAX ||
+        output_hz < RCC_PLL_OUTPUT_MIN || output_hz > RCC_PLL_OUTPUT_MAX ||
+        output_hz % input_hz != 0) {
+        return 0;
     }
+
+    multiplier = output_hz / input_hz;
+    return (multiplier >= 2 && multiplier <= 16) ? (uint8_t)multiplier : 0;
 }
 
-// Private: Configure PLL based on config
-static void RCC_ConfigurePLL(const RCC_Config *config) {
-    RCC_SetPLLConfig(config->pll_source, config->pll_multiplier);
-}
-
-// Private: Configure complete clock tree
-static void RCC_ConfigureClockTree(const RCC_Config *config) {
-    // Set AHB prescaler
-    RCC_SetAHBPrescaler(config->ahb_prescaler);
-
-    // Set APB prescaler
-    RCC_SetAPBPrescaler(config->apb_prescaler);
-
-    // Set final system clock source
-    RCC_SetSystemClockSource(config->system_clock_source);
-}
-
-// Private: Calculate PLL frequency
-static uint32_t RCC_CalculatePLLFrequency(const RCC_Config *config) {
-    uint32_t pll_input_freq = 0;
-    uint8_t pll_source = (RCC_CFGR >> 15) & 0x03;
-    uint8_t pll_multiplier_encoding = (RCC_CFGR >> 18) & 0x0F;
-    uint8_t pll_multiplier = 2; // Default
-
-    // Decode PLL multiplier
-    switch (pll_multiplier_encoding) {
-        case 0x0: pll_multiplier = 2; break;
-        case 0x1: pll_multiplier = 3; break;
-        case 0x2: pll_multiplier = 4; break;
-        case 0x3: pll_multiplier = 5; break;
-        case 0x4: pll_multiplier = 6; break;
-        case 0x5: pll_multiplier = 7; break;
-        case 0x6: pll_multiplier = 8; break;
-        case 0x7: pll_multiplier = 9; break;
-        case 0x8: pll_multiplier = 10; break;
-        case 0x9: pll_multiplier = 11; break;
-        case 0xA: pll_multiplier = 12; break;
-        case 0xB: pll_multiplier = 13; break;
-        case 0xC: pll_multiplier = 14; break;
-        case 0xD: pll_multiplier = 15; break;
-        case 0xE: pll_multiplier = 16; break;
-        case 0xF: pll_multiplier = 16; break;
-    }
-
-    // Get PLL input frequency
-    if (RCC_IsDeviceF04xF07xF09x()) {
-        switch (pll_source) {
-            case PLL_SOURCE_HSI_DIV2:
-                pll_input_freq = 4000000UL; // HSI / 2
-                break;
-            case PLL_SOURCE_HSE:
-                pll_input_freq = 8000000UL; // HSE directly
-                break;
-            case PLL_SOURCE_HSE_DIV2:
-                pll_input_freq = 4000000UL; // HSE / 2
-                break;
-            case PLL_SOURCE_HSI48_DIV2:
-                pll_input_freq = 24000000UL; // HSI48 / 2
-                break;
-        }
-    } else {
-        // F03x/F05x devices
-        bool pllsrc = (RCC_CFGR >> 16) & 0x01;
-        if (pllsrc) {
-            pll_input_freq = 8000000UL; // HSE
-        } else {
-            pll_input_freq = 4000000UL; // HSI/2
+// Private: smallest PREDIV (1-16) for which HSE/PREDIV x PLLMUL gives exactly
+// output_hz, 0 if none. The matching multiplier goes to *multiplier.
+static uint8_t RCC_GetHSEPrediv(uint32_t output_hz, uint32_t hse_hz, uint8_t *multiplier) {
+    uint8_t prediv;
+
+    for (prediv = 1; prediv <= 16; prediv++) {
+        if (hse_hz % prediv == 0 &&
+            (*multiplier = RCC_GetPLLMultiplier(output_hz, hse_hz / prediv)) != 0) {
+            return prediv;
         }
     }
-
-    return pll_input_freq * pll_multiplier;
+    return 0;
 }
 
-// Private: Check if device is F04x/F07x/F09x
-static bool RCC_IsDeviceF04xF07xF09x(void) {
-    // This is a simplified check. In real implementation,
-    // you would read device ID from DBGMCU or use compile-time flags
-    // For now, we assume F04x/F07x/F09x if HSI48 register exists
+// Private: SYSCLK a configuration produces, decoded from its source, PLL
+// input, PREDIV and multiplier. 0 if the PLL setup is invalid.
+static uint32_t RCC_ConfigSysclk(const RCC_Config *config) {
+    uint32_t hse = config->hse_hz ? config->hse_hz : rcc_hse_hz;
+    uint32_t input;
 
-    // Check if RCC_CR2 register exists by reading a known bit
-    // (HSI48ON bit 16 would be 0 after reset on devices that support it)
-    // Return true for now - you should implement proper device detection
-    return true; // Placeholder - implement based on your device
+    switch (config->system_clock_source) {
+        case CLOCK_SOURCE_HSE:
+            return hse;
+        case CLOCK_SOURCE_HSI48:
+            return 48000000UL;
+        case CLOCK_SOURCE_PLL:
+            break;
+        default:
+            return RCC_HSI_FREQUENCY;
+    }
 
-    // Alternative: Check via compile-time flags
-    // #if defined(STM32F04x) || defined(STM32F07x) || defined(STM32F09x)
-    //     return true;
-    // #else
-    //     return false;
-    // #endif
+    if (config->pll_multiplier < 2 || config->pll_multiplier > 16) {
+        return 0;
+    }
+    switch (config->pll_source) {
+        case PLL_SOURCE_HSE:
+            input = hse / (config->pll_prediv > 1 ? config->pll_prediv : 1U);
+            break;
+        case PLL_SOURCE_HSE_DIV2:
+            input = hse / 2;
+            break;
+        case PLL_SOURCE_HSI48_DIV2:
+            input = 48000000UL / 2;
+            break;
+        default:
+            input = RCC_HSI_FREQUENCY / 2;
+            break;
+    }
+    return input * config->pll_multiplier;
 }
@@ -37,6 +37,13 @@ defined in linker script */
 .word _sdata
 /* end address for the .data section. defined in linker script */
 .word _edata
+/* start address for the initialization values of the .RamFunc section.
+defined in linker script */
+.word _siramfunc
+/* start address for the .RamFunc section. defined in linker script */
+.word _sramfunc
+/* end address for the .RamFunc section. defined in linker script */
+.word _eramfunc
 /* start address for the .bss section. defined in linker script */
 .word _sbss
 /* end address for the .bss section. defined in linker script */
@@ -57,8 +64,15 @@ defined in linker script */
 Reset_Handler:
   ldr   r0, =_estack
   mov   sp, r0          /* set stack pointer */
+#ifdef BOOT_PROFILE
+  bl  Boot_ProfileStart
+#endif
 /* Call the clock system initialization function.*/
   bl  SystemInit
+#ifdef BOOT_PROFILE
+  movs r0, #0           /* BOOT_PHASE_SYSTEMINIT */
+  bl  Boot_ProfileMark
+#endif
 
 /* Copy the data segment initializers from flash to SRAM */
   ldr r0, =_sdata
@@ -77,6 +91,27 @@ LoopCopyDataInit:
   cmp r4, r1
   bcc CopyDataInit
 
+/* Copy the RAM-resident code from flash to SRAM */
+  ldr r0, =_sramfunc
+  ldr r1, =_eramfunc
+  ldr r2, =_siramfunc
+  movs r3, #0
+  b LoopCopyRamFunc
+
+CopyRamFunc:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyRamFunc:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyRamFunc
+#ifdef BOOT_PROFILE
+  movs r0, #1           /* BOOT_PHASE_DATA */
+  bl  Boot_ProfileMark
+#endif
+
 /* Zero fill the bss segment. */
   ldr r2, =_sbss
   ldr r4, =_ebss
@@ -90,9 +125,17 @@ FillZerobss:
 LoopFillZerobss:
   cmp r2, r4
   bcc FillZerobss
+#ifdef BOOT_PROFILE
+  movs r0, #2           /* BOOT_PHASE_BSS */
+  bl  Boot_ProfileMark
+#endif
 
 /* Call static constructors */
   bl __libc_init_array
+#ifdef BOOT_PROFILE
+  movs r0, #3           /* BOOT_PHASE_CTORS */
+  bl  Boot_ProfileMark
+#endif
 /* Call the application's entry point.*/
   bl main
 
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+# Post-build step: patch the image CRC into the linked ELF.
+#
+# The linker script leaves an 8-byte record at _simage_crc, the last two
+# words of FLASH: the image length, then IMAGE_CRC_UNSET. This computes the
+# CRC of the first length bytes of the flashed image (from g_pfnVectors),
+# as the CRC unit does (image_crc.h), and writes it over the second word in
+# the ELF, so the debugger flashes the patched image. Regenerate any .bin or
+# .hex from the ELF afterwards.
+#
+# Run by the CubeIDE post-build step (.cproject):
+#   python3 ${ProjDirPath}/Tools/image_crc_patch.py ${ProjName}.elf
+#
+# The record lies outside the range it covers, so running it twice is fine.
+
+import struct
+import sys
+
+CRC_POLY = 0x04C11DB7
+CRC_INIT = 0xFFFFFFFF
+IMAGE_CRC_UNSET = 0xFFFFFFFF
+ERASED = 0xFF
+PT_LOAD = 1
+SHT_SYMTAB = 2
+
+
+def stm32_crc(data):
+    """CRC unit result for data fed as little-endian words"""
+    crc = CRC_INIT
+    for (word,) in struct.iter_unpack('<I', data):
+        crc ^= word
+        for _ in range(32):
+            crc = ((crc << 1) ^ CRC_POLY) if crc & 0x80000000 else (crc << 1)
+            crc &= 0xFFFFFFFF
+    return crc
+
+
+class Elf32:
+    """Just enough of a little-endian ELF32 file: load segments and symbols"""
+
+    def __init__(self, data):
+        if data[:4] != b'\x7fELF' or data[4] != 1 or data[5] != 1:
+            raise ValueError('not a little-endian ELF32 file')
+        self.data = data
+        (self.phoff, self.shoff, _, _, self.phentsize, self.phnum,
+         self.shentsize, self.shnum, _) = struct.unpack_from('<IIIHHHHHH', data, 28)
+
+    def segments(self):
+        """(physical address, file offset, file size) of each load segment"""
+        for i in range(self.phnum):
+            (p_type, p_offset, _, p_paddr, p_filesz, _, _, _) = struct.unpack_from(
+                '<IIIIIIII', self.data, self.phoff + i * self.phentsize)
+            if p_type == PT_LOAD and p_filesz > 0:
+                yield p_paddr, p_offset, p_filesz
+
+    def symbols(self):
+        """name -> value for every symbol in .symtab"""
+        sections = [struct.unpack_from('<IIIIIIIIII', self.data, self.shoff + i * self.shentsize)
+                    for i in range(self.shnum)]
+        result = {}
+        for (_, sh_type, _, _, offset, size, link, _, _, entsize) in sections:
+            if sh_type != SHT_SYMTAB:
+                continue
+            strtab = sections[link][4]
+            for entry in range(offset, offset + size, entsize):
+                (st_name, st_value) = struct.unpack_from('<II', self.data, entry)
+                end = self.data.index(b'\0', strtab + st_name)
+                result[self.data[strtab + st_name:end].decode()] = st_value
+        return result
+
+    def file_offset(self, address, length):
+        """File offset of length bytes loaded at address, or None"""
+        for paddr, offset, size in self.segments():
+            if paddr <= address and address + length <= paddr + size:
+                return offset + address - paddr
+        return None
+
+    def image(self, start, length):
+        """Flash contents from start, erased where nothing is loaded"""
+        image = bytearray([ERASED]) * length
+        for paddr, offset, size in self.segments():
+            first = max(paddr, start)
+            last = min(paddr + size, start + length)
+            if first < last:
+                image[first - start:last - start] = \
+                    self.data[offset + first - paddr:offset + last - paddr]
+        return bytes(image)
+
+
+def patch(path):
+    with open(path, 'rb') as f:
+        elf = Elf32(bytearray(f.read()))
+
+    symbols = elf.symbols()
+    for name in ('_simage_crc', 'g_pfnVectors'):
+        if name not in symbols:
+            raise ValueError('%s: no %s symbol (linker script or startup file changed?)' % (path, name))
+    record = elf.file_offset(symbols['_simage_crc'], 8)
+    if record is None:
+        raise ValueError('%s: _simage_crc is not in a load segment' % path)
+
+    (length, old) = struct.unpack_from('<II', elf.data, record)
+    if length == 0 or length % 4 != 0:
+        raise ValueError('%s: bad image length %u in the record' % (path, length))
+    crc = stm32_crc(elf.image(symbols['g_pfnVectors'], length))
+    if crc == IMAGE_CRC_UNSET:
+        raise ValueError('%s: CRC equals IMAGE_CRC_UNSET; change the image (e.g. the build id)' % path)
+
+    struct.pack_into('<I', elf.data, record + 4, crc)
+    with open(path, 'wb') as f:
+        f.write(elf.data)
+    print('image_crc: 0x%08X over %u bytes%s' % (crc, length, '' if old == IMAGE_CRC_UNSET else ' (repatched)'))
+
+
+def main(argv):
+    if len(argv) != 2:
+        print('usage: %s <image.elf>' % argv[0], file=sys.stderr)
+        return 2
+    try:
+        patch(argv[1])
+    except (OSError, ValueError) as error:
+        print('image_crc: %s' % error, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -4,13 +4,17 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-// GPIO Base Addresses
+// GPIO Base Addresses (HOST_SIM builds use simulated register blocks)
+#ifdef HOST_SIM
+#include "sim_regs.h"
+#else
 #define GPIOA_BASE       0x48000000UL
 #define GPIOB_BASE       0x48000400UL
 #define GPIOC_BASE       0x48000800UL
 #define GPIOD_BASE       0x48000C00UL
 #define GPIOE_BASE       0x48001000UL
 #define GPIOF_BASE       0x48001400UL
+#endif
 
 // GPIO Register Structure
 typedef struct {
@@ -102,22 +106,31 @@ typedef struct {
 #define GPIO_PIN_14    14
 #define GPIO_PIN_15    15
 
+// Pin mask helper for GPIO_InitMask (e.g. GPIO_PIN_MASK(GPIO_PIN_8) | GPIO_PIN_MASK(GPIO_PIN_9))
+#define GPIO_PIN_MASK(pin)  ((uint16_t)(1U << (pin)))
+#define GPIO_PIN_MASK_ALL   ((uint16_t)0xFFFFU)
+
 // Function Prototypes
 void GPIO_Init(GPIO_TypeDef *GPIOx, uint32_t pin, const GPIO_Config *config);
+void GPIO_InitMask(GPIO_TypeDef *GPIOx, uint16_t pin_mask, const GPIO_Config *config);
 void GPIO_WritePin(GPIO_TypeDef *GPIOx, uint32_t pin, bool state);
 void GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint32_t pin);
+void GPIO_WriteMasked(GPIO_TypeDef *GPIOx, uint16_t mask, uint16_t value);
+void GPIO_ToggleMasked(GPIO_TypeDef *GPIOx, uint16_t mask);
 bool GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint32_t pin);
 void GPIO_SetPin(GPIO_TypeDef *GPIOx, uint32_t pin);
 void GPIO_ResetPin(GPIO_TypeDef *GPIOx, uint32_t pin);
 void GPIO_LockPin(GPIO_TypeDef *GPIOx, uint32_t pin);
 void GPIO_SetAlternateFunction(GPIO_TypeDef *GPIOx, uint32_t pin, GPIO_AlternateFunction af);
+void GPIO_DeInitMask(GPIO_TypeDef *GPIOx, uint16_t pin_mask);
 void GPIO_EnableClock(GPIO_TypeDef *GPIOx);
 void GPIO_DisableClock(GPIO_TypeDef *GPIOx);
+uint16_t GPIO_GetPinsInUse(GPIO_TypeDef *GPIOx);
 
 // Helper Macros
 #define GPIO_SET_PIN(GPIOx, pin)     ((GPIOx)->BSRR = (1U << (pin)))
 #define GPIO_RESET_PIN(GPIOx, pin)   ((GPIOx)->BRR = (1U << (pin)))
-#define GPIO_TOGGLE_PIN(GPIOx, pin)  ((GPIOx)->ODR ^= (1U << (pin)))
+#define GPIO_TOGGLE_PIN(GPIOx, pin)  ((GPIOx)->BSRR = ((GPIOx)->ODR & (1U << (pin))) ? (1U << ((pin) + 16)) : (1U << (pin)))
 #define GPIO_READ_PIN(GPIOx, pin)    (((GPIOx)->IDR >> (pin)) & 0x1U)
 
 #endif // GPIO_H
@@ -0,0 +1,103 @@
+#ifndef GPIO_PIN_HPP
+#define GPIO_PIN_HPP
+
+// Compile-time GPIO pin types for C++ code.
+//
+// Port and bit mask are template constants, so every operation inlines to
+// a single store to BSRR/BRR (or a single load from IDR) with no call, no
+// shift and no runtime port pointer:
+//
+//     using Led = gpio::Pin<gpio::PortC, 9>;
+//     Led::init(led_config);   // Claims the pin, clocking the port
+//     Led::set();              // GPIOC->BSRR = 0x0200
+//     Led::reset();            // GPIOC->BRR  = 0x0200
+//     Led::deinit();           // Releases it; the last pin gates the clock
+//
+// Port clocks are left to the C driver's pin accounting (GPIO_InitMask and
+// GPIO_DeInitMask), so C and C++ users of one port agree on when it can be
+// gated. Under HOST_SIM the port comes from the simulated register blocks,
+// which are not at constant addresses. Host_Sim's test_gpio_pin checks the
+// behaviour, and its codegen check the single-instruction claim.
+
+#include <stdint.h>
+
+extern "C" {
+#include "gpio.h"
+}
+
+namespace gpio {
+
+// Port identifiers: index from GPIOA, the ports sit 0x400 apart
+constexpr uint32_t PortA = 0;
+constexpr uint32_t PortB = 1;
+constexpr uint32_t PortC = 2;
+constexpr uint32_t PortD = 3;
+constexpr uint32_t PortE = 4;
+constexpr uint32_t PortF = 5;
+
+template <uint32_t Port, uint32_t Number>
+struct Pin {
+    static_assert(Port <= PortF, "Port must be one of gpio::PortA..PortF");
+    static_assert(Number < 16, "GPIO pin number must be 0-15");
+
+    static constexpr uint32_t port = Port;
+    static constexpr uint32_t number = Number;
+    static constexpr uint32_t mask = 1UL << Number;
+
+#ifdef HOST_SIM
+    static inline GPIO_TypeDef *regs() {
+        return reinterpret_cast<GPIO_TypeDef *>(Sim_GpioBase(Port));
+    }
+#else
+    static constexpr uintptr_t base = GPIOA_BASE + Port * 0x400UL;
+
+    __attribute__((always_inline)) static inline GPIO_TypeDef *regs() {
+        return reinterpret_cast<GPIO_TypeDef *>(base);
+    }
+#endif
+
+    // Drive the pin high (one store to BSRR)
+    __attribute__((always_inline)) static inline void set() {
+        regs()->BSRR = mask;
+    }
+
+    // Drive the pin low (one store to BRR)
+    __attribute__((always_inline)) static inline void reset() {
+        regs()->BRR = mask;
+    }
+
+    // Drive the pin to state (one store to BSRR, set or reset half)
+    __attribute__((always_inline)) static inline void write(bool state) {
+        regs()->BSRR = state ? mask : (mask << 16);
+    }
+
+    // Flip the pin (one load from ODR, one store to BSRR)
+    __attribute__((always_inline)) static inline void toggle() {
+        uint32_t odr = regs()->ODR;
+        regs()->BSRR = (odr & mask) ? (mask << 16) : mask;
+    }
+
+    // Read the input level (one load from IDR)
+    __attribute__((always_inline)) static inline bool read() {
+        return (regs()->IDR & mask) != 0;
+    }
+
+    // Configure and claim the pin through the C driver's mask-based init
+    static inline void init(const GPIO_Config &config) {
+        GPIO_InitMask(regs(), static_cast<uint16_t>(mask), &config);
+    }
+
+    // Return the pin to its reset state and release it
+    static inline void deinit() {
+        GPIO_DeInitMask(regs(), static_cast<uint16_t>(mask));
+    }
+
+    // True while the driver holds the pin (and so the port clock)
+    static inline bool in_use() {
+        return (GPIO_GetPinsInUse(regs()) & mask) != 0;
+    }
+};
+
+} // namespace gpio
+
+#endif // GPIO_PIN_HPP
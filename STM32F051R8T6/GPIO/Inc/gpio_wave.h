@@ -0,0 +1,44 @@
+#ifndef GPIO_WAVE_H
+#define GPIO_WAVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gpio.h"
+
+// DMA-fed GPIO waveform generator.
+// TIM3 update events trigger DMA1 channel 3, which copies one 32-bit word per
+// event from a buffer into the port's BSRR. The CPU is not involved per
+// sample, so pattern timing does not jitter with interrupts.
+//
+// Each buffer word is a BSRR value: bits 0-15 set pins, bits 16-31 reset
+// pins. GPIO_WAVE_WORD() builds one from a pin mask and the levels wanted.
+
+#define GPIO_WAVE_WORD(mask, value) \
+    ((((uint32_t)(~(value) & (mask)) & 0xFFFFU) << 16) | ((uint32_t)((value) & (mask)) & 0xFFFFU))
+
+// Playback modes
+typedef enum {
+    GPIO_WAVE_ONE_SHOT = 0,     // Play the buffer once, then stop
+    GPIO_WAVE_CIRCULAR = 1      // Loop forever; refill halves from the callbacks
+} GPIO_WaveMode;
+
+typedef void (*GPIO_WaveCallback)(void);
+
+// Waveform configuration
+typedef struct {
+    GPIO_TypeDef *port;
+    const uint32_t *buffer;             // BSRR words
+    uint16_t length;                    // Number of words (1-65535)
+    uint32_t sample_rate_hz;            // Words per second (up to half the TIM3 clock)
+    GPIO_WaveMode mode;
+    GPIO_WaveCallback half_callback;    // First half sent (optional)
+    GPIO_WaveCallback full_callback;    // Whole buffer sent (optional)
+} GPIO_WaveConfig;
+
+// Function Prototypes
+bool GPIO_Wave_Start(const GPIO_WaveConfig *config);
+void GPIO_Wave_Stop(void);
+bool GPIO_Wave_IsBusy(void);
+uint32_t GPIO_Wave_GetErrorCount(void);
+
+#endif // GPIO_WAVE_H
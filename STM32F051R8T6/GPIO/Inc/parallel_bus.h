@@ -0,0 +1,70 @@
+#ifndef PARALLEL_BUS_H
+#define PARALLEL_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gpio.h"
+
+// 8080-style parallel bus (8 or 16 data lines plus active-low WR, RD and CS)
+// built on top of the GPIO driver. All data lines must sit on one port; the
+// strobes may sit on any port, but not on a data pin or on each other. Every
+// transfer costs one BSRR store for the data word plus the strobe stores.
+//
+// Reads wait between the RD falling edge and the IDR sample for the device's
+// access time plus PBUS_IDR_SYNC_CYCLES, the input synchronizer in front of
+// IDR. The wait is worked out from HCLK once per block, so it follows clock
+// changes. Build with -DPBUS_BENCHMARK for the bytes/s figures (main.c).
+
+#define PBUS_MAX_WIDTH   16
+#define PBUS_NO_PIN      0xFFU   // Use for an unused strobe (RD or CS)
+#define PBUS_IDR_SYNC_CYCLES 2U  // HCLK cycles from a pin edge to IDR
+
+// One control line
+typedef struct {
+    GPIO_TypeDef *port;
+    uint8_t pin;                 // 0-15, or PBUS_NO_PIN
+} PBus_Pin;
+
+// Bus description
+typedef struct {
+    GPIO_TypeDef *data_port;
+    uint8_t data_pins[PBUS_MAX_WIDTH];   // data_pins[i] is the port pin carrying bit i
+    uint8_t width;                        // 8 or 16
+    PBus_Pin wr;
+    PBus_Pin rd;
+    PBus_Pin cs;
+    uint16_t read_access_ns;              // Device RD-low-to-data-valid time (tACC)
+} PBus_Config;
+
+// Bus handle with precomputed register words. Treat as opaque.
+typedef struct {
+    GPIO_TypeDef *data_port;
+    GPIO_TypeDef *wr_port;
+    GPIO_TypeDef *rd_port;
+    GPIO_TypeDef *cs_port;
+    uint32_t wr_mask;
+    uint32_t rd_mask;
+    uint32_t cs_mask;
+    uint32_t moder_mask;         // 2-bit MODER fields of the data pins
+    uint32_t moder_output;       // 01 in each data pin field
+    uint16_t data_mask;          // data pins on the port
+    uint16_t value_mask;         // 0xFF or 0xFFFF
+    uint8_t width;
+    uint8_t shift;               // port pin of bit 0 for contiguous layouts
+    uint16_t read_access_ns;
+    bool contiguous;
+    bool data_is_output;
+    uint8_t data_pins[PBUS_MAX_WIDTH];
+    uint32_t lut[PBUS_MAX_WIDTH / 4][16];  // BSRR word per data nibble (non-contiguous layouts)
+} PBus;
+
+// Function Prototypes
+bool PBus_Init(PBus *bus, const PBus_Config *config);
+void PBus_Write(PBus *bus, uint16_t value);
+uint16_t PBus_Read(PBus *bus);
+void PBus_WriteBlock(PBus *bus, const void *data, uint32_t count);
+void PBus_ReadBlock(PBus *bus, void *data, uint32_t count);
+void PBus_Select(PBus *bus);
+void PBus_Deselect(PBus *bus);
+
+#endif // PARALLEL_BUS_H
@@ -4,8 +4,12 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-// RCC Base Address
+// RCC Base Address (HOST_SIM builds use a simulated register block)
+#ifdef HOST_SIM
+#include "sim_regs.h"
+#else
 #define RCC_BASE        0x40021000UL
+#endif
 
 // Register offsets
 #define RCC_CR          (*(volatile uint32_t *)(RCC_BASE + 0x00))
@@ -69,6 +73,8 @@ typedef enum {
     APB_PRESCALER_16 = 7
 } APBPrescaler;
 
+#define RCC_FLASH_0WS_MAX   24000000UL  // Highest SYSCLK with zero wait states
+
 // RCC Configuration structure
 typedef struct {
     ClockSource system_clock_source;
@@ -98,6 +104,10 @@ void RCC_SetAHBPrescaler(AHBPrescaler prescaler);
 void RCC_SetAPBPrescaler(APBPrescaler prescaler);
 void RCC_SetPLLConfig(PLLSource source, uint8_t multiplier);
 uint32_t RCC_GetSystemClockFrequency(void);
+uint32_t RCC_GetHCLKFrequency(void);
+uint32_t RCC_GetPCLKFrequency(void);
+uint8_t RCC_GetFlashLatency(uint32_t sysclk_hz);
+void RCC_SetFlashLatency(uint8_t latency);
 void RCC_EnablePeripheralClock(uint8_t peripheral_type, uint8_t peripheral_num);
 void RCC_DisablePeripheralClock(uint8_t peripheral_type, uint8_t peripheral_num);
 
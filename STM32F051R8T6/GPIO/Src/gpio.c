@@ -1,76 +1,160 @@
 #include "gpio.h"
+#include "rcc.h"
 
-// Enable GPIO clock
+// Ports sit 0x400 apart from GPIOA, and GPIOxEN in RCC_AHBENR is bit 17 + index
+#define GPIO_PORT_COUNT         6U
+#define GPIO_PORT_INDEX(GPIOx)  (((uintptr_t)(GPIOx) - GPIOA_BASE) >> 10)
+#define GPIO_CLOCK_BIT(index)   (1U << (17U + (index)))
+
+// Pins configured through GPIO_Init/GPIO_InitMask, per port, and ports
+// clocked by hand with GPIO_EnableClock. A port's clock stays on while at
+// least one of its pins is in use or the hand hold is set.
+static uint16_t gpio_pins_in_use[GPIO_PORT_COUNT];
+static bool gpio_clock_held[GPIO_PORT_COUNT];
+
+// Enable GPIO clock and keep it on until GPIO_DisableClock, whatever pins
+// are released meanwhile
 void GPIO_EnableClock(GPIO_TypeDef *GPIOx) {
-    uint32_t reg_value = *(volatile uint32_t *)0x40021020UL; // RCC_AHBENR
-
-    if (GPIOx == GPIOA) {
-        reg_value |= (1U << 17); // GPIOAEN
-    } else if (GPIOx == GPIOB) {
-        reg_value |= (1U << 18); // GPIOBEN
-    } else if (GPIOx == GPIOC) {
-        reg_value |= (1U << 19); // GPIOCEN
-    } else if (GPIOx == GPIOD) {
-        reg_value |= (1U << 20); // GPIODEN
-    } else if (GPIOx == GPIOE) {
-        reg_value |= (1U << 21); // GPIOEEN
-    } else if (GPIOx == GPIOF) {
-        reg_value |= (1U << 22); // GPIOFEN
-    }
+    uint32_t index = GPIO_PORT_INDEX(GPIOx);
 
-    *(volatile uint32_t *)0x40021014UL = reg_value;
+    if (index < GPIO_PORT_COUNT) {
+        gpio_clock_held[index] = true;
+        RCC_AHBENR |= GPIO_CLOCK_BIT(index);
+    }
 }
 
-// Disable GPIO clock
+// Drop the GPIO_EnableClock hold. The clock is only gated once no pin of
+// the port is in use; otherwise the last GPIO_DeInitMask gates it.
 void GPIO_DisableClock(GPIO_TypeDef *GPIOx) {
-    uint32_t reg_value = *(volatile uint32_t *)0x40021020UL; // RCC_AHBENR
-
-    if (GPIOx == GPIOA) {
-        reg_value &= ~(1U << 17); // GPIOAEN
-    } else if (GPIOx == GPIOB) {
-        reg_value &= ~(1U << 18); // GPIOBEN
-    } else if (GPIOx == GPIOC) {
-        reg_value &= ~(1U << 19); // GPIOCEN
-    } else if (GPIOx == GPIOD) {
-        reg_value &= ~(1U << 20); // GPIODEN
-    } else if (GPIOx == GPIOE) {
-        reg_value &= ~(1U << 21); // GPIOEEN
-    } else if (GPIOx == GPIOF) {
-        reg_value &= ~(1U << 22); // GPIOFEN
+    uint32_t index = GPIO_PORT_INDEX(GPIOx);
+
+    if (index < GPIO_PORT_COUNT) {
+        gpio_clock_held[index] = false;
+        if (gpio_pins_in_use[index] == 0) {
+            RCC_AHBENR &= ~GPIO_CLOCK_BIT(index);
+        }
+    }
+}
+
+// Pins of GPIOx currently held by the driver (0 means only a
+// GPIO_EnableClock hold can keep the port clocked)
+uint16_t GPIO_GetPinsInUse(GPIO_TypeDef *GPIOx) {
+    uint32_t index = GPIO_PORT_INDEX(GPIOx);
+
+    return (index < GPIO_PORT_COUNT) ? gpio_pins_in_use[index] : 0U;
+}
+
+// Mark pins as used, clocking the port when its first pin is claimed
+static void GPIO_AcquirePins(GPIO_TypeDef *GPIOx, uint16_t pin_mask) {
+    uint32_t index = GPIO_PORT_INDEX(GPIOx);
+
+    if (index >= GPIO_PORT_COUNT) {
+        return;
+    }
+    if (gpio_pins_in_use[index] == 0 && !gpio_clock_held[index]) {
+        RCC_AHBENR |= GPIO_CLOCK_BIT(index);
+    }
+    gpio_pins_in_use[index] |= pin_mask;
+}
+
+// Release pins, gating the port clock once its last pin is released (unless
+// GPIO_EnableClock holds it)
+static void GPIO_ReleasePins(GPIO_TypeDef *GPIOx, uint16_t pin_mask) {
+    uint32_t index = GPIO_PORT_INDEX(GPIOx);
+
+    if (index >= GPIO_PORT_COUNT || gpio_pins_in_use[index] == 0) {
+        return;
+    }
+    gpio_pins_in_use[index] &= ~pin_mask;
+    if (gpio_pins_in_use[index] == 0 && !gpio_clock_held[index]) {
+        RCC_AHBENR &= ~GPIO_CLOCK_BIT(index);
     }
+}
+
+// Spread a 16-bit pin mask to one 2-bit field per pin (bit n -> bit 2n)
+static uint32_t GPIO_SpreadMask2(uint32_t mask) {
+    mask &= 0xFFFFU;
+    mask = (mask | (mask << 8)) & 0x00FF00FFU;
+    mask = (mask | (mask << 4)) & 0x0F0F0F0FU;
+    mask = (mask | (mask << 2)) & 0x33333333U;
+    mask = (mask | (mask << 1)) & 0x55555555U;
+    return mask;
+}
 
-    *(volatile uint32_t *)0x40021014UL = reg_value;
+// Spread an 8-bit pin mask to one 4-bit field per pin (bit n -> bit 4n)
+static uint32_t GPIO_SpreadMask4(uint32_t mask) {
+    mask &= 0xFFU;
+    mask = (mask | (mask << 12)) & 0x000F000FU;
+    mask = (mask | (mask << 6)) & 0x03030303U;
+    mask = (mask | (mask << 3)) & 0x11111111U;
+    return mask;
 }
 
 // Initialize GPIO pin
 void GPIO_Init(GPIO_TypeDef *GPIOx, uint32_t pin, const GPIO_Config *config) {
-    // Enable GPIO clock
-    GPIO_EnableClock(GPIOx);
+    GPIO_InitMask(GPIOx, (uint16_t)(1U << pin), config);
+}
 
-    // Clear and set mode bits (2 bits per pin)
-    GPIOx->MODER &= ~(3U << (2 * pin));
-    GPIOx->MODER |= (config->mode << (2 * pin));
+// Initialize every pin in pin_mask with the same configuration.
+// Each configuration register is read once and written once, no matter
+// how many pins are selected.
+void GPIO_InitMask(GPIO_TypeDef *GPIOx, uint16_t pin_mask, const GPIO_Config *config) {
+    uint32_t field2 = GPIO_SpreadMask2(pin_mask);   // 01 in each selected 2-bit field
+    uint32_t mask2 = field2 * 3U;                   // 11 in each selected 2-bit field
+    bool is_output = (config->mode == GPIO_MODE_OUTPUT || config->mode == GPIO_MODE_ALTERNATE);
 
-    // Set output type (1 bit per pin)
-    if (config->mode == GPIO_MODE_OUTPUT || config->mode == GPIO_MODE_ALTERNATE) {
-        GPIOx->OTYPER &= ~(1U << pin);
-        GPIOx->OTYPER |= (config->output_type << pin);
+    if (pin_mask == 0) {
+        return;
     }
 
-    // Set output speed (2 bits per pin)
-    if (config->mode == GPIO_MODE_OUTPUT || config->mode == GPIO_MODE_ALTERNATE) {
-        GPIOx->OSPEEDR &= ~(3U << (2 * pin));
-        GPIOx->OSPEEDR |= (config->speed << (2 * pin));
+    // Claim the pins (clocks the port if this is its first user)
+    GPIO_AcquirePins(GPIOx, pin_mask);
+
+    // Mode (2 bits per pin)
+    GPIOx->MODER = (GPIOx->MODER & ~mask2) | (field2 * config->mode);
+
+    // Output type and speed only matter when the pin drives the line
+    if (is_output) {
+        uint32_t otype = (config->output_type == GPIO_OUTPUT_OPEN_DRAIN) ? pin_mask : 0U;
+        GPIOx->OTYPER = (GPIOx->OTYPER & ~(uint32_t)pin_mask) | otype;
+        GPIOx->OSPEEDR = (GPIOx->OSPEEDR & ~mask2) | (field2 * config->speed);
     }
 
-    // Set pull-up/pull-down (2 bits per pin)
-    GPIOx->PUPDR &= ~(3U << (2 * pin));
-    GPIOx->PUPDR |= (config->pull << (2 * pin));
+    // Pull-up/pull-down (2 bits per pin)
+    GPIOx->PUPDR = (GPIOx->PUPDR & ~mask2) | (field2 * config->pull);
 
-    // Set alternate function if needed
+    // Alternate function (4 bits per pin), only touch the halves in use
     if (config->mode == GPIO_MODE_ALTERNATE) {
-        GPIO_SetAlternateFunction(GPIOx, pin, config->alternate);
+        uint32_t field4;
+
+        if (pin_mask & 0x00FFU) {
+            field4 = GPIO_SpreadMask4(pin_mask);
+            GPIOx->AFRL = (GPIOx->AFRL & ~(field4 * 0xFU)) | (field4 * config->alternate);
+        }
+        if (pin_mask & 0xFF00U) {
+            field4 = GPIO_SpreadMask4(pin_mask >> 8);
+            GPIOx->AFRH = (GPIOx->AFRH & ~(field4 * 0xFU)) | (field4 * config->alternate);
+        }
+    }
+}
+
+// Return the pins in pin_mask to their reset state (input, no pull) and
+// release them. Pins the driver never configured are left alone, so a wide
+// mask cannot take PA13/PA14 off SWD. The port clock is gated when no
+// configured pin remains.
+void GPIO_DeInitMask(GPIO_TypeDef *GPIOx, uint16_t pin_mask) {
+    uint32_t mask2;
+
+    pin_mask &= GPIO_GetPinsInUse(GPIOx);
+    if (pin_mask == 0) {
+        return;
     }
+    mask2 = GPIO_SpreadMask2(pin_mask) * 3U;
+
+    GPIOx->MODER &= ~mask2;
+    GPIOx->PUPDR &= ~mask2;
+
+    GPIO_ReleasePins(GPIOx, pin_mask);
 }
 
 // Set alternate function for pin
@@ -98,7 +182,25 @@ void GPIO_WritePin(GPIO_TypeDef *GPIOx, uint32_t pin, bool state) {
 
 // Toggle pin state
 void GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint32_t pin) {
-    GPIOx->ODR ^= (1U << pin);
+    GPIO_ToggleMasked(GPIOx, (uint16_t)(1U << pin));
+}
+
+// Drive the pins in mask to the matching bits of value with one BSRR store.
+// Pins outside mask are untouched, even if an ISR changes them concurrently.
+void GPIO_WriteMasked(GPIO_TypeDef *GPIOx, uint16_t mask, uint16_t value) {
+    uint32_t set = (uint32_t)(value & mask);
+    uint32_t reset = (uint32_t)(~value & mask);
+
+    GPIOx->BSRR = (reset << 16) | set;
+}
+
+// Toggle the pins in mask: one ODR load, then one BSRR store.
+// Unlike ODR ^= mask, a concurrent write to any other pin of the port
+// cannot be overwritten.
+void GPIO_ToggleMasked(GPIO_TypeDef *GPIOx, uint16_t mask) {
+    uint32_t odr = GPIOx->ODR;
+
+    GPIOx->BSRR = ((odr & mask) << 16) | (~odr & mask);
 }
 
 // Read pin state
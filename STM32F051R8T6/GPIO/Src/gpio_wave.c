@@ -0,0 +1,182 @@
+#include "gpio_wave.h"
+#include "rcc.h"
+#include <stddef.h>
+
+// DMA1 registers (channel 3 carries the TIM3_UP request)
+#define DMA1_BASE        0x40020000UL
+#define DMA1_ISR         (*(volatile uint32_t *)(DMA1_BASE + 0x00))
+#define DMA1_IFCR        (*(volatile uint32_t *)(DMA1_BASE + 0x04))
+#define DMA1_CCR3        (*(volatile uint32_t *)(DMA1_BASE + 0x30))
+#define DMA1_CNDTR3      (*(volatile uint32_t *)(DMA1_BASE + 0x34))
+#define DMA1_CPAR3       (*(volatile uint32_t *)(DMA1_BASE + 0x38))
+#define DMA1_CMAR3       (*(volatile uint32_t *)(DMA1_BASE + 0x3C))
+
+// DMA_CCR bits
+#define DMA_CCR_EN       (1U << 0)
+#define DMA_CCR_TCIE     (1U << 1)
+#define DMA_CCR_HTIE     (1U << 2)
+#define DMA_CCR_TEIE     (1U << 3)
+#define DMA_CCR_DIR      (1U << 4)      // Read from memory
+#define DMA_CCR_CIRC     (1U << 5)
+#define DMA_CCR_MINC     (1U << 7)
+#define DMA_CCR_PSIZE_32 (2U << 8)
+#define DMA_CCR_MSIZE_32 (2U << 10)
+#define DMA_CCR_PL_HIGH  (3U << 12)
+
+// DMA_ISR/IFCR flags for channel 3
+#define DMA_GIF3         (1U << 8)
+#define DMA_TCIF3        (1U << 9)
+#define DMA_HTIF3        (1U << 10)
+#define DMA_TEIF3        (1U << 11)
+
+// TIM3 registers
+#define TIM3_BASE        0x40000400UL
+#define TIM3_CR1         (*(volatile uint32_t *)(TIM3_BASE + 0x00))
+#define TIM3_DIER        (*(volatile uint32_t *)(TIM3_BASE + 0x0C))
+#define TIM3_SR          (*(volatile uint32_t *)(TIM3_BASE + 0x10))
+#define TIM3_EGR         (*(volatile uint32_t *)(TIM3_BASE + 0x14))
+#define TIM3_CNT         (*(volatile uint32_t *)(TIM3_BASE + 0x24))
+#define TIM3_PSC         (*(volatile uint32_t *)(TIM3_BASE + 0x28))
+#define TIM3_ARR         (*(volatile uint32_t *)(TIM3_BASE + 0x2C))
+
+#define TIM_CR1_CEN      (1U << 0)
+#define TIM_DIER_UDE     (1U << 8)
+#define TIM_EGR_UG       (1U << 0)
+
+// Clock enables
+#define RCC_AHBENR_DMAEN    (1U << 0)
+#define RCC_APB1ENR_TIM3EN  (1U << 1)
+
+// NVIC
+#define NVIC_ISER                (*(volatile uint32_t *)0xE000E100UL)
+#define DMA1_Channel2_3_IRQn     10
+
+static volatile bool wave_busy;
+static volatile uint32_t wave_errors;
+static GPIO_WaveCallback wave_half_callback;
+static GPIO_WaveCallback wave_full_callback;
+static GPIO_WaveMode wave_mode;
+
+// Private: TIM3 kernel clock (PCLK, x2 when the APB prescaler divides)
+static uint32_t GPIO_Wave_TimerClock(void) {
+    uint32_t pclk = RCC_GetPCLKFrequency();
+
+    return (RCC_CFGR & (1U << 10)) ? pclk * 2U : pclk;
+}
+
+// Stop the timer and the DMA channel
+static void GPIO_Wave_Halt(void) {
+    TIM3_CR1 &= ~TIM_CR1_CEN;
+    TIM3_DIER &= ~TIM_DIER_UDE;
+    DMA1_CCR3 &= ~DMA_CCR_EN;
+    DMA1_IFCR = DMA_GIF3 | DMA_TCIF3 | DMA_HTIF3 | DMA_TEIF3;
+    wave_busy = false;
+}
+
+// Start streaming config->buffer into config->port->BSRR.
+// TIM3 runs from PCLK, doubled when the APB prescaler divides, so the sample
+// period is rounded to a whole number of those timer clock cycles, at least
+// two: ARR = 0 stops the counter and no DMA request is ever made.
+// Returns false if a waveform is already running or the request is invalid
+// (including a sample rate above half the timer clock).
+bool GPIO_Wave_Start(const GPIO_WaveConfig *config) {
+    uint32_t timer_clock = GPIO_Wave_TimerClock();
+    uint32_t ticks;
+    uint32_t prescaler;
+    uint32_t ccr;
+
+    if (wave_busy || config->port == NULL || config->buffer == NULL ||
+        config->length == 0 || config->sample_rate_hz == 0 ||
+        config->sample_rate_hz > timer_clock / 2U) {
+        return false;
+    }
+
+    // Period in timer ticks, split into PSC and a 16-bit ARR
+    ticks = timer_clock / config->sample_rate_hz;
+    prescaler = (ticks - 1U) / 0x10000U;
+
+    RCC_AHBENR |= RCC_AHBENR_DMAEN;
+    RCC_APB1ENR |= RCC_APB1ENR_TIM3EN;
+
+    wave_half_callback = config->half_callback;
+    wave_full_callback = config->full_callback;
+    wave_mode = config->mode;
+
+    // Timer: load PSC/ARR with an update event, before DMA requests are enabled
+    TIM3_CR1 = 0;
+    TIM3_DIER = 0;
+    TIM3_PSC = prescaler;
+    TIM3_ARR = (ticks / (prescaler + 1U)) - 1U;
+    TIM3_EGR = TIM_EGR_UG;
+    TIM3_SR = 0;
+    TIM3_CNT = 0;
+
+    // DMA: memory -> BSRR, 32-bit words, one word per TIM3 update
+    DMA1_CCR3 = 0;
+    DMA1_IFCR = DMA_GIF3 | DMA_TCIF3 | DMA_HTIF3 | DMA_TEIF3;
+    DMA1_CPAR3 = (uint32_t)(uintptr_t)&config->port->BSRR;
+    DMA1_CMAR3 = (uint32_t)(uintptr_t)config->buffer;
+    DMA1_CNDTR3 = config->length;
+
+    ccr = DMA_CCR_DIR | DMA_CCR_MINC | DMA_CCR_PSIZE_32 | DMA_CCR_MSIZE_32 |
+          DMA_CCR_PL_HIGH | DMA_CCR_TCIE | DMA_CCR_TEIE;
+    if (config->mode == GPIO_WAVE_CIRCULAR) {
+        ccr |= DMA_CCR_CIRC;
+    }
+    if (config->half_callback != NULL) {
+        ccr |= DMA_CCR_HTIE;
+    }
+    DMA1_CCR3 = ccr;
+    DMA1_CCR3 = ccr | DMA_CCR_EN;
+
+    NVIC_ISER = (1U << DMA1_Channel2_3_IRQn);
+
+    wave_busy = true;
+    TIM3_DIER = TIM_DIER_UDE;
+    TIM3_CR1 = TIM_CR1_CEN;
+
+    return true;
+}
+
+// Stop the waveform immediately. Pins keep the last word written.
+void GPIO_Wave_Stop(void) {
+    GPIO_Wave_Halt();
+}
+
+// True while a waveform is playing
+bool GPIO_Wave_IsBusy(void) {
+    return wave_busy;
+}
+
+// DMA transfer errors seen since reset
+uint32_t GPIO_Wave_GetErrorCount(void) {
+    return wave_errors;
+}
+
+// DMA1 channel 2/3 interrupt: half/full transfer and error handling
+void DMA1_CH2_3_DMA2_CH1_2_IRQHandler(void) {
+    uint32_t isr = DMA1_ISR;
+
+    if (isr & DMA_TEIF3) {
+        wave_errors++;
+        GPIO_Wave_Halt();
+        return;
+    }
+
+    if (isr & DMA_HTIF3) {
+        DMA1_IFCR = DMA_HTIF3;
+        if (wave_half_callback != NULL) {
+            wave_half_callback();
+        }
+    }
+
+    if (isr & DMA_TCIF3) {
+        DMA1_IFCR = DMA_TCIF3;
+        if (wave_mode == GPIO_WAVE_ONE_SHOT) {
+            GPIO_Wave_Halt();
+        }
+        if (wave_full_callback != NULL) {
+            wave_full_callback();
+        }
+    }
+}
@@ -1,9 +1,9 @@
 #include "rcc.h"
 #include "gpio.h"
-
-// Flash Access Control Register (FLASH_ACR) address
-#define FLASH_ACR      (*(volatile uint32_t *)0x40022000UL)
-
+#include "gpio_wave.h"
+#ifdef PBUS_BENCHMARK
+#include "parallel_bus.h"
+#endif
 
 // Example configurations
 void Configure_LED_Pin(void) {
@@ -15,9 +15,8 @@ void Configure_LED_Pin(void) {
         .alternate = GPIO_AF0
     };
 
-    // Configure PB0 as LED output
-    GPIO_Init(GPIOC, GPIO_PIN_9, &led_config);
-    GPIO_Init(GPIOC, GPIO_PIN_8, &led_config);
+    // Configure PC8 and PC9 as LED outputs in one pass
+    GPIO_InitMask(GPIOC, GPIO_PIN_MASK(GPIO_PIN_8) | GPIO_PIN_MASK(GPIO_PIN_9), &led_config);
 }
 
 // Example configuration for 8MHz using HSI (no crystal needed)
@@ -38,11 +37,8 @@ void SystemClock_Config_8MHz(void) {
     RCC_Init(&config);
 }
 
+// 32MHz from HSI/2 x 8 (RCC_Init sets 1 flash wait state)
 void SystemClock_Config_32MHz_HSI(void) {
-
-	// Step 1: Configure Flash wait states BEFORE increasing clock speed
-	FLASH_ACR |= (1 << 0);  // Set LATENCY[0] = 1 (1 wait state for >24MHz)
-
     RCC_Config config = {
         .system_clock_source = CLOCK_SOURCE_PLL,
         .target_frequency = 32000000UL,
@@ -59,7 +55,126 @@ void SystemClock_Config_32MHz_HSI(void) {
     RCC_Init(&config);
 }
 
+// Alternate PC8/PC9: one BSRR word per step, streamed by DMA
+static const uint32_t led_pattern[] = {
+    GPIO_WAVE_WORD(GPIO_PIN_MASK(GPIO_PIN_8) | GPIO_PIN_MASK(GPIO_PIN_9), GPIO_PIN_MASK(GPIO_PIN_8)),
+    GPIO_WAVE_WORD(GPIO_PIN_MASK(GPIO_PIN_8) | GPIO_PIN_MASK(GPIO_PIN_9), GPIO_PIN_MASK(GPIO_PIN_9))
+};
+
+void Start_LED_Waveform(void) {
+    GPIO_WaveConfig wave_config = {
+        .port = GPIOC,
+        .buffer = led_pattern,
+        .length = sizeof(led_pattern) / sizeof(led_pattern[0]),
+        .sample_rate_hz = 4,             // 2 Hz blink
+        .mode = GPIO_WAVE_CIRCULAR,
+        .half_callback = 0,
+        .full_callback = 0
+    };
+
+    GPIO_Wave_Start(&wave_config);
+}
+
+#ifdef PBUS_BENCHMARK
+
+// Parallel bus throughput on the target, timed with SysTick at 8, 32 and
+// 48 MHz. Nothing needs to be connected: 8-bit data on PB0-PB7, WR PB8,
+// RD PB9, CS PB10. Read pbus_bytes_per_s in the debugger:
+// [clock][contiguous write, scattered write, read].
+#define SYST_CSR            (*(volatile uint32_t *)0xE000E010UL)
+#define SYST_RVR            (*(volatile uint32_t *)0xE000E014UL)
+#define SYST_CVR            (*(volatile uint32_t *)0xE000E018UL)
+#define SYST_RELOAD_MAX     0x00FFFFFFUL
+#define PBUS_BENCH_BYTES    1024U
+#define PBUS_BENCH_ACCESS_NS 100U    // A typical 8080 LCD controller read
+
+volatile uint32_t pbus_bytes_per_s[3][3];
+
+void SystemClock_Config_48MHz_HSI(void) {
+    RCC_Config config = {
+        .system_clock_source = CLOCK_SOURCE_PLL,
+        .target_frequency = SYSTEM_CLOCK_48MHZ,
+        .hse_enabled = false,
+        .pll_enabled = true,
+        .pll_source = PLL_SOURCE_HSI_DIV2, // HSI/2 = 4MHz
+        .pll_multiplier = 12,            // 4MHz * 12 = 48MHz
+        .ahb_prescaler = AHB_PRESCALER_1,
+        .apb_prescaler = APB_PRESCALER_1,
+        .hsi48_enabled = false,
+        .css_enabled = false
+    };
+
+    RCC_Init(&config);
+}
+
+// Bytes per second for one block transfer at the current HCLK
+static uint32_t PBus_BenchBlock(PBus *bus, uint8_t *buffer, bool read) {
+    uint32_t start;
+    uint32_t cycles;
+
+    SYST_RVR = SYST_RELOAD_MAX;
+    SYST_CVR = 0;
+    SYST_CSR = 0x05;    // Processor clock, no interrupt
+    start = SYST_CVR;
+    if (read) {
+        PBus_ReadBlock(bus, buffer, PBUS_BENCH_BYTES);
+    } else {
+        PBus_WriteBlock(bus, buffer, PBUS_BENCH_BYTES);
+    }
+    cycles = (start - SYST_CVR) & SYST_RELOAD_MAX;
+    SYST_CSR = 0;
+
+    return (uint32_t)(((uint64_t)PBUS_BENCH_BYTES * RCC_GetHCLKFrequency()) / cycles);
+}
+
+void PBus_Benchmark(void) {
+    static uint8_t buffer[PBUS_BENCH_BYTES];
+    PBus_Config config = {
+        .data_port = GPIOB,
+        .data_pins = { 0, 1, 2, 3, 4, 5, 6, 7 },
+        .width = 8,
+        .wr = { GPIOB, 8 },
+        .rd = { GPIOB, 9 },
+        .cs = { GPIOB, 10 },
+        .read_access_ns = PBUS_BENCH_ACCESS_NS
+    };
+    PBus contiguous;
+    PBus scattered;
+
+    for (uint32_t i = 0; i < PBUS_BENCH_BYTES; i++) {
+        buffer[i] = (uint8_t)(i * 37U);
+    }
+    PBus_Init(&contiguous, &config);
+    for (uint32_t bit = 0; bit < 8; bit++) {
+        config.data_pins[bit] = (uint8_t)(7U - bit);   // Same pins, LUT path
+    }
+    PBus_Init(&scattered, &config);
+
+    for (uint32_t clock = 0; clock < 3; clock++) {
+        // Off the PLL before it is reprogrammed
+        RCC_SetSystemClockSource(CLOCK_SOURCE_HSI);
+        if (clock == 1) {
+            SystemClock_Config_32MHz_HSI();
+        } else if (clock == 2) {
+            SystemClock_Config_48MHz_HSI();
+        }
+
+        PBus_Select(&contiguous);
+        pbus_bytes_per_s[clock][0] = PBus_BenchBlock(&contiguous, buffer, false);
+        pbus_bytes_per_s[clock][1] = PBus_BenchBlock(&scattered, buffer, false);
+        pbus_bytes_per_s[clock][2] = PBus_BenchBlock(&contiguous, buffer, true);
+        PBus_Deselect(&contiguous);
+    }
+    RCC_SetSystemClockSource(CLOCK_SOURCE_HSI);   // main sets its own clock
+}
+
+#endif // PBUS_BENCHMARK
+
 int main(void) {
+#ifdef PBUS_BENCHMARK
+    PBus_Benchmark();
+#endif
+
     // Configure system clock
 	SystemClock_Config_32MHz_HSI();
     // Enable peripheral clocks as needed
@@ -70,11 +185,10 @@ int main(void) {
     uint32_t sysclk = RCC_GetSystemClockFrequency();
     Configure_LED_Pin();
 
+    // LEDs blink from DMA; the CPU is free
+    Start_LED_Waveform();
+
     while (1) {
-    	GPIO_TogglePin(GPIOC, GPIO_PIN_9);
-    	GPIO_TogglePin(GPIOC, GPIO_PIN_8);
-    	for(int i = 0; i < 500; i++)
-    		for(int j = 0; j < 200; j++);
         // Application code here
     }
 
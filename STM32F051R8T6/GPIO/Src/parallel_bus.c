@@ -0,0 +1,269 @@
+#include "parallel_bus.h"
+#include <stddef.h>
+#include "rcc.h"
+
+// Strobe helpers (all strobes are active low)
+#define PBUS_ASSERT(port, mask)    ((port)->BRR = (mask))
+#define PBUS_RELEASE(port, mask)   ((port)->BSRR = (mask))
+
+// Cortex-M0 read wait loop: SUBS + taken BNE. A NOP in the body only makes
+// each pass longer, so the wait errs on the long side.
+#define PBUS_CYCLES_PER_LOOP       4U
+
+// Configure one control line as a push-pull output parked high
+static void PBus_InitStrobe(const PBus_Pin *line, GPIO_TypeDef **port, uint32_t *mask) {
+    GPIO_Config strobe_config = {
+        .mode = GPIO_MODE_OUTPUT,
+        .output_type = GPIO_OUTPUT_PUSH_PULL,
+        .speed = GPIO_SPEED_HIGH,
+        .pull = GPIO_NO_PULL,
+        .alternate = GPIO_AF0
+    };
+
+    if (line->port == NULL || line->pin > 15) {
+        *port = NULL;
+        *mask = 0;
+        return;
+    }
+
+    *port = line->port;
+    *mask = 1U << line->pin;
+
+    // Drive high before switching to output so the line never glitches low
+    PBUS_RELEASE(*port, *mask);
+    GPIO_InitMask(*port, (uint16_t)*mask, &strobe_config);
+}
+
+// Private: pin mask of a control line if it sits on port, else 0
+static uint32_t PBus_PinOn(const PBus_Pin *line, const GPIO_TypeDef *port) {
+    return (line->port != NULL && line->port == port && line->pin <= 15) ? (1U << line->pin) : 0U;
+}
+
+// Private: true when no two lines of the bus share a pin
+static bool PBus_PinsDisjoint(const PBus_Config *config, uint16_t data_mask) {
+    const PBus_Pin *strobes[3] = { &config->wr, &config->rd, &config->cs };
+
+    for (uint32_t i = 0; i < 3; i++) {
+        if (PBus_PinOn(strobes[i], config->data_port) & data_mask) {
+            return false;
+        }
+        for (uint32_t j = i + 1; j < 3; j++) {
+            if (PBus_PinOn(strobes[i], strobes[j]->port) & PBus_PinOn(strobes[j], strobes[j]->port)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Build the BSRR word that puts value on the data lines
+static inline uint32_t PBus_Encode(const PBus *bus, uint32_t value) {
+    if (bus->contiguous) {
+        uint32_t set = value & bus->value_mask;
+        uint32_t reset = ~value & bus->value_mask;
+        return (set << bus->shift) | (reset << (bus->shift + 16));
+    }
+
+    uint32_t word = bus->lut[0][value & 0xF] | bus->lut[1][(value >> 4) & 0xF];
+    if (bus->width == 16) {
+        word |= bus->lut[2][(value >> 8) & 0xF] | bus->lut[3][(value >> 12) & 0xF];
+    }
+    return word;
+}
+
+// Extract the data value from an IDR sample
+static inline uint16_t PBus_Decode(const PBus *bus, uint32_t idr) {
+    if (bus->contiguous) {
+        return (uint16_t)((idr >> bus->shift) & bus->value_mask);
+    }
+
+    uint16_t value = 0;
+    for (uint32_t bit = 0; bit < bus->width; bit++) {
+        value |= (uint16_t)(((idr >> bus->data_pins[bit]) & 1U) << bit);
+    }
+    return value;
+}
+
+// Switch the data lines between output and input with one MODER store
+static inline void PBus_SetDirection(PBus *bus, bool output) {
+    if (bus->data_is_output != output) {
+        uint32_t moder = bus->data_port->MODER & ~bus->moder_mask;
+        bus->data_port->MODER = output ? (moder | bus->moder_output) : moder;
+        bus->data_is_output = output;
+    }
+}
+
+// Precompute register words for the described bus and configure its pins.
+// Returns false if the description is invalid.
+bool PBus_Init(PBus *bus, const PBus_Config *config) {
+    GPIO_Config data_config = {
+        .mode = GPIO_MODE_OUTPUT,
+        .output_type = GPIO_OUTPUT_PUSH_PULL,
+        .speed = GPIO_SPEED_HIGH,
+        .pull = GPIO_NO_PULL,
+        .alternate = GPIO_AF0
+    };
+    uint16_t data_mask = 0;
+
+    if (config->data_port == NULL || (config->width != 8 && config->width != 16) ||
+        config->wr.port == NULL || config->wr.pin > 15) {
+        return false;
+    }
+
+    for (uint32_t bit = 0; bit < config->width; bit++) {
+        uint8_t pin = config->data_pins[bit];
+        if (pin > 15 || (data_mask & (1U << pin))) {
+            return false;   // Out of range or used twice
+        }
+        data_mask |= (uint16_t)(1U << pin);
+        bus->data_pins[bit] = pin;
+    }
+    if (!PBus_PinsDisjoint(config, data_mask)) {
+        return false;   // A strobe on a data pin or on another strobe
+    }
+
+    bus->data_port = config->data_port;
+    bus->data_mask = data_mask;
+    bus->width = config->width;
+    bus->value_mask = (config->width == 16) ? 0xFFFFU : 0x00FFU;
+    bus->read_access_ns = config->read_access_ns;
+    bus->moder_mask = 0;
+    bus->moder_output = 0;
+
+    // Contiguous when bit i sits on pin shift + i
+    bus->shift = config->data_pins[0];
+    bus->contiguous = true;
+    for (uint32_t bit = 0; bit < config->width; bit++) {
+        uint32_t pin = config->data_pins[bit];
+
+        if (pin != bus->shift + bit) {
+            bus->contiguous = false;
+        }
+        bus->moder_mask |= 3U << (2 * pin);
+        bus->moder_output |= 1U << (2 * pin);
+    }
+
+    // Nibble lookup tables: OR of four entries gives the full BSRR word
+    if (!bus->contiguous) {
+        for (uint32_t nibble = 0; nibble < (uint32_t)config->width / 4; nibble++) {
+            for (uint32_t value = 0; value < 16; value++) {
+                uint32_t word = 0;
+                for (uint32_t i = 0; i < 4; i++) {
+                    uint32_t pin = config->data_pins[nibble * 4 + i];
+                    word |= (value & (1U << i)) ? (1U << pin) : (1U << (pin + 16));
+                }
+                bus->lut[nibble][value] = word;
+            }
+        }
+    }
+
+    PBus_InitStrobe(&config->wr, &bus->wr_port, &bus->wr_mask);
+    PBus_InitStrobe(&config->rd, &bus->rd_port, &bus->rd_mask);
+    PBus_InitStrobe(&config->cs, &bus->cs_port, &bus->cs_mask);
+
+    GPIO_InitMask(bus->data_port, data_mask, &data_config);
+    bus->data_is_output = true;
+
+    return true;
+}
+
+// Assert CS (no-op when the bus has no CS line)
+void PBus_Select(PBus *bus) {
+    if (bus->cs_port != NULL) {
+        PBUS_ASSERT(bus->cs_port, bus->cs_mask);
+    }
+}
+
+// Release CS
+void PBus_Deselect(PBus *bus) {
+    if (bus->cs_port != NULL) {
+        PBUS_RELEASE(bus->cs_port, bus->cs_mask);
+    }
+}
+
+// Write one word. CS is left to the caller (PBus_Select/PBus_Deselect).
+void PBus_Write(PBus *bus, uint16_t value) {
+    if (bus->width == 16) {
+        PBus_WriteBlock(bus, &value, 1);
+    } else {
+        uint8_t byte = (uint8_t)value;
+        PBus_WriteBlock(bus, &byte, 1);
+    }
+}
+
+// Read one word. CS is left to the caller.
+uint16_t PBus_Read(PBus *bus) {
+    uint16_t value = 0;
+
+    if (bus->width == 16) {
+        PBus_ReadBlock(bus, &value, 1);
+    } else {
+        uint8_t byte = 0;
+        PBus_ReadBlock(bus, &byte, 1);
+        value = byte;
+    }
+    return value;
+}
+
+// Write count words (uint8_t for 8-bit buses, uint16_t for 16-bit buses).
+// When WR shares the data port, data and the WR falling edge go out in the
+// same BSRR store; the device latches on the WR rising edge.
+void PBus_WriteBlock(PBus *bus, const void *data, uint32_t count) {
+    GPIO_TypeDef *data_port = bus->data_port;
+    GPIO_TypeDef *wr_port = bus->wr_port;
+    uint32_t wr_mask = bus->wr_mask;
+    uint32_t wr_low = (wr_port == data_port) ? (wr_mask << 16) : 0U;
+    const uint8_t *bytes = (const uint8_t *)data;
+    const uint16_t *words = (const uint16_t *)data;
+
+    PBus_SetDirection(bus, true);
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t value = (bus->width == 16) ? words[i] : bytes[i];
+
+        data_port->BSRR = PBus_Encode(bus, value) | wr_low;
+        if (wr_low == 0) {
+            PBUS_ASSERT(wr_port, wr_mask);
+        }
+        PBUS_RELEASE(wr_port, wr_mask);
+    }
+}
+
+// Private: wait loops from RD low to the IDR sample at the current HCLK
+static uint32_t PBus_ReadWaitLoops(const PBus *bus) {
+    uint32_t hclk_mhz = RCC_GetHCLKFrequency() / 1000000U;
+    uint32_t cycles = ((uint32_t)bus->read_access_ns * hclk_mhz + 999U) / 1000U + PBUS_IDR_SYNC_CYCLES;
+
+    return (cycles + PBUS_CYCLES_PER_LOOP - 1U) / PBUS_CYCLES_PER_LOOP;
+}
+
+// Read count words into data. Needs an RD line.
+void PBus_ReadBlock(PBus *bus, void *data, uint32_t count) {
+    uint8_t *bytes = (uint8_t *)data;
+    uint16_t *words = (uint16_t *)data;
+    uint32_t wait_loops;
+
+    if (bus->rd_port == NULL) {
+        return;
+    }
+
+    PBus_SetDirection(bus, false);
+    wait_loops = PBus_ReadWaitLoops(bus);
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t idr;
+
+        PBUS_ASSERT(bus->rd_port, bus->rd_mask);
+        for (uint32_t n = wait_loops; n != 0; n--) {
+            __asm volatile ("");
+        }
+        idr = bus->data_port->IDR;
+        PBUS_RELEASE(bus->rd_port, bus->rd_mask);
+
+        if (bus->width == 16) {
+            words[i] = PBus_Decode(bus, idr);
+        } else {
+            bytes[i] = (uint8_t)PBus_Decode(bus, idr);
+        }
+    }
+}
@@ -1,13 +1,22 @@
 #include "rcc.h"
 #include <stddef.h>  // Added for NULL definition
 
+// Flash access control register (wait states in LATENCY, bits 2:0)
+#ifndef HOST_SIM
+#define FLASH_BASE      0x40022000UL
+#endif
+#define FLASH_ACR       (*(volatile uint32_t *)(FLASH_BASE + 0x00))
+#define FLASH_ACR_LATENCY   0x7U
+
 // Private function prototypes
 static void RCC_ConfigurePLL(const RCC_Config *config);
 static void RCC_ConfigureClockTree(const RCC_Config *config);
 static uint32_t RCC_CalculatePLLFrequency(const RCC_Config *config);
+static uint32_t RCC_SourceFrequency(ClockSource source);
 static bool RCC_IsDeviceF04xF07xF09x(void);
 
-// Initialize RCC with given configuration
+// Initialize RCC with given configuration, including the flash wait states
+// for the SYSCLK it selects
 void RCC_Init(const RCC_Config *config) {
     // 1. Enable HSI as fallback clock
     RCC_EnableHSI();
@@ -174,8 +183,25 @@ void RCC_SetPLLConfig(PLLSource source, uint8_t multiplier) {
 
 // Get current system clock frequency
 uint32_t RCC_GetSystemClockFrequency(void) {
-    ClockSource source = (RCC_CFGR >> 2) & 3; // Read SWS bits
+    return RCC_SourceFrequency((RCC_CFGR >> 2) & 3); // Read SWS bits
+}
+
+// Flash wait states needed for a SYSCLK frequency
+uint8_t RCC_GetFlashLatency(uint32_t sysclk_hz) {
+    return (sysclk_hz > RCC_FLASH_0WS_MAX) ? 1 : 0;
+}
+
+// Program flash wait states (other FLASH_ACR bits are kept)
+void RCC_SetFlashLatency(uint8_t latency) {
+    FLASH_ACR = (FLASH_ACR & ~FLASH_ACR_LATENCY) | latency;
 
+    // Wait for the new latency to take effect
+    while ((FLASH_ACR & FLASH_ACR_LATENCY) != latency) {
+    }
+}
+
+// Private: SYSCLK a clock source gives (the PLL as programmed in CFGR)
+static uint32_t RCC_SourceFrequency(ClockSource source) {
     switch (source) {
         case CLOCK_SOURCE_HSI:
             return 8000000UL; // 8 MHz HSI
@@ -195,6 +221,23 @@ uint32_t RCC_GetSystemClockFrequency(void) {
     }
 }
 
+// Get current AHB (HCLK) frequency: SYSCLK after the HPRE divider
+uint32_t RCC_GetHCLKFrequency(void) {
+    static const uint8_t hpre_shift[8] = { 1, 2, 3, 4, 6, 7, 8, 9 };
+    uint32_t hpre = (RCC_CFGR >> 4) & 0xF;
+    uint32_t sysclk = RCC_GetSystemClockFrequency();
+
+    return (hpre < AHB_PRESCALER_2) ? sysclk : (sysclk >> hpre_shift[hpre - AHB_PRESCALER_2]);
+}
+
+// Get current APB (PCLK) frequency: HCLK after the PPRE divider
+uint32_t RCC_GetPCLKFrequency(void) {
+    uint32_t ppre = (RCC_CFGR >> 8) & 0x7;
+    uint32_t hclk = RCC_GetHCLKFrequency();
+
+    return (ppre < APB_PRESCALER_2) ? hclk : (hclk >> (ppre - APB_PRESCALER_2 + 1U));
+}
+
 // Enable peripheral clock
 void RCC_EnablePeripheralClock(uint8_t peripheral_type, uint8_t peripheral_num) {
     uint8_t peripheral_group = peripheral_type >> 4;
@@ -318,8 +361,15 @@ static void RCC_ConfigurePLL(const RCC_Config *config) {
     RCC_SetPLLConfig(config->pll_source, config->pll_multiplier);
 }
 
-// Private: Configure complete clock tree
+// Private: Configure complete clock tree. Flash latency follows the new
+// SYSCLK: raised before it is selected, lowered only once it runs.
 static void RCC_ConfigureClockTree(const RCC_Config *config) {
+    uint8_t latency = RCC_GetFlashLatency(RCC_SourceFrequency(config->system_clock_source));
+
+    if (latency > (FLASH_ACR & FLASH_ACR_LATENCY)) {
+        RCC_SetFlashLatency(latency);
+    }
+
     // Set AHB prescaler
     RCC_SetAHBPrescaler(config->ahb_prescaler);
 
@@ -328,6 +378,10 @@ static void RCC_ConfigureClockTree(const RCC_Config *config) {
 
     // Set final system clock source
     RCC_SetSystemClockSource(config->system_clock_source);
+
+    if (latency < (FLASH_ACR & FLASH_ACR_LATENCY)) {
+        RCC_SetFlashLatency(latency);
+    }
 }
 
 // Private: Calculate PLL frequency
@@ -0,0 +1,39 @@
+#include "gpio_bench.h"
+#include "gpio.h"
+#include <stddef.h>
+
+// AI_Generated Code/DeepSeek_Generated/GPIO/gpio.c: per-pin API only
+
+static void Bench_Init16(void) {
+    GPIO_Config config = {
+        .mode = GPIO_MODE_OUTPUT,
+        .output_type = GPIO_OUTPUT_PUSH_PULL,
+        .speed = GPIO_SPEED_HIGH,
+        .pull = GPIO_NO_PULL,
+        .alternate = GPIO_AF0
+    };
+
+    for (uint32_t pin = 0; pin < 16; pin++) {
+        GPIO_Init(GPIOB, pin, &config);
+    }
+}
+
+static void Bench_Toggle(void) {
+    GPIO_TogglePin(GPIOB, 0);
+}
+
+// No port write: one GPIO_WritePin per pin
+static void Bench_PortWrite(uint16_t value) {
+    for (uint32_t pin = 0; pin < 16; pin++) {
+        GPIO_WritePin(GPIOB, pin, (value >> pin) & 1U);
+    }
+}
+
+const GPIO_BenchDriver gpio_bench_driver = {
+    .name = "DeepSeek",
+    .init_16_pins = Bench_Init16,
+    .init_per_pin = Bench_Init16,   // Already one GPIO_Init per pin
+    .toggle = Bench_Toggle,
+    .port_write = Bench_PortWrite,
+    .exti_config = NULL         // No EXTI API in this driver
+};
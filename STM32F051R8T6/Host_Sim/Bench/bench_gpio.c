@@ -0,0 +1,47 @@
+#include "gpio_bench.h"
+#include "gpio.h"
+#include <stddef.h>
+
+// GPIO/Src/gpio.c: mask-based init and BSRR writes
+
+static const GPIO_Config bench_output = {
+    .mode = GPIO_MODE_OUTPUT,
+    .output_type = GPIO_OUTPUT_PUSH_PULL,
+    .speed = GPIO_SPEED_HIGH,
+    .pull = GPIO_NO_PULL,
+    .alternate = GPIO_AF0
+};
+
+static void Bench_Init16(void) {
+    GPIO_InitMask(GPIOB, GPIO_PIN_MASK_ALL, &bench_output);
+}
+
+// GPIO_Init forwards to GPIO_InitMask with a one-pin mask
+static void Bench_InitPerPin(void) {
+    for (uint32_t pin = 0; pin < 16; pin++) {
+        GPIO_Init(GPIOB, pin, &bench_output);
+    }
+}
+
+// Release the pins so the next init clocks the port again
+static void Bench_Release16(void) {
+    GPIO_DeInitMask(GPIOB, GPIO_PIN_MASK_ALL);
+}
+
+static void Bench_Toggle(void) {
+    GPIO_TogglePin(GPIOB, 0);
+}
+
+static void Bench_PortWrite(uint16_t value) {
+    GPIO_WriteMasked(GPIOB, 0xFFFFU, value);
+}
+
+const GPIO_BenchDriver gpio_bench_driver = {
+    .name = "GPIO",
+    .init_16_pins = Bench_Init16,
+    .init_per_pin = Bench_InitPerPin,
+    .release_16_pins = Bench_Release16,
+    .toggle = Bench_Toggle,
+    .port_write = Bench_PortWrite,
+    .exti_config = NULL         // No EXTI API in this driver
+};
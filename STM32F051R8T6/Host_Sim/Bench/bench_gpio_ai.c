@@ -0,0 +1,57 @@
+#include "gpio_bench.h"
+#include "gpio.h"
+
+// AI_Generated Code/GPIO_AI/gpio.c: mask-based init with per-pin loops
+
+static void Bench_Init16(void) {
+    GPIO_InitTypeDef init = {
+        .Pin = GPIO_PIN_ALL,
+        .Mode = GPIO_MODE_OUTPUT,
+        .Ot = GPIO_OTYPE_PP,
+        .Speed = GPIO_SPEED_HIGH,
+        .Pull = GPIO_PULL_NO,
+        .AF = GPIO_AF0
+    };
+
+    GPIO_EnableClock(GPIOB);
+    GPIO_Init(GPIOB, &init);
+}
+
+static void Bench_InitPerPin(void) {
+    GPIO_InitTypeDef init = {
+        .Mode = GPIO_MODE_OUTPUT,
+        .Ot = GPIO_OTYPE_PP,
+        .Speed = GPIO_SPEED_HIGH,
+        .Pull = GPIO_PULL_NO,
+        .AF = GPIO_AF0
+    };
+
+    GPIO_EnableClock(GPIOB);
+    for (uint32_t pin = 0; pin < 16; pin++) {
+        init.Pin = 1U << pin;
+        GPIO_Init(GPIOB, &init);
+    }
+}
+
+static void Bench_Toggle(void) {
+    GPIO_TogglePin(GPIOB, GPIO_PIN_0);
+}
+
+static void Bench_PortWrite(uint16_t value) {
+    GPIO_WritePort(GPIOB, value);
+}
+
+static void Bench_ExtiConfig(void) {
+    EXTI_LineConfig(EXTI_LINE_5, GPIOB, 5);
+    EXTI_SetTrigger(EXTI_LINE_5, EXTI_TRIGGER_RISING);
+    EXTI_EnableExtiLine(EXTI_LINE_5, 1);
+}
+
+const GPIO_BenchDriver gpio_bench_driver = {
+    .name = "GPIO_AI",
+    .init_16_pins = Bench_Init16,
+    .init_per_pin = Bench_InitPerPin,
+    .toggle = Bench_Toggle,
+    .port_write = Bench_PortWrite,
+    .exti_config = Bench_ExtiConfig
+};
@@ -0,0 +1,94 @@
+#include "gpio_bench.h"
+#include "sim_trace.h"
+#include <stdio.h>
+
+// Bus-access benchmark for the GPIO driver variants.
+//
+// Runs the same workloads through one driver (selected at link time by its
+// adapter) and prints the volatile loads and stores per operation, counted
+// by the access tracer in Host_Sim. Build one binary per driver, from
+// STM32F051R8T6/:
+//
+//   gcc -O2 -IHost_Sim/Inc -IGPIO/Inc Host_Sim/Bench/gpio_bench.c
+//       Host_Sim/Bench/bench_gpio.c Host_Sim/Src/sim_trace.c GPIO/Src/gpio.c
+//   gcc -O2 -IHost_Sim/Inc "-IAI_Generated Code/GPIO_AI" Host_Sim/Bench/gpio_bench.c
+//       Host_Sim/Bench/bench_gpio_ai.c Host_Sim/Src/sim_trace.c "AI_Generated Code/GPIO_AI/gpio.c"
+//   gcc -O2 -IHost_Sim/Inc "-IAI_Generated Code/DeepSeek_Generated/GPIO" Host_Sim/Bench/gpio_bench.c
+//       Host_Sim/Bench/bench_deepseek.c Host_Sim/Src/sim_trace.c "AI_Generated Code/DeepSeek_Generated/GPIO/gpio.c"
+//
+// (GPIO/Src/gpio.c also needs GPIO/Inc/rcc.h, which -IGPIO/Inc provides.)
+//
+// Code size per function comes from the ARM build of the same file:
+//
+//   arm-none-eabi-gcc -mcpu=cortex-m0 -mthumb -Os -ffunction-sections -c gpio.c -o gpio.o
+//   arm-none-eabi-nm --size-sort -S -t d gpio.o
+
+#define BENCH_REPEAT     1000U
+
+// Access counts in hundredths per operation
+static void Bench_Report(const char *workload, const Sim_TraceCounts *counts, uint32_t ops) {
+    uint32_t loads = (counts->loads * 100U + ops / 2U) / ops;
+    uint32_t stores = (counts->stores * 100U + ops / 2U) / ops;
+
+    printf("%-12s %-14s %6u.%02u %6u.%02u\n", gpio_bench_driver.name, workload,
+           loads / 100U, loads % 100U, stores / 100U, stores % 100U);
+}
+
+static void Bench_Skip(const char *workload) {
+    printf("%-12s %-14s %9s %9s\n", gpio_bench_driver.name, workload, "n/a", "n/a");
+}
+
+int main(void) {
+    Sim_TraceCounts counts;
+
+    if (!Sim_TraceInit()) {
+        fprintf(stderr, "access tracer unavailable (needs x86-64 Linux, gcc, free peripheral addresses)\n");
+        return 1;
+    }
+
+    printf("%-12s %-14s %9s %9s\n", "driver", "workload", "loads/op", "stores/op");
+
+    // Initialization runs once, from reset state (clock still off)
+    Sim_TraceStart();
+    gpio_bench_driver.init_16_pins();
+    Sim_TraceStop(&counts);
+    Bench_Report("init 16 pins", &counts, 1);
+
+    // The same pins again one call at a time, from the same starting point
+    if (gpio_bench_driver.init_per_pin != NULL) {
+        if (gpio_bench_driver.release_16_pins != NULL) {
+            gpio_bench_driver.release_16_pins();
+        }
+        Sim_TraceStart();
+        gpio_bench_driver.init_per_pin();
+        Sim_TraceStop(&counts);
+        Bench_Report("init per pin", &counts, 1);
+    } else {
+        Bench_Skip("init per pin");
+    }
+
+    Sim_TraceStart();
+    for (uint32_t i = 0; i < BENCH_REPEAT; i++) {
+        gpio_bench_driver.toggle();
+    }
+    Sim_TraceStop(&counts);
+    Bench_Report("toggle", &counts, BENCH_REPEAT);
+
+    Sim_TraceStart();
+    for (uint32_t i = 0; i < BENCH_REPEAT; i++) {
+        gpio_bench_driver.port_write((uint16_t)(i * 0x9E37U));
+    }
+    Sim_TraceStop(&counts);
+    Bench_Report("port write", &counts, BENCH_REPEAT);
+
+    if (gpio_bench_driver.exti_config != NULL) {
+        Sim_TraceStart();
+        gpio_bench_driver.exti_config();
+        Sim_TraceStop(&counts);
+        Bench_Report("exti config", &counts, 1);
+    } else {
+        Bench_Skip("exti config");
+    }
+
+    return 0;
+}
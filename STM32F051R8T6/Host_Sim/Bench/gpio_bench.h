@@ -0,0 +1,20 @@
+#ifndef GPIO_BENCH_H
+#define GPIO_BENCH_H
+
+#include <stdint.h>
+
+// One adapter per GPIO driver variant maps the shared workloads onto that
+// driver's API. Workloads a driver has no API for are left NULL.
+typedef struct {
+    const char *name;
+    void (*init_16_pins)(void);         // All 16 pins of GPIOB as push-pull outputs
+    void (*init_per_pin)(void);         // The same, one pin per init call
+    void (*release_16_pins)(void);      // Undo init_16_pins (not counted), NULL if stateless
+    void (*toggle)(void);               // Toggle PB0 once
+    void (*port_write)(uint16_t value); // Drive all 16 GPIOB pins to value
+    void (*exti_config)(void);          // EXTI line 5 on PB5, rising edge, unmasked
+} GPIO_BenchDriver;
+
+extern const GPIO_BenchDriver gpio_bench_driver;
+
+#endif // GPIO_BENCH_H
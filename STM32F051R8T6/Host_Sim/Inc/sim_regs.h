@@ -0,0 +1,115 @@
+#ifndef SIM_REGS_H
+#define SIM_REGS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Host-side register simulator for the STM32F051 drivers.
+//
+// Building with -DHOST_SIM makes the driver headers pull in this file instead
+// of defining the peripheral base addresses, so GPIOx_BASE, RCC_BASE and
+// FLASH_BASE resolve to register blocks in host memory. Every evaluation of a
+// base macro first runs the register models:
+//   - RCC:   HSIRDY/HSERDY/PLLRDY, HSI14RDY/HSI48RDY, LSERDY and LSIRDY follow
+//            their ON bits, CFGR.SWS follows CFGR.SW while the selected
+//            source is ready
+//   - GPIO:  BSRR and BRR writes are applied to ODR and read back as 0, IDR
+//            shows ODR on output pins and Sim_SetInput() levels elsewhere
+//   - FLASH: the KEYR sequence clears LOCK, STRT completes at once (BSY = 0,
+//            EOP = 1), and EOP is set while PG is held
+//   - SysTick: plain memory (SYSTICK_BASE), the counter never moves by itself
+//   - NVIC:  plain memory (NVIC_BASE), interrupts are never dispatched
+//   - CRC:   CR.RESET loads INIT into DR (CRC_BASE)
+//   - DMA1:  an enabled memory-to-memory channel moving 32-bit words from
+//            memory into CRC_DR runs to the end at once (CNDTR = 0, TCIF,
+//            HTIF, GIF) and updates DR; any other transfer sets TEIF. IFCR
+//            clears ISR flags (DMA1_BASE)
+//
+// Register macros such as RCC_CR re-evaluate the base on every access, so
+// polling loops see the model update. Sim_FailOscillator() holds ready bits
+// low and Sim_HoldClockSwitch() freezes SWS to drive the timeout and
+// fallback paths. TIM is not modeled, nor are
+// CPU writes to CRC_DR.
+//
+// Drivers often keep a GPIO_TypeDef pointer and store through it several
+// times (two BSRR writes in a row, BSRR then IDR). On x86-64 Linux the GPIO
+// blocks are write-protected: each store faults, is single-stepped and then
+// applied to the port model before the next instruction, so every store
+// counts. Elsewhere stores are only applied at the next base evaluation, and
+// of two BSRR writes through one pointer only the last survives; tests that
+// depend on it check Sim_GpioStoresApplied() first. The hook owns SIGSEGV and
+// SIGTRAP, so do not link sim_trace.c into the same binary.
+//
+// Sim_SetObserver() runs a test function after every model update (each
+// base evaluation), to check that an invariant holds between the driver's
+// register accesses, e.g. flash latency against the SYSCLK SWS reports.
+//
+// Sim_SetPreemption() uses the same hook to run a test "ISR" just before a
+// GPIO store, after the driver has done its loads: the window an interrupt
+// hits in a read-modify-write.
+//
+// The same hook also covers the FLASH registers and a 64 KB flash memory
+// mapped at 0x08000000 (Sim_FlashStoresApplied()). FLASH stores then behave
+// like the hardware instead of the lazy model above: SR flags are
+// write-1-to-clear, CR ignores writes while LOCK is set, STRT with PER or MER
+// erases to 0xFF, and a half-word store into flash memory programs it only
+// with PG set and the target erased (or the new value 0), otherwise PGERR.
+// Flash memory survives Sim_Reset(); Sim_EraseFlash() blanks it and
+// Sim_LoadFlash() fills it as a programmer would.
+// Sim_SetPowerCut() tears the n-th program or erase and hands control back
+// to the test, for power-loss tests. Interrupt-driven flash code is tested
+// by calling its handler while Sim_FlashIrqPending().
+//
+// Host_Sim/Makefile builds and runs the tests in Host_Sim/Test. A one-off
+// build (from STM32F051R8T6/):
+//   gcc -DHOST_SIM -IHost_Sim/Inc -IGPIO/Inc test.c Host_Sim/Src/sim_regs.c
+//       GPIO/Src/gpio.c GPIO/Src/rcc.c
+
+// Simulated base addresses (replace the hardware ones under HOST_SIM)
+#define GPIOA_BASE       Sim_GpioBase(0)
+#define GPIOB_BASE       Sim_GpioBase(1)
+#define GPIOC_BASE       Sim_GpioBase(2)
+#define GPIOD_BASE       Sim_GpioBase(3)
+#define GPIOE_BASE       Sim_GpioBase(4)
+#define GPIOF_BASE       Sim_GpioBase(5)
+#define RCC_BASE         Sim_RccBase()
+#define FLASH_BASE       Sim_FlashBase()
+#define SYSTICK_BASE     Sim_SysTickBase()
+#define NVIC_BASE        Sim_NvicBase()
+#define CRC_BASE         Sim_CrcBase()
+#define DMA1_BASE        Sim_DmaBase()
+
+#define SIM_GPIO_PORTS   6
+
+// Block accessors (run the models, then return the block address)
+uintptr_t Sim_GpioBase(uint32_t port);
+uintptr_t Sim_RccBase(void);
+uintptr_t Sim_FlashBase(void);
+uintptr_t Sim_SysTickBase(void);
+uintptr_t Sim_NvicBase(void);
+uintptr_t Sim_CrcBase(void);
+uintptr_t Sim_DmaBase(void);
+
+// Interrupt stand-in for Sim_SetPreemption()
+typedef void (*Sim_Isr)(void);
+
+// Test control
+void Sim_Reset(void);
+void Sim_Sync(void);
+void Sim_SetInput(uint32_t port, uint16_t levels);
+bool Sim_GpioStoresApplied(void);
+void Sim_SetPreemption(Sim_Isr isr, uint32_t period);
+void Sim_SetObserver(Sim_Isr observer);
+void Sim_FailOscillator(uint32_t cr_ready_bits);
+void Sim_HoldClockSwitch(bool hold);
+uint32_t Sim_Read(uintptr_t base, uint32_t offset);
+
+// Flash memory model (see above)
+bool Sim_FlashStoresApplied(void);
+void Sim_EraseFlash(void);
+void Sim_LoadFlash(uint32_t address, const void *data, uint32_t length);
+uint32_t Sim_FlashOperations(void);
+void Sim_SetPowerCut(uint32_t operation, Sim_Isr on_cut);
+bool Sim_FlashIrqPending(void);
+
+#endif // SIM_REGS_H
@@ -0,0 +1,29 @@
+#ifndef SIM_TRACE_H
+#define SIM_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Bus access tracer for drivers built WITHOUT HOST_SIM (x86-64 Linux only).
+//
+// The peripheral windows (0x40000000-0x4002FFFF and the GPIO ports at
+// 0x48000000) are mapped into the host process at their hardware addresses
+// with no access rights. Every driver load or store then faults once; the
+// fault handler counts it, opens the window, single-steps the instruction and
+// closes the window again. Drivers run unmodified and see plain memory (no
+// register behavior), so only straight-line register sequences are suitable.
+//
+// Build the driver under test with gcc: it keeps each volatile access a
+// separate instruction, which is what makes one fault equal one access.
+// Sim_TraceInit() checks this on startup.
+
+typedef struct {
+    uint32_t loads;
+    uint32_t stores;
+} Sim_TraceCounts;
+
+bool Sim_TraceInit(void);
+void Sim_TraceStart(void);
+void Sim_TraceStop(Sim_TraceCounts *counts);
+
+#endif // SIM_TRACE_H
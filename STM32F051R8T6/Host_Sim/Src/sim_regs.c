@@ -0,0 +1,771 @@
+#define _GNU_SOURCE
+#include "sim_regs.h"
+#include <stddef.h>
+#include <string.h>
+
+// GPIO and FLASH stores are applied one by one on x86-64 Linux (see sim_regs.h)
+#if defined(__linux__) && defined(__x86_64__)
+#define SIM_GPIO_HOOK    1
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#endif
+
+// One 1 KB block per peripheral. GPIO ports are contiguous with the same
+// 0x400 stride as the hardware so port index arithmetic keeps working.
+#define SIM_BLOCK_WORDS  256
+#define SIM_BLOCK_BYTES  (SIM_BLOCK_WORDS * 4U)
+
+// GPIO register word offsets
+#define GPIO_MODER       0
+#define GPIO_PUPDR       3
+#define GPIO_IDR         4
+#define GPIO_ODR         5
+#define GPIO_BSRR        6
+#define GPIO_BRR         10
+
+// RCC register word offsets
+#define RCC_CR_W         (0x00 / 4)
+#define RCC_CFGR_W       (0x04 / 4)
+#define RCC_BDCR_W       (0x20 / 4)
+#define RCC_CSR_W        (0x24 / 4)
+#define RCC_CR2_W        (0x34 / 4)
+
+// FLASH register word offsets and bits
+#define FLASH_ACR_W      (0x00 / 4)
+#define FLASH_KEYR_W     (0x04 / 4)
+#define FLASH_SR_W       (0x0C / 4)
+#define FLASH_CR_W       (0x10 / 4)
+#define FLASH_AR_W       (0x14 / 4)
+#define FLASH_KEY1       0x45670123UL
+#define FLASH_KEY2       0xCDEF89ABUL
+#define FLASH_SR_BSY     (1U << 0)
+#define FLASH_SR_PGERR   (1U << 2)
+#define FLASH_SR_WRPRTERR (1U << 4)
+#define FLASH_SR_EOP     (1U << 5)
+#define FLASH_SR_W1C     (FLASH_SR_PGERR | FLASH_SR_WRPRTERR | FLASH_SR_EOP)
+#define FLASH_CR_PG      (1U << 0)
+#define FLASH_CR_PER     (1U << 1)
+#define FLASH_CR_MER     (1U << 2)
+#define FLASH_CR_STRT    (1U << 6)
+#define FLASH_CR_LOCK    (1U << 7)
+#define FLASH_CR_ERRIE   (1U << 10)
+#define FLASH_CR_EOPIE   (1U << 12)
+
+// CRC register word offsets and bits
+#define CRC_DR_W         (0x00 / 4)
+#define CRC_CR_W         (0x08 / 4)
+#define CRC_INIT_W       (0x10 / 4)
+#define CRC_CR_RESET     (1U << 0)
+#define CRC_POLY         0x04C11DB7UL
+
+// DMA register word offsets (channel n from 1) and bits
+#define DMA_ISR_W        (0x00 / 4)
+#define DMA_IFCR_W       (0x04 / 4)
+#define DMA_CCR_W(n)     ((0x08 + 20 * ((n) - 1)) / 4)
+#define DMA_CNDTR_W(n)   (DMA_CCR_W(n) + 1)
+#define DMA_CPAR_W(n)    (DMA_CCR_W(n) + 2)
+#define DMA_CMAR_W(n)    (DMA_CCR_W(n) + 3)
+#define DMA_CHANNELS     5
+#define DMA_CCR_EN       (1U << 0)
+#define DMA_CCR_DIR      (1U << 4)
+#define DMA_CCR_MINC     (1U << 7)
+#define DMA_CCR_SIZES    (0xFU << 8)     // PSIZE and MSIZE
+#define DMA_CCR_WORDS    (0xAU << 8)     // Both 32-bit
+#define DMA_CCR_MEM2MEM  (1U << 14)
+#define DMA_GIF          (1U << 0)       // Channel flags, shifted by 4 per channel
+#define DMA_TCIF         (1U << 1)
+#define DMA_HTIF         (1U << 2)
+#define DMA_TEIF         (1U << 3)
+
+// Flash memory, mapped at its own address so 32-bit addresses reach it
+#define SIM_FLASH_MEMORY 0x08000000UL
+#define SIM_FLASH_SIZE   (64U * 1024U)
+#define SIM_FLASH_PAGE   1024U
+#define SIM_ERASED_HALF  0xFFFFU
+#define SIM_FLASH_IRQN   3
+
+#define SIM_X86_TF       0x100UL     // EFLAGS trap flag
+#define SIM_PAGE_SIZE    4096U
+
+// The GPIO ports share a page-aligned window of their own, so they can be
+// write-protected without touching anything else. The FLASH registers get
+// a page of their own for the same reason.
+#define SIM_GPIO_BYTES   (SIM_GPIO_PORTS * SIM_BLOCK_BYTES)
+#define SIM_GPIO_WINDOW  ((SIM_GPIO_BYTES + SIM_PAGE_SIZE - 1U) & ~(SIM_PAGE_SIZE - 1U))
+
+static volatile uint32_t sim_gpio[SIM_GPIO_WINDOW / SIM_BLOCK_BYTES][SIM_BLOCK_WORDS]
+    __attribute__((aligned(SIM_PAGE_SIZE)));
+static volatile uint32_t sim_rcc[SIM_BLOCK_WORDS];
+static volatile uint32_t sim_flash[SIM_PAGE_SIZE / 4U] __attribute__((aligned(SIM_PAGE_SIZE)));
+static volatile uint32_t sim_systick[4];
+static volatile uint32_t sim_nvic[SIM_BLOCK_WORDS];
+static volatile uint32_t sim_crc[SIM_BLOCK_WORDS];
+static volatile uint32_t sim_dma[SIM_BLOCK_WORDS];
+static uint32_t sim_rcc_stuck;          // RCC_CR ready bits held low (Sim_FailOscillator)
+static uint32_t sim_rcc_sws;            // Source SWS reports (read-only to drivers)
+static int sim_rcc_switch_held;         // SWS frozen (Sim_HoldClockSwitch)
+static uint16_t sim_inputs[SIM_GPIO_PORTS];
+static uint32_t sim_flash_key_stage;
+static int sim_ready;
+static Sim_Isr sim_observer;            // Runs after every model update (Sim_SetObserver)
+static int sim_observing;
+
+#ifdef SIM_GPIO_HOOK
+// Write-protected blocks whose stores are applied one by one
+enum { SIM_HOOK_GPIO, SIM_HOOK_FLASH_REGS, SIM_HOOK_FLASH_MEMORY, SIM_HOOKS };
+
+typedef struct {
+    uintptr_t base;                     // 0 if not mapped
+    size_t bytes;                       // Whole pages
+    size_t used;                        // Bytes a store may hit
+    int depth;                          // Open requests (Sim_HookWindow)
+} Sim_Hook;
+
+static Sim_Hook sim_hooks[SIM_HOOKS];
+static volatile sig_atomic_t sim_store_hook = -1;   // Block being stored to, -1 if none
+static uintptr_t sim_store_address;     // Faulting address
+static uint32_t sim_store_old;          // Its aligned word before the store
+static int sim_hook_ready;
+static Sim_Isr sim_isr;                 // Preempts GPIO stores (Sim_SetPreemption)
+static uint32_t sim_isr_period;
+static uint32_t sim_isr_countdown;
+static int sim_isr_running;
+static uint32_t sim_flash_operations;   // Programs and erases (Sim_FlashOperations)
+static uint32_t sim_cut_countdown;      // Operations left before the cut, 0 if none
+static Sim_Isr sim_on_cut;
+#endif
+
+// Copy bit 'on' to bit 'rdy'
+static uint32_t Sim_Follow(uint32_t reg, uint32_t on, uint32_t rdy) {
+    return (reg & (1U << on)) ? (reg | (1U << rdy)) : (reg & ~(1U << rdy));
+}
+
+static void Sim_SyncRcc(void) {
+    uint32_t cr = sim_rcc[RCC_CR_W];
+    cr = Sim_Follow(cr, 0, 1);      // HSION -> HSIRDY
+    cr = Sim_Follow(cr, 16, 17);    // HSEON -> HSERDY
+    cr = Sim_Follow(cr, 24, 25);    // PLLON -> PLLRDY
+    sim_rcc[RCC_CR_W] = cr & ~sim_rcc_stuck;
+
+    uint32_t cr2 = sim_rcc[RCC_CR2_W];
+    cr2 = Sim_Follow(cr2, 0, 1);    // HSI14ON -> HSI14RDY
+    cr2 = Sim_Follow(cr2, 16, 17);  // HSI48ON -> HSI48RDY
+    sim_rcc[RCC_CR2_W] = cr2;
+
+    sim_rcc[RCC_BDCR_W] = Sim_Follow(sim_rcc[RCC_BDCR_W], 0, 1);  // LSEON -> LSERDY
+    sim_rcc[RCC_CSR_W] = Sim_Follow(sim_rcc[RCC_CSR_W], 0, 1);    // LSION -> LSIRDY
+
+    // SWS (bits 3:2) reports the source selected by SW (bits 1:0) once that
+    // source is ready: HSIRDY, HSERDY, PLLRDY, HSI48RDY
+    static const uint8_t ready_bit[4] = { 1, 17, 25, 17 };
+    uint32_t cfgr = sim_rcc[RCC_CFGR_W];
+    uint32_t sw = cfgr & 0x3U;
+    uint32_t ready = (sw == 3U) ? sim_rcc[RCC_CR2_W] : sim_rcc[RCC_CR_W];
+    if (!sim_rcc_switch_held && (ready & (1U << ready_bit[sw]))) {
+        sim_rcc_sws = sw;
+    }
+    sim_rcc[RCC_CFGR_W] = (cfgr & ~0xCU) | (sim_rcc_sws << 2);
+}
+
+// Private: apply BRR/BSRR to ODR and refresh IDR for one port
+static void Sim_SyncGpioPort(uint32_t port) {
+    volatile uint32_t *regs = sim_gpio[port];
+    uint32_t bsrr = regs[GPIO_BSRR];
+    uint32_t odr = regs[GPIO_ODR];
+    uint32_t output_mask = 0;
+
+    // BRR first, then BSRR (BSRR set wins over its own reset half)
+    odr &= ~(regs[GPIO_BRR] & 0xFFFFU);
+    odr = (odr & ~(bsrr >> 16)) | (bsrr & 0xFFFFU);
+    regs[GPIO_ODR] = odr & 0xFFFFU;
+    regs[GPIO_BSRR] = 0;
+    regs[GPIO_BRR] = 0;
+
+    // Pins in general purpose output mode read back what they drive
+    uint32_t moder = regs[GPIO_MODER];
+    for (uint32_t pin = 0; pin < 16; pin++) {
+        if (((moder >> (2 * pin)) & 3U) == 1U) {
+            output_mask |= 1U << pin;
+        }
+    }
+    regs[GPIO_IDR] = (odr & output_mask) | (sim_inputs[port] & ~output_mask);
+}
+
+#ifdef SIM_GPIO_HOOK
+// Private: make a hooked block writable for the models, or protect it
+// again once every opener has closed it
+static void Sim_HookWindow(int hook, int writable) {
+    Sim_Hook *window = &sim_hooks[hook];
+
+    if (!sim_hook_ready || window->base == 0) {
+        return;
+    }
+    if (writable) {
+        if (window->depth++ == 0) {
+            mprotect((void *)window->base, window->bytes, PROT_READ | PROT_WRITE);
+        }
+    } else if (--window->depth == 0) {
+        mprotect((void *)window->base, window->bytes, PROT_READ);
+    }
+}
+#endif
+
+// Private: open or close the GPIO window (no-op without the hook)
+static void Sim_GpioWindow(int writable) {
+#ifdef SIM_GPIO_HOOK
+    Sim_HookWindow(SIM_HOOK_GPIO, writable);
+#else
+    (void)writable;
+#endif
+}
+
+static void Sim_SyncGpio(void) {
+    Sim_GpioWindow(1);
+    for (uint32_t port = 0; port < SIM_GPIO_PORTS; port++) {
+        Sim_SyncGpioPort(port);
+    }
+    Sim_GpioWindow(0);
+}
+
+// Private: consume a KEYR write and advance the unlock sequence
+static void Sim_FlashKey(uint32_t key) {
+    if (sim_flash_key_stage == 0 && key == FLASH_KEY1) {
+        sim_flash_key_stage = 1;
+    } else if (sim_flash_key_stage == 1 && key == FLASH_KEY2) {
+        sim_flash[FLASH_CR_W] &= ~FLASH_CR_LOCK;
+        sim_flash_key_stage = 0;
+    } else {
+        sim_flash_key_stage = 0;
+    }
+    sim_flash[FLASH_KEYR_W] = 0;
+}
+
+#ifdef SIM_GPIO_HOOK
+// Private: count a program or erase. True if the power fails during it.
+static bool Sim_FlashOperation(void) {
+    sim_flash_operations++;
+    if (sim_cut_countdown != 0 && --sim_cut_countdown == 0) {
+        return true;
+    }
+    return false;
+}
+
+// Private: power gone. Close the window and hand over to the test, which
+// does not come back (siglongjmp).
+static void Sim_PowerCut(int hook) {
+    Sim_HookWindow(hook, 0);
+    sim_on_cut();
+}
+
+// Private: FLASH_CR store with STRT: erase the page at AR, or everything
+static void Sim_FlashErase(uint32_t cr) {
+    uintptr_t memory = sim_hooks[SIM_HOOK_FLASH_MEMORY].base;
+    uint32_t offset = sim_flash[FLASH_AR_W] - SIM_FLASH_MEMORY;
+    uint32_t start = 0;
+    uint32_t bytes = SIM_FLASH_SIZE;
+
+    if (memory == 0) {
+        sim_flash[FLASH_SR_W] |= FLASH_SR_EOP;
+        return;
+    }
+    if (!(cr & FLASH_CR_MER)) {
+        if (offset >= SIM_FLASH_SIZE) {
+            sim_flash[FLASH_SR_W] |= FLASH_SR_WRPRTERR;
+            return;
+        }
+        start = offset & ~(SIM_FLASH_PAGE - 1U);
+        bytes = SIM_FLASH_PAGE;
+    }
+
+    Sim_HookWindow(SIM_HOOK_FLASH_MEMORY, 1);
+    if (Sim_FlashOperation()) {
+        // Torn erase: on every other operation the first half is erased,
+        // otherwise the cut came before anything changed
+        if (sim_flash_operations & 1U) {
+            memset((void *)(memory + start), 0xFF, bytes / 2U);
+        }
+        Sim_HookWindow(SIM_HOOK_FLASH_MEMORY, 0);
+        Sim_PowerCut(SIM_HOOK_FLASH_REGS);
+    }
+    memset((void *)(memory + start), 0xFF, bytes);
+    Sim_HookWindow(SIM_HOOK_FLASH_MEMORY, 0);
+    sim_flash[FLASH_SR_W] |= FLASH_SR_EOP;
+}
+
+// Private: apply one store to the FLASH registers (SR is write-1-to-clear,
+// CR keeps LOCK until the key sequence, STRT runs the erase)
+static void Sim_OnFlashRegStore(uint32_t word, uint32_t old) {
+    uint32_t value = sim_flash[word];
+
+    switch (word) {
+    case FLASH_KEYR_W:
+        Sim_FlashKey(value);
+        break;
+    case FLASH_SR_W:
+        sim_flash[FLASH_SR_W] = old & ~(value & FLASH_SR_W1C);
+        break;
+    case FLASH_CR_W:
+        if (old & FLASH_CR_LOCK) {
+            sim_flash[FLASH_CR_W] = old | (value & FLASH_CR_LOCK);
+        } else if (value & FLASH_CR_STRT) {
+            sim_flash[FLASH_CR_W] = value & ~FLASH_CR_STRT;
+            if (value & (FLASH_CR_PER | FLASH_CR_MER)) {
+                Sim_FlashErase(value);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// Private: apply one half-word store to flash memory. It needs PG set and
+// the flash unlocked, and the target erased (or the new value 0); anything
+// else leaves the memory alone and sets PGERR.
+static void Sim_OnFlashProgram(uintptr_t address, uint16_t old) {
+    volatile uint16_t *half = (volatile uint16_t *)address;
+    uint16_t value = *half;
+
+    if ((sim_flash[FLASH_CR_W] & (FLASH_CR_PG | FLASH_CR_LOCK)) != FLASH_CR_PG ||
+        (old != SIM_ERASED_HALF && value != 0)) {
+        *half = old;
+        Sim_HookWindow(SIM_HOOK_FLASH_REGS, 1);
+        sim_flash[FLASH_SR_W] |= FLASH_SR_PGERR;
+        Sim_HookWindow(SIM_HOOK_FLASH_REGS, 0);
+        return;
+    }
+    if (Sim_FlashOperation()) {
+        // Torn program: on every other operation only the high byte's cells
+        // got there, otherwise none did
+        *half = (sim_flash_operations & 1U) ? (uint16_t)(value | (old & 0x00FFU)) : old;
+        Sim_PowerCut(SIM_HOOK_FLASH_MEMORY);
+    }
+    Sim_HookWindow(SIM_HOOK_FLASH_REGS, 1);
+    sim_flash[FLASH_SR_W] |= FLASH_SR_EOP;
+    Sim_HookWindow(SIM_HOOK_FLASH_REGS, 0);
+}
+
+// Private: the hooked block holding address, or -1
+static int Sim_FindHook(uintptr_t address) {
+    for (int hook = 0; hook < SIM_HOOKS; hook++) {
+        if (sim_hooks[hook].base != 0 && address - sim_hooks[hook].base < sim_hooks[hook].used) {
+            return hook;
+        }
+    }
+    return -1;
+}
+
+// Store to a hooked block: open it and single-step the instruction
+static void Sim_OnGpioStore(int sig, siginfo_t *info, void *context) {
+    ucontext_t *uc = (ucontext_t *)context;
+    uintptr_t address = (uintptr_t)info->si_addr;
+    int hook = Sim_FindHook(address);
+
+    if (hook < 0) {
+        signal(sig, SIG_DFL);           // A real crash: let it happen
+        return;
+    }
+    sim_store_hook = hook;
+    sim_store_address = address;
+    sim_store_old = *(volatile uint32_t *)(address & ~(uintptr_t)3U);
+    Sim_HookWindow(hook, 1);
+
+    // Interrupt between the driver's last load and this store. The ISR's
+    // own stores land in the open window and are applied right after it.
+    if (hook == SIM_HOOK_GPIO && sim_isr != NULL && !sim_isr_running && --sim_isr_countdown == 0) {
+        sim_isr_countdown = sim_isr_period;
+        sim_isr_running = 1;
+        sim_isr();
+        sim_isr_running = 0;
+        Sim_SyncGpio();
+    }
+    uc->uc_mcontext.gregs[REG_EFL] |= SIM_X86_TF;
+}
+
+// Store done: apply it to its model, then protect the block again
+static void Sim_OnGpioStep(int sig, siginfo_t *info, void *context) {
+    ucontext_t *uc = (ucontext_t *)context;
+    int hook = sim_store_hook;
+
+    (void)sig;
+    (void)info;
+    uc->uc_mcontext.gregs[REG_EFL] &= ~SIM_X86_TF;
+    if (hook < 0) {
+        return;
+    }
+    sim_store_hook = -1;
+
+    uintptr_t offset = sim_store_address - sim_hooks[hook].base;
+    uintptr_t word = sim_store_address & ~(uintptr_t)3U;
+    uint32_t now = *(volatile uint32_t *)word;
+
+    if (hook == SIM_HOOK_GPIO) {
+        Sim_SyncGpioPort((uint32_t)(offset / SIM_BLOCK_BYTES));
+    } else if (hook == SIM_HOOK_FLASH_REGS) {
+        Sim_OnFlashRegStore((uint32_t)(offset / 4U), sim_store_old);
+    } else {
+        // The stored half-word, and the other one if a word store changed it
+        uint32_t stored = (uint32_t)(sim_store_address & 2U);
+
+        Sim_OnFlashProgram(word + stored, (uint16_t)(sim_store_old >> (8U * stored)));
+        if (((now ^ sim_store_old) >> (8U * (2U - stored))) & 0xFFFFU) {
+            Sim_OnFlashProgram(word + (2U - stored), (uint16_t)(sim_store_old >> (8U * (2U - stored))));
+        }
+    }
+    Sim_HookWindow(hook, 0);
+}
+
+// Private: map the flash memory at its own address (not always possible)
+static void Sim_MapFlashMemory(void) {
+    void *memory = mmap((void *)SIM_FLASH_MEMORY, SIM_FLASH_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (memory != (void *)SIM_FLASH_MEMORY) {
+        if (memory != MAP_FAILED) {
+            munmap(memory, SIM_FLASH_SIZE);
+        }
+        return;
+    }
+    memset(memory, 0xFF, SIM_FLASH_SIZE);
+    mprotect(memory, SIM_FLASH_SIZE, PROT_READ);
+    sim_hooks[SIM_HOOK_FLASH_MEMORY] = (Sim_Hook){ SIM_FLASH_MEMORY, SIM_FLASH_SIZE, SIM_FLASH_SIZE, 0 };
+}
+
+// Private: install the store handlers and protect the hooked blocks (once)
+static void Sim_InitGpioHook(void) {
+    struct sigaction action;
+
+    sim_hooks[SIM_HOOK_GPIO] = (Sim_Hook){ (uintptr_t)sim_gpio, SIM_GPIO_WINDOW, SIM_GPIO_BYTES, 0 };
+    sim_hooks[SIM_HOOK_FLASH_REGS] = (Sim_Hook){ (uintptr_t)sim_flash, sizeof(sim_flash), SIM_BLOCK_BYTES, 0 };
+    Sim_MapFlashMemory();
+
+    memset(&action, 0, sizeof(action));
+    action.sa_flags = SA_SIGINFO;
+    action.sa_sigaction = Sim_OnGpioStore;
+    sigaction(SIGSEGV, &action, NULL);
+    action.sa_sigaction = Sim_OnGpioStep;
+    sigaction(SIGTRAP, &action, NULL);
+    sim_hook_ready = 1;
+
+    for (int hook = 0; hook < SIM_HOOKS; hook++) {
+        if (sim_hooks[hook].base != 0) {
+            mprotect((void *)sim_hooks[hook].base, sim_hooks[hook].bytes, PROT_READ);
+        }
+    }
+}
+#endif
+
+// Lazy FLASH model, used when stores are not hooked
+static void Sim_SyncFlash(void) {
+#ifdef SIM_GPIO_HOOK
+    if (sim_hook_ready) {
+        return;
+    }
+#endif
+    // KEYR is write-only: consume the last write
+    if (sim_flash[FLASH_KEYR_W] != 0) {
+        Sim_FlashKey(sim_flash[FLASH_KEYR_W]);
+    }
+
+    // Operations finish instantly
+    if (sim_flash[FLASH_CR_W] & FLASH_CR_STRT) {
+        sim_flash[FLASH_CR_W] &= ~FLASH_CR_STRT;
+        sim_flash[FLASH_SR_W] |= FLASH_SR_EOP;
+    }
+    if (sim_flash[FLASH_CR_W] & FLASH_CR_PG) {
+        sim_flash[FLASH_SR_W] |= FLASH_SR_EOP;
+    }
+    sim_flash[FLASH_SR_W] &= ~FLASH_SR_BSY;
+}
+
+// CRC_CR.RESET loads CRC_INIT into CRC_DR
+static void Sim_SyncCrc(void) {
+    if (sim_crc[CRC_CR_W] & CRC_CR_RESET) {
+        sim_crc[CRC_CR_W] &= ~CRC_CR_RESET;
+        sim_crc[CRC_DR_W] = sim_crc[CRC_INIT_W];
+    }
+}
+
+// Private: one word into the CRC unit (MSB first, no reflection)
+static void Sim_CrcFeed(uint32_t word) {
+    uint32_t crc = sim_crc[CRC_DR_W] ^ word;
+
+    for (uint32_t bit = 0; bit < 32U; bit++) {
+        crc = (crc & 0x80000000UL) ? (crc << 1) ^ CRC_POLY : (crc << 1);
+    }
+    sim_crc[CRC_DR_W] = crc;
+}
+
+// Enabled memory-to-memory channels run to the end at once. Only 32-bit
+// transfers from memory into CRC_DR are modeled; anything else is a
+// transfer error.
+static void Sim_SyncDma(void) {
+    uint32_t clear = sim_dma[DMA_IFCR_W];
+
+    // IFCR is write-only: clear the flags it names
+    sim_dma[DMA_ISR_W] &= ~clear;
+    sim_dma[DMA_IFCR_W] = 0;
+
+    for (uint32_t n = 1; n <= DMA_CHANNELS; n++) {
+        uint32_t ccr = sim_dma[DMA_CCR_W(n)];
+        uint32_t count = sim_dma[DMA_CNDTR_W(n)];
+        uint32_t flags = DMA_GIF | DMA_TCIF | DMA_HTIF;
+
+        if ((ccr & (DMA_CCR_EN | DMA_CCR_MEM2MEM)) != (DMA_CCR_EN | DMA_CCR_MEM2MEM) || count == 0) {
+            continue;
+        }
+        if ((ccr & DMA_CCR_SIZES) != DMA_CCR_WORDS || !(ccr & DMA_CCR_DIR) ||
+            sim_dma[DMA_CPAR_W(n)] != (uint32_t)(uintptr_t)&sim_crc[CRC_DR_W]) {
+            flags = DMA_GIF | DMA_TEIF;
+        } else {
+            const volatile uint32_t *source = (const volatile uint32_t *)(uintptr_t)sim_dma[DMA_CMAR_W(n)];
+
+            Sim_SyncCrc();
+            for (uint32_t i = 0; i < count; i++) {
+                Sim_CrcFeed(*source);
+                source += (ccr & DMA_CCR_MINC) ? 1 : 0;
+            }
+            sim_dma[DMA_CNDTR_W(n)] = 0;
+        }
+        sim_dma[DMA_ISR_W] |= flags << (4U * (n - 1U));
+    }
+}
+
+// Put every block in its reset state
+void Sim_Reset(void) {
+#ifdef SIM_GPIO_HOOK
+    if (!sim_hook_ready) {
+        Sim_InitGpioHook();
+    }
+#endif
+    Sim_GpioWindow(1);
+#ifdef SIM_GPIO_HOOK
+    Sim_HookWindow(SIM_HOOK_FLASH_REGS, 1);
+    sim_cut_countdown = 0;
+#endif
+    memset((void *)sim_gpio, 0, sizeof(sim_gpio));
+    memset((void *)sim_rcc, 0, sizeof(sim_rcc));
+    memset((void *)sim_flash, 0, sizeof(sim_flash));
+    memset((void *)sim_systick, 0, sizeof(sim_systick));
+    memset((void *)sim_nvic, 0, sizeof(sim_nvic));
+    memset((void *)sim_crc, 0, sizeof(sim_crc));
+    memset((void *)sim_dma, 0, sizeof(sim_dma));
+    sim_crc[CRC_DR_W] = 0xFFFFFFFFUL;
+    sim_crc[CRC_INIT_W] = 0xFFFFFFFFUL;
+    memset(sim_inputs, 0, sizeof(sim_inputs));
+
+    sim_gpio[0][GPIO_MODER] = 0x28000000UL;     // PA13/PA14 on SWD
+    sim_gpio[0][GPIO_PUPDR] = 0x24000000UL;     // PA13 pull-up, PA14 pull-down
+    Sim_GpioWindow(0);
+    sim_rcc[RCC_CR_W] = 0x00000083UL;           // HSION, HSIRDY, HSITRIM = 16
+    sim_rcc[RCC_CSR_W] = 0x0C000000UL;          // Reset flags after power-on
+    sim_flash[FLASH_ACR_W] = 0x00000030UL;      // Prefetch enabled
+    sim_flash[FLASH_CR_W] = FLASH_CR_LOCK;
+#ifdef SIM_GPIO_HOOK
+    Sim_HookWindow(SIM_HOOK_FLASH_REGS, 0);
+#endif
+    sim_flash_key_stage = 0;
+    sim_rcc_stuck = 0;
+    sim_rcc_sws = 0;
+    sim_rcc_switch_held = 0;
+    sim_ready = 1;
+}
+
+// Run all register models
+void Sim_Sync(void) {
+    if (!sim_ready) {
+        Sim_Reset();
+    }
+    Sim_SyncRcc();
+    Sim_SyncGpio();
+    Sim_SyncFlash();
+    Sim_SyncCrc();
+    Sim_SyncDma();
+    if (sim_observer != NULL && !sim_observing) {
+        sim_observing = 1;
+        sim_observer();
+        sim_observing = 0;
+    }
+}
+
+// Drive the input levels of a port (pins not configured as outputs)
+void Sim_SetInput(uint32_t port, uint16_t levels) {
+    if (port < SIM_GPIO_PORTS) {
+        sim_inputs[port] = levels;
+        Sim_Sync();
+    }
+}
+
+// True if every GPIO store is applied as it happens. Otherwise stores are
+// only applied at the next base evaluation or Sim_Sync().
+bool Sim_GpioStoresApplied(void) {
+#ifdef SIM_GPIO_HOOK
+    Sim_Sync();
+    return sim_hook_ready != 0;
+#else
+    return false;
+#endif
+}
+
+// Keep the given RCC_CR ready bits (HSIRDY, HSERDY, PLLRDY) low whatever
+// their ON bits say, as a missing crystal or a PLL that never locks would.
+// 0 restores normal behavior.
+void Sim_FailOscillator(uint32_t cr_ready_bits) {
+    Sim_Sync();
+    sim_rcc_stuck = cr_ready_bits;
+    Sim_SyncRcc();
+}
+
+// Keep CFGR.SWS where it is whatever SW selects, as a switch to a source
+// that failed right after it was requested would. false restores normal
+// behavior.
+void Sim_HoldClockSwitch(bool hold) {
+    Sim_Sync();
+    sim_rcc_switch_held = hold;
+}
+
+// Run observer after every model update, i.e. at each base evaluation, so a
+// test can check an invariant at every step of a register sequence. Its own
+// register reads do not call it again. NULL stops it.
+void Sim_SetObserver(Sim_Isr observer) {
+    sim_observer = observer;
+}
+
+// Run isr before every period-th GPIO store, as an interrupt arriving
+// between a driver's loads and its store would. NULL stops it. Needs
+// Sim_GpioStoresApplied().
+void Sim_SetPreemption(Sim_Isr isr, uint32_t period) {
+#ifdef SIM_GPIO_HOOK
+    sim_isr = NULL;
+    sim_isr_period = (period == 0) ? 1U : period;
+    sim_isr_countdown = sim_isr_period;
+    sim_isr = isr;
+#else
+    (void)isr;
+    (void)period;
+#endif
+}
+
+// True if flash memory is mapped at 0x08000000 and every FLASH register and
+// flash memory store is applied as it happens (see sim_regs.h)
+bool Sim_FlashStoresApplied(void) {
+#ifdef SIM_GPIO_HOOK
+    Sim_Sync();
+    return sim_hooks[SIM_HOOK_FLASH_MEMORY].base != 0;
+#else
+    return false;
+#endif
+}
+
+// Erase the whole flash memory, as on a new part. It is left alone by
+// Sim_Reset(), so it survives a simulated power cut.
+void Sim_EraseFlash(void) {
+#ifdef SIM_GPIO_HOOK
+    Sim_Sync();
+    if (sim_hooks[SIM_HOOK_FLASH_MEMORY].base != 0) {
+        Sim_HookWindow(SIM_HOOK_FLASH_MEMORY, 1);
+        memset((void *)SIM_FLASH_MEMORY, 0xFF, SIM_FLASH_SIZE);
+        Sim_HookWindow(SIM_HOOK_FLASH_MEMORY, 0);
+    }
+#endif
+}
+
+// Copy data into flash memory at address, as a programmer would (no
+// program or erase rules, not counted as operations)
+void Sim_LoadFlash(uint32_t address, const void *data, uint32_t length) {
+#ifdef SIM_GPIO_HOOK
+    Sim_Sync();
+    if (sim_hooks[SIM_HOOK_FLASH_MEMORY].base != 0 &&
+        address >= SIM_FLASH_MEMORY && address - SIM_FLASH_MEMORY + length <= SIM_FLASH_SIZE) {
+        Sim_HookWindow(SIM_HOOK_FLASH_MEMORY, 1);
+        memcpy((void *)(uintptr_t)address, data, length);
+        Sim_HookWindow(SIM_HOOK_FLASH_MEMORY, 0);
+    }
+#else
+    (void)address;
+    (void)data;
+    (void)length;
+#endif
+}
+
+// Flash programs (half-words) and erases (pages) so far
+uint32_t Sim_FlashOperations(void) {
+#ifdef SIM_GPIO_HOOK
+    return sim_flash_operations;
+#else
+    return 0;
+#endif
+}
+
+// Cut the power during the operation-th flash program or erase from now
+// (1 = the next one). The operation is left half done and on_cut runs in
+// place of the rest of the driver; it must not return, but siglongjmp back
+// to a sigsetjmp(env, 1) in the test. Sim_Reset() then stands for the
+// reboot. 0 disarms. Needs Sim_FlashStoresApplied().
+void Sim_SetPowerCut(uint32_t operation, Sim_Isr on_cut) {
+#ifdef SIM_GPIO_HOOK
+    sim_cut_countdown = (on_cut != NULL) ? operation : 0U;
+    sim_on_cut = on_cut;
+#else
+    (void)operation;
+    (void)on_cut;
+#endif
+}
+
+// True if FLASH_IRQHandler would be entered: the FLASH interrupt enabled in
+// NVIC_ISER, and EOP or an error flag with its enable set in FLASH_CR
+bool Sim_FlashIrqPending(void) {
+    uint32_t sr;
+    uint32_t cr;
+
+    Sim_Sync();
+    sr = sim_flash[FLASH_SR_W];
+    cr = sim_flash[FLASH_CR_W];
+    return (sim_nvic[0] & (1U << SIM_FLASH_IRQN)) &&
+           (((cr & FLASH_CR_EOPIE) && (sr & FLASH_SR_EOP)) ||
+            ((cr & FLASH_CR_ERRIE) && (sr & (FLASH_SR_PGERR | FLASH_SR_WRPRTERR))));
+}
+
+// Read a register after running the models (for test assertions)
+uint32_t Sim_Read(uintptr_t base, uint32_t offset) {
+    Sim_Sync();
+    return *(volatile uint32_t *)(base + offset);
+}
+
+uintptr_t Sim_GpioBase(uint32_t port) {
+    Sim_Sync();
+    return (uintptr_t)sim_gpio[port];
+}
+
+uintptr_t Sim_RccBase(void) {
+    Sim_Sync();
+    return (uintptr_t)sim_rcc;
+}
+
+uintptr_t Sim_FlashBase(void) {
+    Sim_Sync();
+    return (uintptr_t)sim_flash;
+}
+
+uintptr_t Sim_CrcBase(void) {
+    Sim_Sync();
+    return (uintptr_t)sim_crc;
+}
+
+uintptr_t Sim_DmaBase(void) {
+    Sim_Sync();
+    return (uintptr_t)sim_dma;
+}
+
+// NVIC is plain memory: ISER keeps what was written, nothing is dispatched
+uintptr_t Sim_NvicBase(void) {
+    Sim_Sync();
+    return (uintptr_t)sim_nvic;
+}
+
+// SysTick is plain memory: CVR only moves when a test writes it
+uintptr_t Sim_SysTickBase(void) {
+    Sim_Sync();
+    return (uintptr_t)sim_systick;
+}
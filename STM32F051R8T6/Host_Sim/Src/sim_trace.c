@@ -0,0 +1,135 @@
+#define _GNU_SOURCE
+#include "sim_trace.h"
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+
+#if defined(__linux__) && defined(__x86_64__)
+
+#define TRACE_X86_TF        0x100UL     // EFLAGS trap flag
+#define TRACE_PF_WRITE      0x2UL       // Page fault error code: write access
+
+// Peripheral windows mapped at their hardware addresses
+typedef struct {
+    uintptr_t base;
+    size_t size;
+} Trace_Window;
+
+static const Trace_Window trace_windows[] = {
+    { 0x40000000UL, 0x30000UL },        // APB and AHB1 (TIM, SYSCFG, EXTI, RCC, FLASH, CRC)
+    { 0x48000000UL, 0x2000UL },         // GPIOA-GPIOF (AHB2)
+};
+
+#define TRACE_WINDOW_COUNT  (sizeof(trace_windows) / sizeof(trace_windows[0]))
+
+static volatile sig_atomic_t trace_active;
+static volatile uint32_t trace_loads;
+static volatile uint32_t trace_stores;
+static int trace_open_window = -1;
+
+static int Trace_FindWindow(uintptr_t address) {
+    for (uint32_t i = 0; i < TRACE_WINDOW_COUNT; i++) {
+        if (address - trace_windows[i].base < trace_windows[i].size) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// Access fault: count it, open the window and single-step the instruction
+static void Trace_OnFault(int sig, siginfo_t *info, void *context) {
+    ucontext_t *uc = (ucontext_t *)context;
+    int window = Trace_FindWindow((uintptr_t)info->si_addr);
+
+    if (window < 0) {
+        signal(sig, SIG_DFL);           // A real crash: let it happen
+        return;
+    }
+
+    if (trace_active) {
+        if (uc->uc_mcontext.gregs[REG_ERR] & TRACE_PF_WRITE) {
+            trace_stores++;
+        } else {
+            trace_loads++;
+        }
+    }
+
+    mprotect((void *)trace_windows[window].base, trace_windows[window].size,
+             PROT_READ | PROT_WRITE);
+    trace_open_window = window;
+    uc->uc_mcontext.gregs[REG_EFL] |= TRACE_X86_TF;
+}
+
+// Instruction done: close the window again
+static void Trace_OnStep(int sig, siginfo_t *info, void *context) {
+    ucontext_t *uc = (ucontext_t *)context;
+
+    (void)sig;
+    (void)info;
+    if (trace_open_window >= 0) {
+        mprotect((void *)trace_windows[trace_open_window].base,
+                 trace_windows[trace_open_window].size, PROT_NONE);
+        trace_open_window = -1;
+    }
+    uc->uc_mcontext.gregs[REG_EFL] &= ~TRACE_X86_TF;
+}
+
+// Map the windows and install the handlers. Returns false if the addresses
+// are taken or the compiler merged a volatile read-modify-write.
+bool Sim_TraceInit(void) {
+    struct sigaction action;
+    Sim_TraceCounts counts;
+
+    for (uint32_t i = 0; i < TRACE_WINDOW_COUNT; i++) {
+        void *block = mmap((void *)trace_windows[i].base, trace_windows[i].size, PROT_NONE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+        if (block != (void *)trace_windows[i].base) {
+            return false;
+        }
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_flags = SA_SIGINFO;
+    action.sa_sigaction = Trace_OnFault;
+    sigaction(SIGSEGV, &action, NULL);
+    action.sa_sigaction = Trace_OnStep;
+    sigaction(SIGTRAP, &action, NULL);
+
+    // Calibration: a read-modify-write must be one load and one store
+    Sim_TraceStart();
+    *(volatile uint32_t *)0x40021014UL |= 1U;
+    Sim_TraceStop(&counts);
+    *(volatile uint32_t *)0x40021014UL = 0;
+
+    return counts.loads == 1 && counts.stores == 1;
+}
+
+#else
+
+bool Sim_TraceInit(void) {
+    return false;
+}
+
+#endif
+
+// Zero the counters and start counting
+void Sim_TraceStart(void) {
+#if defined(__linux__) && defined(__x86_64__)
+    trace_loads = 0;
+    trace_stores = 0;
+    trace_active = 1;
+#endif
+}
+
+// Stop counting and return the accesses since Sim_TraceStart()
+void Sim_TraceStop(Sim_TraceCounts *counts) {
+#if defined(__linux__) && defined(__x86_64__)
+    trace_active = 0;
+    counts->loads = trace_loads;
+    counts->stores = trace_stores;
+#else
+    counts->loads = 0;
+    counts->stores = 0;
+#endif
+}
@@ -0,0 +1,33 @@
+# Checks the gpio::Pin probes in the x86-64 assembly of gpio_pin_codegen.cpp:
+# one access to a constant port address per probe, no call or branch, and
+# nothing but that store in the output probes (everything except Probe_Read).
+
+/^Probe_[A-Za-z]+:/ {
+    name = substr($1, 1, length($1) - 1)
+    names[++count] = name
+    next
+}
+name == "" || /^[ \t]*[.#]/ || /^[ \t]*$/ { next }
+/^[^ \t]/ { name = ""; next }
+$1 == "ret" { name = ""; next }
+{
+    insns[name]++
+    if ($0 ~ /[ \t,]1207[0-9][0-9][0-9][0-9][0-9][0-9]/) {    # The GPIO ports, 0x48000000 up
+        access[name]++
+    }
+    if ($1 ~ /^(call|jmp|j[a-z]+)$/) {
+        branch[name]++
+    }
+}
+END {
+    failed = 0
+    for (i = 1; i <= count; i++) {
+        n = names[i]
+        if (access[n] != 1 || branch[n] != 0 || (n != "Probe_Read" && insns[n] != 1)) {
+            printf "gpio_pin_codegen: %s: %d instructions, %d port accesses, %d branches\n", n, insns[n], access[n], branch[n]
+            failed++
+        }
+    }
+    printf "gpio_pin_codegen: %d probes, %d failed\n", count, failed
+    exit (count == 0 || failed != 0)
+}
@@ -0,0 +1,30 @@
+#include "gpio_pin.hpp"
+
+// Code generation probes for gpio::Pin, built for the hardware addresses
+// (no HOST_SIM) and only compiled to x86-64 assembly; gpio_pin_codegen.awk
+// checks it. Each probe must touch the port exactly once, through a
+// constant address, with no call or branch; the output probes must be that
+// one store and nothing else. Thumb code adds the literal load of the
+// address, which x86-64 folds into the store.
+
+using Led = gpio::Pin<gpio::PortC, 9>;
+
+extern "C" void Probe_Set(void) {
+    Led::set();
+}
+
+extern "C" void Probe_Reset(void) {
+    Led::reset();
+}
+
+extern "C" void Probe_WriteHigh(void) {
+    Led::write(true);
+}
+
+extern "C" void Probe_WriteLow(void) {
+    Led::write(false);
+}
+
+extern "C" bool Probe_Read(void) {
+    return Led::read();
+}
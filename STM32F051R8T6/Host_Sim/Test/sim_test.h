@@ -0,0 +1,37 @@
+#ifndef SIM_TEST_H
+#define SIM_TEST_H
+
+#include <stdio.h>
+
+// Minimal check helpers for the host tests. A failed check prints its
+// location and the test carries on; Test_Done() gives the exit status.
+
+static unsigned test_checks;
+static unsigned test_failures;
+
+#define CHECK(cond)         Test_Check((cond) != 0, #cond, __FILE__, __LINE__)
+#define CHECK_EQ(a, b)      Test_CheckEq((unsigned long)(a), (unsigned long)(b), #a " == " #b, __FILE__, __LINE__)
+
+static inline void Test_Check(int ok, const char *expr, const char *file, int line) {
+    test_checks++;
+    if (!ok) {
+        test_failures++;
+        printf("%s:%d: check failed: %s\n", file, line, expr);
+    }
+}
+
+static inline void Test_CheckEq(unsigned long a, unsigned long b, const char *expr, const char *file, int line) {
+    test_checks++;
+    if (a != b) {
+        test_failures++;
+        printf("%s:%d: check failed: %s (0x%lX != 0x%lX)\n", file, line, expr, a, b);
+    }
+}
+
+// Print the summary; returns the process exit status
+static inline int Test_Done(const char *name) {
+    printf("%s: %u checks, %u failed\n", name, test_checks, test_failures);
+    return test_failures != 0;
+}
+
+#endif // SIM_TEST_H
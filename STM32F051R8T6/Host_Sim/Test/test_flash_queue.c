@@ -0,0 +1,177 @@
+#include <string.h>
+#include "sim_test.h"
+#include "flash_queue.h"
+
+// Flash job queue against the simulated FLASH registers and flash memory.
+//
+// FLASH_IRQHandler is called whenever the model has an enabled FLASH
+// interrupt pending, as the NVIC would. Checks the data that lands in flash,
+// job order and callbacks, error reporting and the register state left
+// behind when the queue drains.
+
+#define TEST_PAGE           0x0800E000UL    // Two free pages for the tests
+#define TEST_PAGE_SIZE      1024U
+#define TEST_BYTES          37U             // Odd: the last byte gets padded
+
+void FLASH_IRQHandler(void);
+
+static uint8_t test_order[8];
+static uint32_t test_done;
+static FlashQueue_Job test_chained;
+
+static void Test_Callback(FlashQueue_Job *job) {
+    if (test_done < sizeof(test_order)) {
+        test_order[test_done] = (uint8_t)(uintptr_t)job->context;
+    }
+    test_done++;
+}
+
+// A callback that queues one more job from the interrupt
+static void Test_ChainCallback(FlashQueue_Job *job) {
+    Test_Callback(job);
+    CHECK(FlashQueue_Submit(&test_chained));
+}
+
+// Run the interrupt until the queue drains. Returns the handler calls.
+static uint32_t Test_Pump(void) {
+    uint32_t calls = 0;
+
+    while (FlashQueue_IsBusy() && Sim_FlashIrqPending() && calls < 10000U) {
+        FLASH_IRQHandler();
+        calls++;
+    }
+    CHECK(!FlashQueue_IsBusy());
+    return calls;
+}
+
+static void Test_Setup(void) {
+    static uint8_t junk[2U * TEST_PAGE_SIZE];
+
+    memset(junk, 0x5A, sizeof(junk));
+    Sim_EraseFlash();
+    Sim_Reset();
+    Sim_LoadFlash(TEST_PAGE, junk, sizeof(junk));
+    test_done = 0;
+    memset(test_order, 0, sizeof(test_order));
+}
+
+static void Test_EraseAndProgram(void) {
+    static uint8_t data[TEST_BYTES];
+    const uint8_t *flash = (const uint8_t *)(uintptr_t)TEST_PAGE;
+    FlashQueue_Step steps[] = {
+        { FLASH_STEP_ERASE, TEST_PAGE, NULL, 2U },
+        { FLASH_STEP_PROGRAM, TEST_PAGE + 16U, data, TEST_BYTES },
+    };
+    FlashQueue_Job job = { .steps = steps, .step_count = 2, .callback = Test_Callback };
+    uint32_t i;
+
+    Test_Setup();
+    for (i = 0; i < TEST_BYTES; i++) {
+        data[i] = (uint8_t)(i * 11U + 3U);
+    }
+    CHECK(FlashQueue_Submit(&job));
+    CHECK_EQ(job.status, FLASH_STATUS_BUSY);
+    CHECK(Sim_Read(NVIC_BASE, 0x0) & (1U << 3));
+
+    // Two erases and one interrupt per half-word
+    CHECK_EQ(Test_Pump(), 2U + (TEST_BYTES + 1U) / 2U);
+    CHECK_EQ(job.status, FLASH_STATUS_READY);
+    CHECK_EQ(test_done, 1U);
+
+    CHECK(memcmp(flash + 16U, data, TEST_BYTES) == 0);
+    CHECK_EQ(flash[16U + TEST_BYTES], 0xFFU);
+    for (i = 0; i < 2U * TEST_PAGE_SIZE; i++) {
+        if (i < 16U || i > 16U + TEST_BYTES) {
+            if (flash[i] != 0xFFU) {
+                break;
+            }
+        }
+    }
+    CHECK_EQ(i, 2U * TEST_PAGE_SIZE);
+
+    // Drained: locked, interrupts and operations off, no flag left over
+    uint32_t cr = Sim_Read(FLASH_BASE, 0x10);
+    CHECK(cr & FLASH_CR_LOCK);
+    CHECK_EQ(cr & (FLASH_CR_PG | FLASH_CR_PER | FLASH_CR_EOPIE | FLASH_CR_ERRIE), 0U);
+    CHECK_EQ(Sim_Read(FLASH_BASE, 0x0C) & (FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR), 0U);
+}
+
+// Jobs run in submission order; a callback may submit more
+static void Test_Order(void) {
+    static const uint8_t data[4] = { 1, 2, 3, 4 };
+    FlashQueue_Step erase = { FLASH_STEP_ERASE, TEST_PAGE, NULL, 1U };
+    FlashQueue_Step program[3] = {
+        { FLASH_STEP_PROGRAM, TEST_PAGE + 0U, data, 4U },
+        { FLASH_STEP_PROGRAM, TEST_PAGE + 8U, data, 4U },
+        { FLASH_STEP_PROGRAM, TEST_PAGE + 16U, data, 4U },
+    };
+    FlashQueue_Job jobs[4] = {
+        { .steps = &erase, .step_count = 1, .callback = Test_Callback, .context = (void *)1 },
+        { .steps = &program[0], .step_count = 1, .callback = Test_ChainCallback, .context = (void *)2 },
+        { .steps = &program[1], .step_count = 1, .callback = Test_Callback, .context = (void *)3 },
+        { .steps = &program[1], .step_count = 1, .callback = Test_Callback, .context = (void *)9 },
+    };
+    FlashQueue_Job invalid = jobs[2];
+    FlashQueue_Step odd = program[2];
+
+    Test_Setup();
+    test_chained = (FlashQueue_Job){ .steps = &program[2], .step_count = 1,
+                                     .callback = Test_Callback, .context = (void *)4 };
+
+    odd.address++;
+    invalid.steps = &odd;
+    CHECK(!FlashQueue_Submit(&invalid));
+
+    for (uint32_t i = 0; i < FLASH_QUEUE_DEPTH - 1U; i++) {
+        CHECK(FlashQueue_Submit(&jobs[i]));
+    }
+    CHECK(FlashQueue_Submit(&jobs[3]));             // Fills the queue
+    CHECK(!FlashQueue_Submit(&test_chained));       // One too many
+
+    Test_Pump();
+    CHECK_EQ(test_done, 5U);
+    CHECK_EQ(test_order[0], 1U);
+    CHECK_EQ(test_order[1], 2U);
+    CHECK_EQ(test_order[2], 3U);
+    CHECK_EQ(test_order[3], 9U);                    // Same place twice: fails
+    CHECK_EQ(test_order[4], 4U);
+    CHECK_EQ(jobs[0].status, FLASH_STATUS_READY);
+    CHECK_EQ(jobs[1].status, FLASH_STATUS_READY);
+    CHECK_EQ(jobs[2].status, FLASH_STATUS_READY);
+    CHECK_EQ(jobs[3].status, FLASH_STATUS_PROGRAM_ERROR);
+    CHECK_EQ(jobs[3].fail_address, TEST_PAGE + 8U);
+    CHECK_EQ(test_chained.status, FLASH_STATUS_READY);
+    CHECK(memcmp((const void *)(uintptr_t)(TEST_PAGE + 16U), data, 4U) == 0);
+}
+
+// Programming over data that was never erased, and erasing outside flash
+static void Test_Errors(void) {
+    static const uint8_t data[2] = { 0x12, 0x34 };
+    FlashQueue_Step program = { FLASH_STEP_PROGRAM, TEST_PAGE, data, 2U };
+    FlashQueue_Step erase = { FLASH_STEP_ERASE, 0x08010000UL, NULL, 1U };
+    FlashQueue_Job pgerr = { .steps = &program, .step_count = 1, .callback = Test_Callback };
+    FlashQueue_Job wrprt = { .steps = &erase, .step_count = 1, .callback = Test_Callback };
+
+    Test_Setup();
+    CHECK(FlashQueue_Submit(&pgerr));
+    CHECK(FlashQueue_Submit(&wrprt));
+    Test_Pump();
+    CHECK_EQ(pgerr.status, FLASH_STATUS_PROGRAM_ERROR);
+    CHECK_EQ(pgerr.fail_address, TEST_PAGE);
+    CHECK_EQ(*(const volatile uint16_t *)(uintptr_t)TEST_PAGE, 0x5A5AU);
+    CHECK_EQ(wrprt.status, FLASH_STATUS_WRITE_PROTECT_ERROR);
+    CHECK_EQ(wrprt.fail_address, 0x08010000UL);
+    CHECK_EQ(test_done, 2U);
+    CHECK(Sim_Read(FLASH_BASE, 0x10) & FLASH_CR_LOCK);
+}
+
+int main(void) {
+    if (!Sim_FlashStoresApplied()) {
+        printf("test_flash_queue: skipped, no flash memory model on this host\n");
+        return 0;
+    }
+    Test_EraseAndProgram();
+    Test_Order();
+    Test_Errors();
+    return Test_Done("test_flash_queue");
+}
@@ -0,0 +1,157 @@
+#include "sim_test.h"
+#include "rcc.h"
+#include "clock_governor.h"
+
+// Clock governor in Clock_Config/Src/clock_governor.c against the RCC model.
+//
+// An observer checks at every register access of a transition that the
+// flash latency covers the SYSCLK SWS reports (wait states up before the
+// switch, down after it). A listener checks that PRE_CHANGE and POST_CHANGE
+// come in pairs, including when the PLL does not lock.
+
+#define RCC_CR_HSIRDY       (1U << 1)
+#define RCC_CR_PLLRDY       (1U << 25)
+#define SYST_CSR_ENABLE     (1U << 0)
+#define SYST_CSR_CLKSOURCE  (1U << 2)
+
+static uint32_t test_latency_faults;
+static uint32_t test_pre_events;
+static uint32_t test_post_events;
+static uint32_t test_pairing_faults;
+static uint32_t test_pre_hclk;
+
+// Observer: SYSCLK from SWS (HSI/2 PLL input only) against FLASH_ACR
+static void Test_CheckLatency(void) {
+    uint32_t cfgr = Sim_Read(RCC_BASE, 0x04);
+    uint32_t sysclk = RCC_HSI_FREQUENCY;
+
+    if (((cfgr >> 2) & 3U) == CLOCK_SOURCE_PLL) {
+        sysclk = (RCC_HSI_FREQUENCY / 2U) * (((cfgr >> 18) & 0xFU) + 2U);
+    }
+    if ((Sim_Read(FLASH_BASE, 0x0) & 0x7U) < RCC_GetFlashLatency(sysclk)) {
+        test_latency_faults++;
+    }
+}
+
+static void Test_Listener(RCC_ClockEvent event, uint32_t hclk_hz, uint32_t pclk_hz) {
+    (void)pclk_hz;
+    if (event == RCC_CLOCK_PRE_CHANGE) {
+        if (test_pre_events != test_post_events) {
+            test_pairing_faults++;
+        }
+        test_pre_events++;
+        test_pre_hclk = hclk_hz;
+    } else {
+        if (test_post_events + 1U != test_pre_events) {
+            test_pairing_faults++;
+        }
+        test_post_events++;
+    }
+}
+
+// Clock and flash latency left by the governor for an operating point
+static void Test_CheckOPP(Governor_OPP opp) {
+    uint32_t hz = Governor_GetOPPFrequency(opp);
+
+    CHECK_EQ(Governor_GetOPP(), opp);
+    CHECK_EQ(RCC_GetSystemClockFrequency(), hz);
+    CHECK_EQ(Sim_Read(FLASH_BASE, 0x0) & 0x7U, RCC_GetFlashLatency(hz));
+    CHECK_EQ((Sim_Read(RCC_BASE, 0x04) >> 2) & 3U,
+             (opp == GOVERNOR_OPP_8MHZ) ? CLOCK_SOURCE_HSI : CLOCK_SOURCE_PLL);
+    CHECK_EQ(test_pre_events, test_post_events);
+}
+
+// SysTick free-runs from Governor_Init unless something already started it
+static void Test_Init(void) {
+    Sim_Reset();
+    Governor_Init();
+    CHECK_EQ(Sim_Read(SYSTICK_BASE, 0x0), SYST_CSR_ENABLE | SYST_CSR_CLKSOURCE);
+    CHECK_EQ(Sim_Read(SYSTICK_BASE, 0x4), 0x00FFFFFFUL);
+    Test_CheckOPP(GOVERNOR_OPP_8MHZ);
+
+    Sim_Reset();
+    *(volatile uint32_t *)(SYSTICK_BASE + 0x4) = 1000U;
+    *(volatile uint32_t *)(SYSTICK_BASE + 0x0) = SYST_CSR_ENABLE;
+    Governor_Init();
+    CHECK_EQ(Sim_Read(SYSTICK_BASE, 0x0), SYST_CSR_ENABLE);
+    CHECK_EQ(Sim_Read(SYSTICK_BASE, 0x4), 1000U);
+}
+
+// Every pair of operating points, both directions
+static void Test_Transitions(void) {
+    Sim_Reset();
+    Governor_Init();
+    for (uint32_t from = 0; from < GOVERNOR_OPP_COUNT; from++) {
+        for (uint32_t to = 0; to < GOVERNOR_OPP_COUNT; to++) {
+            CHECK(Governor_SetOPP((Governor_OPP)from));
+            Test_CheckOPP((Governor_OPP)from);
+            CHECK(Governor_SetOPP((Governor_OPP)to));
+            Test_CheckOPP((Governor_OPP)to);
+        }
+    }
+    CHECK(!Governor_SetOPP(GOVERNOR_OPP_COUNT));
+}
+
+// A PLL that never locks leaves the clock at the 8 MHz point
+static void Test_NoLock(void) {
+    uint32_t pre_events;
+
+    Sim_Reset();
+    Governor_Init();
+    CHECK(Governor_SetOPP(GOVERNOR_OPP_24MHZ));
+    Sim_FailOscillator(RCC_CR_PLLRDY);
+    pre_events = test_pre_events;
+    CHECK(!Governor_SetOPP(GOVERNOR_OPP_48MHZ));
+    CHECK_EQ(test_pre_events, pre_events + 1U);
+    CHECK_EQ(test_pre_hclk, 24000000UL);
+    Test_CheckOPP(GOVERNOR_OPP_8MHZ);
+    CHECK_EQ(Sim_Read(RCC_BASE, 0x00) & (1U << 24), 0U);   // PLL off
+
+    // HSI missing: refused before any event
+    Sim_FailOscillator(RCC_CR_HSIRDY);
+    pre_events = test_pre_events;
+    CHECK(!Governor_SetOPP(GOVERNOR_OPP_32MHZ));
+    CHECK_EQ(test_pre_events, pre_events);
+    Sim_FailOscillator(0);
+}
+
+// The same operating point again is only a no-op while the clock is still
+// the governor's: after something else moved SYSCLK it is set up again
+static void Test_External(void) {
+    uint32_t pre_events;
+
+    Sim_Reset();
+    Governor_Init();
+    CHECK(Governor_SetOPP(GOVERNOR_OPP_48MHZ));
+    pre_events = test_pre_events;
+    CHECK(Governor_SetOPP(GOVERNOR_OPP_48MHZ));
+    CHECK_EQ(test_pre_events, pre_events);
+
+    // As the CSS fallback or another RCC_Init would leave it
+    CHECK(RCC_SetSystemClockSource(CLOCK_SOURCE_HSI));
+    CHECK(Governor_SetOPP(GOVERNOR_OPP_48MHZ));
+    CHECK_EQ(test_pre_events, pre_events + 1U);
+    Test_CheckOPP(GOVERNOR_OPP_48MHZ);
+
+    RCC_SetAHBPrescaler(AHB_PRESCALER_2);
+    CHECK(Governor_SetOPP(GOVERNOR_OPP_48MHZ));
+    CHECK_EQ(test_pre_events, pre_events + 2U);
+    CHECK_EQ(RCC_GetHCLKFrequency(), 48000000UL);
+}
+
+int main(void) {
+    Sim_Reset();
+    CHECK(RCC_RegisterClockListener(Test_Listener, 0));
+    Sim_SetObserver(Test_CheckLatency);
+
+    Test_Init();
+    Test_Transitions();
+    Test_NoLock();
+    Test_External();
+
+    Sim_SetObserver(NULL);
+    CHECK_EQ(test_latency_faults, 0U);
+    CHECK_EQ(test_pairing_faults, 0U);
+    CHECK(test_pre_events > 0U);
+    return Test_Done("test_governor");
+}
@@ -0,0 +1,96 @@
+#include "sim_test.h"
+#include "gpio.h"
+
+// ISR interleaving stress test for GPIO_WriteMasked/GPIO_ToggleMasked.
+//
+// The main loop drives PC0-PC7 while a simulated ISR drives PC8-PC15 of the
+// same port. The ISR is injected just before one of the main loop's GPIO
+// stores (Sim_SetPreemption), with the period varied so every store gets
+// hit. Neither side may ever lose the other's pins.
+
+#define MAIN_PINS           0x00FFU
+#define ISR_PINS            0xFF00U
+#define ITERATIONS          2000U
+
+static uint16_t isr_value;              // What the ISR last drove on ISR_PINS
+static uint32_t isr_calls;
+
+static void Test_Isr(void) {
+    isr_value = (uint16_t)((isr_value + 0x0100U) & ISR_PINS);
+    GPIO_WriteMasked(GPIOC, ISR_PINS, isr_value);
+    isr_calls++;
+}
+
+static void Test_Setup(void) {
+    GPIO_Config config = {
+        .mode = GPIO_MODE_OUTPUT,
+        .output_type = GPIO_OUTPUT_PUSH_PULL,
+        .speed = GPIO_SPEED_HIGH,
+        .pull = GPIO_NO_PULL,
+        .alternate = GPIO_AF0
+    };
+
+    Sim_Reset();
+    GPIO_InitMask(GPIOC, GPIO_PIN_MASK_ALL, &config);
+    isr_value = 0;
+    isr_calls = 0;
+}
+
+// Count iterations where the port does not hold both sides' latest values
+static uint32_t Test_Run(void (*main_op)(uint32_t i, uint16_t *main_value), uint32_t period) {
+    uint16_t main_value = 0;
+    uint32_t errors = 0;
+
+    Test_Setup();
+    Sim_SetPreemption(Test_Isr, period);
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        main_op(i, &main_value);
+        if ((GPIOC->ODR & 0xFFFFU) != (uint32_t)(isr_value | main_value)) {
+            errors++;
+        }
+    }
+    Sim_SetPreemption(NULL, 0);
+    return errors;
+}
+
+static void Op_WriteMasked(uint32_t i, uint16_t *main_value) {
+    *main_value = (uint16_t)((i * 37U) & MAIN_PINS);
+    GPIO_WriteMasked(GPIOC, MAIN_PINS, *main_value);
+}
+
+static void Op_ToggleMasked(uint32_t i, uint16_t *main_value) {
+    uint16_t mask = (uint16_t)(((i * 13U) | 1U) & MAIN_PINS);
+
+    *main_value ^= mask;
+    GPIO_ToggleMasked(GPIOC, mask);
+}
+
+// The read-modify-write the driver replaced, to show the test reaches the race
+static void Op_OdrXor(uint32_t i, uint16_t *main_value) {
+    uint16_t mask = (uint16_t)(((i * 13U) | 1U) & MAIN_PINS);
+
+    *main_value ^= mask;
+    GPIOC->ODR ^= mask;
+}
+
+int main(void) {
+    static const uint32_t periods[] = { 1, 2, 3, 5, 7 };
+
+    if (!Sim_GpioStoresApplied()) {
+        printf("test_gpio_interleave: skipped (needs per-store GPIO model)\n");
+        return 0;
+    }
+
+    for (uint32_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+        CHECK_EQ(Test_Run(Op_WriteMasked, periods[p]), 0);
+        CHECK(isr_calls > 0);
+        CHECK_EQ(Test_Run(Op_ToggleMasked, periods[p]), 0);
+        CHECK(isr_calls > 0);
+    }
+
+    // ODR ^= mask loses the ISR's pins whenever the ISR lands between its
+    // load and store
+    CHECK(Test_Run(Op_OdrXor, 1) > 0);
+
+    return Test_Done("test_gpio_interleave");
+}
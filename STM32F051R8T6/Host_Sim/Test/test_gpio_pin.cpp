@@ -0,0 +1,86 @@
+#include "gpio_pin.hpp"
+
+extern "C" {
+#include "sim_test.h"
+}
+
+// gpio::Pin against the simulated GPIO ports and RCC.
+//
+// Drives and reads pins through the template layer, and checks that init()
+// and deinit() go through the C driver's pin accounting: the port clock
+// stays on while either a C or a C++ user holds one of its pins.
+
+using Led = gpio::Pin<gpio::PortC, 9>;
+using Other = gpio::Pin<gpio::PortC, 8>;
+using Button = gpio::Pin<gpio::PortB, 3>;
+
+static const uint32_t test_gpioc_clock = 1U << 19;     // RCC_AHBENR GPIOCEN
+
+static const GPIO_Config test_output = {
+    GPIO_MODE_OUTPUT, GPIO_OUTPUT_PUSH_PULL, GPIO_SPEED_HIGH, GPIO_NO_PULL, GPIO_AF0
+};
+static const GPIO_Config test_input = {
+    GPIO_MODE_INPUT, GPIO_OUTPUT_PUSH_PULL, GPIO_SPEED_LOW, GPIO_NO_PULL, GPIO_AF0
+};
+
+static uint32_t Test_Odr(void) {
+    return Sim_Read(GPIOC_BASE, 0x14) & 0xFFFFU;
+}
+
+static void Test_Drive(void) {
+    Sim_Reset();
+    Led::init(test_output);
+    Other::init(test_output);
+    CHECK_EQ((Sim_Read(GPIOC_BASE, 0x00) >> 16) & 0xFU, 0x5U);
+
+    Led::set();
+    CHECK_EQ(Test_Odr(), 0x0200U);
+    Other::write(true);
+    CHECK_EQ(Test_Odr(), 0x0300U);
+    Led::reset();
+    CHECK_EQ(Test_Odr(), 0x0100U);
+    Led::toggle();
+    Other::toggle();
+    CHECK_EQ(Test_Odr(), 0x0200U);
+    Led::write(false);
+    CHECK_EQ(Test_Odr(), 0x0000U);
+
+    Button::init(test_input);
+    Sim_SetInput(1, 1U << 3);
+    CHECK(Button::read());
+    Sim_SetInput(1, 0);
+    CHECK(!Button::read());
+
+    Led::deinit();
+    Other::deinit();
+    Button::deinit();
+}
+
+// C and C++ users share the port clock accounting
+static void Test_Clock(void) {
+    Sim_Reset();
+    CHECK_EQ(Sim_Read(RCC_BASE, 0x14) & test_gpioc_clock, 0U);
+
+    Led::init(test_output);
+    CHECK(Led::in_use());
+    CHECK(Sim_Read(RCC_BASE, 0x14) & test_gpioc_clock);
+    GPIO_InitMask(GPIOC, GPIO_PIN_MASK(GPIO_PIN_0), &test_output);
+
+    Led::deinit();
+    CHECK(!Led::in_use());
+    CHECK(Sim_Read(RCC_BASE, 0x14) & test_gpioc_clock);       // PC0 still held
+    CHECK_EQ((Sim_Read(GPIOC_BASE, 0x00) >> 18) & 0x3U, 0U);  // PC9 back to input
+
+    GPIO_DeInitMask(GPIOC, GPIO_PIN_MASK(GPIO_PIN_0));
+    CHECK_EQ(Sim_Read(RCC_BASE, 0x14) & test_gpioc_clock, 0U);
+}
+
+int main(void) {
+    if (!Sim_GpioStoresApplied()) {
+        printf("test_gpio_pin: skipped, GPIO stores are not modelled on this host\n");
+        return 0;
+    }
+    Test_Drive();
+    Test_Clock();
+    return Test_Done("test_gpio_pin");
+}
@@ -0,0 +1,120 @@
+#include <string.h>
+#include "sim_test.h"
+#include "sim_regs.h"
+#include "image_crc.h"
+
+// Image integrity check against the simulated CRC unit, DMA1 and flash.
+//
+// The test links g_pfnVectors at the start of flash and _simage_crc at the
+// end of the FLASH region, as the linker script does (see the Makefile),
+// then loads an image and its record with Sim_LoadFlash(). The CRC is
+// checked against a bytewise reference, computed independently of the
+// word-at-a-time model.
+
+#define IMAGE_START         0x08000000UL
+#define IMAGE_LENGTH        (12U * 1024U + 512U)    // Not a whole number of chunks
+#define RECORD_ADDRESS      0x0800EBF8UL            // _simage_crc
+#define FULL_FLASH          (64U * 1024U)
+
+static uint8_t image[IMAGE_LENGTH];
+
+// CRC-32/MPEG-2 over the bytes of each little-endian word, high byte first:
+// what the CRC unit computes when fed whole words
+static uint32_t Test_ReferenceCrc(const uint8_t *data, uint32_t length) {
+    uint32_t crc = 0xFFFFFFFFUL;
+
+    for (uint32_t word = 0; word < length; word += 4U) {
+        for (int byte = 3; byte >= 0; byte--) {
+            crc ^= (uint32_t)data[word + (uint32_t)byte] << 24;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x80000000UL) ? (crc << 1) ^ 0x04C11DB7UL : (crc << 1);
+            }
+        }
+    }
+    return crc;
+}
+
+static void Test_SetRecord(uint32_t length, uint32_t crc) {
+    uint32_t record[2] = { length, crc };
+
+    Sim_LoadFlash(RECORD_ADDRESS, record, sizeof(record));
+}
+
+static void Test_LoadImage(void) {
+    uint32_t seed = 12345U;
+
+    for (uint32_t i = 0; i < IMAGE_LENGTH; i++) {
+        seed = seed * 1103515245U + 12345U;
+        image[i] = (uint8_t)(seed >> 16);
+    }
+    Sim_EraseFlash();
+    Sim_Reset();
+    Sim_LoadFlash(IMAGE_START, image, IMAGE_LENGTH);
+    Test_SetRecord(IMAGE_LENGTH, Test_ReferenceCrc(image, IMAGE_LENGTH));
+}
+
+// Step the background check until a pass ends; counts the calls
+static ImageCRC_Status Test_BackgroundPass(uint32_t *calls, int interfere) {
+    ImageCRC_Status status;
+
+    *calls = 0;
+    do {
+        status = ImageCRC_BackgroundStep();
+        (*calls)++;
+        if (interfere && (*calls & 1U)) {
+            // Another CRC user between steps. Every other time it lands on a
+            // chunk in flight, which is dropped and redone.
+            ImageCRC_Compute(IMAGE_START, 64U);
+        }
+    } while (status == IMAGE_CRC_BUSY && *calls < 1000U);
+    return status;
+}
+
+int main(void) {
+    uint8_t corrupt;
+    uint32_t calls;
+    uint32_t passes;
+
+    if (!Sim_FlashStoresApplied()) {
+        printf("test_image_crc: skipped, no flash memory model on this host\n");
+        return 0;
+    }
+
+    // Blocking checks
+    Test_LoadImage();
+    CHECK_EQ(ImageCRC_Compute(IMAGE_START, IMAGE_LENGTH), Test_ReferenceCrc(image, IMAGE_LENGTH));
+    CHECK_EQ(ImageCRC_Compute(IMAGE_START, 4U), Test_ReferenceCrc(image, 4U));
+    CHECK_EQ(ImageCRC_Verify(), IMAGE_CRC_OK);
+
+    Test_SetRecord(IMAGE_LENGTH, IMAGE_CRC_UNSET);
+    CHECK_EQ(ImageCRC_Verify(), IMAGE_CRC_NOT_SET);
+    CHECK_EQ(ImageCRC_BackgroundStep(), IMAGE_CRC_NOT_SET);
+
+    Test_SetRecord(IMAGE_LENGTH, Test_ReferenceCrc(image, IMAGE_LENGTH));
+    corrupt = image[IMAGE_LENGTH - 1U] ^ 0x01U;
+    Sim_LoadFlash(IMAGE_START + IMAGE_LENGTH - 1U, &corrupt, 1U);
+    CHECK_EQ(ImageCRC_Verify(), IMAGE_CRC_MISMATCH);
+    Sim_LoadFlash(IMAGE_START + IMAGE_LENGTH - 1U, &image[IMAGE_LENGTH - 1U], 1U);
+    CHECK_EQ(ImageCRC_Verify(), IMAGE_CRC_OK);
+
+    // Background passes: one call per chunk to start it, one more to finish
+    passes = ImageCRC_GetPassCount();
+    CHECK_EQ(Test_BackgroundPass(&calls, 0), IMAGE_CRC_OK);
+    CHECK_EQ(calls, (IMAGE_LENGTH + IMAGE_CRC_CHUNK - 1U) / IMAGE_CRC_CHUNK + 1U);
+    CHECK_EQ(ImageCRC_GetPassCount(), passes + 1U);
+
+    CHECK_EQ(Test_BackgroundPass(&calls, 1), IMAGE_CRC_OK);
+    CHECK_EQ(ImageCRC_GetPassCount(), passes + 2U);
+
+    corrupt = image[IMAGE_CRC_CHUNK + 5U] ^ 0x80U;
+    Sim_LoadFlash(IMAGE_START + IMAGE_CRC_CHUNK + 5U, &corrupt, 1U);
+    CHECK_EQ(Test_BackgroundPass(&calls, 0), IMAGE_CRC_MISMATCH);
+    Sim_LoadFlash(IMAGE_START + IMAGE_CRC_CHUNK + 5U, &image[IMAGE_CRC_CHUNK + 5U], 1U);
+    CHECK_EQ(Test_BackgroundPass(&calls, 0), IMAGE_CRC_OK);
+
+    // The whole 64 KB, as ImageCRC_TimeFullFlash() runs it
+    CHECK_EQ(ImageCRC_Compute(IMAGE_START, FULL_FLASH),
+             Test_ReferenceCrc((const uint8_t *)(uintptr_t)IMAGE_START, FULL_FLASH));
+
+    return Test_Done("test_image_crc");
+}
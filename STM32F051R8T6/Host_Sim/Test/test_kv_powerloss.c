@@ -0,0 +1,192 @@
+#define _GNU_SOURCE
+#include <setjmp.h>
+#include <string.h>
+#include "sim_test.h"
+#include "sim_regs.h"
+#include "kv_store.h"
+
+// Power-loss test for the key-value store.
+//
+// A few writes around the first compaction are replayed from the same flash
+// image, with the power cut during each of their flash operations in turn
+// (Sim_SetPowerCut), then again during the recovery that follows. After
+// every cut KV_Init() must mount the store, the key being written must hold
+// either its previous or its new value, and the other keys must be intact.
+
+#define VALUE_KEY           0U          // Key updated by the scenario
+#define FIXED_KEYS          3U          // Keys 1..3, written once
+#define VALUE_SIZE          60U
+#define FIXED_SIZE          16U
+#define SCENARIO_WRITES     5U          // Around the compacting write
+
+static sigjmp_buf cut_env;
+static uint8_t image[64U * 1024U];      // Flash before the scenario
+static uint32_t scenario_first;         // Value index of its first write
+
+static void Test_OnCut(void) {
+    siglongjmp(cut_env, 1);
+}
+
+static void Test_Value(uint32_t index, uint8_t *value) {
+    for (uint32_t i = 0; i < VALUE_SIZE; i++) {
+        value[i] = (uint8_t)(index * 7U + i);
+    }
+}
+
+static void Test_Fixed(uint16_t key, uint8_t *value) {
+    memset(value, 0xA0 + key, FIXED_SIZE);
+}
+
+// Fresh store with the fixed keys and `count` updates of VALUE_KEY
+static void Test_Fill(uint32_t count) {
+    uint8_t value[VALUE_SIZE];
+
+    Sim_EraseFlash();
+    Sim_Reset();
+    KV_Init();
+    for (uint16_t key = 1; key <= FIXED_KEYS; key++) {
+        Test_Fixed(key, value);
+        KV_Write(key, value, FIXED_SIZE);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        Test_Value(i, value);
+        KV_Write(VALUE_KEY, value, VALUE_SIZE);
+    }
+}
+
+// Updates before the first compaction, found by writing until one happens
+static uint32_t Test_FindCompaction(void) {
+    uint8_t value[VALUE_SIZE];
+    KV_Stats stats;
+    uint32_t i;
+
+    Test_Fill(0);
+    KV_GetStats(&stats);
+    uint32_t before = stats.compactions;
+    for (i = 0; i < 200U; i++) {
+        Test_Value(i, value);
+        KV_Write(VALUE_KEY, value, VALUE_SIZE);
+        KV_GetStats(&stats);
+        if (stats.compactions != before) {
+            break;
+        }
+    }
+    return i;
+}
+
+// Boot from the saved image and run the scenario writes. Returns the number
+// that completed; stops early if the power is cut.
+static uint32_t Test_Scenario(uint32_t cut_at) {
+    static uint8_t value[VALUE_SIZE];
+    static volatile uint32_t done;
+
+    done = 0;
+    Sim_Reset();
+    Sim_LoadFlash(0x08000000UL, image, sizeof(image));
+    CHECK_EQ(KV_Init(), KV_OK);
+    if (sigsetjmp(cut_env, 1) == 0) {
+        Sim_SetPowerCut(cut_at, Test_OnCut);
+        for (uint32_t i = 0; i < SCENARIO_WRITES; i++) {
+            Test_Value(scenario_first + i, value);
+            if (KV_Write(VALUE_KEY, value, VALUE_SIZE) == KV_OK) {
+                done++;
+            }
+        }
+    }
+    Sim_SetPowerCut(0, NULL);
+    return done;
+}
+
+// After the reboot: the in-flight write is all or nothing, nothing else moved
+static void Test_CheckStore(uint32_t done) {
+    uint8_t expected[VALUE_SIZE];
+    uint8_t value[VALUE_SIZE];
+    uint16_t length = 0;
+
+    CHECK_EQ(KV_Read(VALUE_KEY, value, sizeof(value), &length), KV_OK);
+    CHECK_EQ(length, VALUE_SIZE);
+    Test_Value(scenario_first + done - 1U, expected);
+    if (memcmp(value, expected, VALUE_SIZE) != 0) {
+        Test_Value(scenario_first + done, expected);
+        CHECK(memcmp(value, expected, VALUE_SIZE) == 0);
+    }
+    for (uint16_t key = 1; key <= FIXED_KEYS; key++) {
+        Test_Fixed(key, expected);
+        CHECK_EQ(KV_Read(key, value, sizeof(value), &length), KV_OK);
+        CHECK(length == FIXED_SIZE && memcmp(value, expected, FIXED_SIZE) == 0);
+    }
+}
+
+// The recovered store takes new writes
+static void Test_CheckWritable(void) {
+    uint8_t expected[VALUE_SIZE];
+    uint8_t value[VALUE_SIZE];
+
+    Test_Value(1000U, expected);
+    CHECK_EQ(KV_Write(VALUE_KEY, expected, VALUE_SIZE), KV_OK);
+    CHECK_EQ(KV_Read(VALUE_KEY, value, sizeof(value), NULL), KV_OK);
+    CHECK(memcmp(value, expected, VALUE_SIZE) == 0);
+}
+
+int main(void) {
+    if (!Sim_FlashStoresApplied()) {
+        printf("test_kv_powerloss: skipped, no flash memory model on this host\n");
+        return 0;
+    }
+
+    // Save the image a few writes before the first compaction
+    uint32_t compaction = Test_FindCompaction();
+    CHECK(compaction > 2U && compaction < 200U);
+    scenario_first = compaction - 2U;
+    Test_Fill(scenario_first);
+    memcpy(image, (const void *)(uintptr_t)0x08000000UL, sizeof(image));
+
+    // Uncut run: every write lands and one of them compacts
+    KV_Stats stats;
+    KV_GetStats(&stats);
+    uint32_t compactions = stats.compactions;
+    uint32_t start = Sim_FlashOperations();
+    CHECK_EQ(Test_Scenario(0), SCENARIO_WRITES);
+    uint32_t operations = Sim_FlashOperations() - start;
+    KV_GetStats(&stats);
+    CHECK_EQ(stats.compactions - compactions, 1U);
+
+    uint32_t cuts = 0;
+    for (uint32_t cut = 1; cut <= operations; cut++) {
+        uint32_t done = Test_Scenario(cut);
+
+        CHECK(done < SCENARIO_WRITES);
+
+        // Cut the recovery too: each reboot gets one operation further than
+        // the last, until one completes
+        for (volatile uint32_t again = 1; ; again++) {
+            volatile int recovered = 1;
+
+            Sim_Reset();
+            if (sigsetjmp(cut_env, 1) == 0) {
+                Sim_SetPowerCut(again, Test_OnCut);
+                CHECK_EQ(KV_Init(), KV_OK);
+            } else {
+                recovered = 0;
+            }
+            Sim_SetPowerCut(0, NULL);
+            if (recovered) {
+                break;
+            }
+            cuts++;
+        }
+
+        Sim_Reset();
+        CHECK_EQ(KV_Init(), KV_OK);
+        Test_CheckStore(done);
+
+        // A second clean mount sees the same store
+        Sim_Reset();
+        CHECK_EQ(KV_Init(), KV_OK);
+        Test_CheckStore(done);
+        Test_CheckWritable();
+        cuts++;
+    }
+    printf("test_kv_powerloss: %u flash operations, %u power cuts\n", operations, cuts);
+    return Test_Done("test_kv_powerloss");
+}
@@ -0,0 +1,130 @@
+#include "sim_test.h"
+#include "parallel_bus.h"
+
+// Parallel bus against the simulated GPIO ports.
+//
+// Every 8-bit value goes out through PBus_WriteBlock and comes back through
+// PBus_ReadBlock (from Sim_SetInput levels), on a contiguous and on a
+// scattered layout. Also checks that PBus_Init refuses strobes on data pins
+// or on each other, and the strobe and direction state left behind.
+
+#define SIM_PORT_B          1U
+
+// Data on PB0-PB7, WR PB8, RD PB9, CS PC0 (the sim ports are not constants)
+static PBus_Config Test_Contiguous(void) {
+    PBus_Config config = {
+        .data_port = GPIOB,
+        .data_pins = { 0, 1, 2, 3, 4, 5, 6, 7 },
+        .width = 8,
+        .wr = { GPIOB, 8 },
+        .rd = { GPIOB, 9 },
+        .cs = { GPIOC, 0 },
+        .read_access_ns = 100U
+    };
+
+    return config;
+}
+
+// Value bit i on the port pins of config
+static uint16_t Test_Pins(const PBus_Config *config, uint32_t value) {
+    uint16_t pins = 0;
+
+    for (uint32_t bit = 0; bit < config->width; bit++) {
+        if (value & (1U << bit)) {
+            pins |= (uint16_t)(1U << config->data_pins[bit]);
+        }
+    }
+    return pins;
+}
+
+static void Test_RoundTrip(const PBus_Config *config) {
+    PBus bus;
+    uint32_t write_errors = 0;
+    uint32_t read_errors = 0;
+    uint32_t moder_fields = 0;
+
+    Sim_Reset();
+    CHECK(PBus_Init(&bus, config));
+    for (uint32_t value = 0; value < 256U; value++) {
+        uint8_t byte = (uint8_t)value;
+
+        PBus_WriteBlock(&bus, &byte, 1);
+        if ((Sim_Read(GPIOB_BASE, 0x14) & 0xFFFFU) != (Test_Pins(config, value) | (1U << 8) | (1U << 9))) {
+            write_errors++;
+        }
+    }
+    CHECK_EQ(write_errors, 0U);
+
+    for (uint32_t value = 0; value < 256U; value++) {
+        uint8_t byte = 0;
+
+        Sim_SetInput(SIM_PORT_B, Test_Pins(config, value));
+        PBus_ReadBlock(&bus, &byte, 1);
+        if (byte != value) {
+            read_errors++;
+        }
+    }
+    CHECK_EQ(read_errors, 0U);
+
+    // Data pins left as inputs, strobes released
+    for (uint32_t bit = 0; bit < config->width; bit++) {
+        moder_fields |= 3U << (2U * config->data_pins[bit]);
+    }
+    CHECK_EQ(Sim_Read(GPIOB_BASE, 0x00) & moder_fields, 0U);
+    CHECK_EQ(Sim_Read(GPIOB_BASE, 0x14) & ((1U << 8) | (1U << 9)), (1U << 8) | (1U << 9));
+}
+
+static void Test_Overlap(void) {
+    PBus bus;
+    PBus_Config config = Test_Contiguous();
+
+    Sim_Reset();
+    config.wr.pin = 3;                      // WR on a data pin
+    CHECK(!PBus_Init(&bus, &config));
+
+    config = Test_Contiguous();
+    config.rd.pin = 8;                      // RD on WR
+    CHECK(!PBus_Init(&bus, &config));
+
+    config = Test_Contiguous();
+    config.cs = (PBus_Pin){ GPIOB, 9 };     // CS on RD
+    CHECK(!PBus_Init(&bus, &config));
+
+    config = Test_Contiguous();
+    config.cs = (PBus_Pin){ GPIOC, 3 };     // Same pin number, other port
+    config.rd = (PBus_Pin){ GPIOC, 3 };
+    CHECK(!PBus_Init(&bus, &config));
+    config.rd = (PBus_Pin){ GPIOA, 3 };
+    CHECK(PBus_Init(&bus, &config));
+
+    config = Test_Contiguous();
+    config.rd = (PBus_Pin){ NULL, PBUS_NO_PIN };
+    config.cs = (PBus_Pin){ NULL, PBUS_NO_PIN };
+    CHECK(PBus_Init(&bus, &config));
+
+    // Nothing was configured by the refused attempts: PB3 still an input
+    Sim_Reset();
+    config = Test_Contiguous();
+    config.wr.pin = 3;
+    CHECK(!PBus_Init(&bus, &config));
+    CHECK_EQ(Sim_Read(GPIOB_BASE, 0x00), 0U);
+}
+
+int main(void) {
+    static const uint8_t scattered_pins[8] = { 7, 6, 5, 4, 10, 12, 13, 15 };
+    PBus_Config contiguous = Test_Contiguous();
+    PBus_Config scattered = contiguous;
+
+    if (!Sim_GpioStoresApplied()) {
+        printf("test_parallel_bus: skipped, GPIO stores are not modelled on this host\n");
+        return 0;
+    }
+
+    for (uint32_t bit = 0; bit < 8U; bit++) {
+        scattered.data_pins[bit] = scattered_pins[bit];
+    }
+    Test_RoundTrip(&contiguous);
+    Test_RoundTrip(&scattered);
+    Test_Overlap();
+    return Test_Done("test_parallel_bus");
+}
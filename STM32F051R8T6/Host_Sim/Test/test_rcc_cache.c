@@ -0,0 +1,258 @@
+#include "sim_test.h"
+#include "rcc.h"
+
+// Clock cache in Clock_Config/Src/rcc.c: after every transition the cached
+// SYSCLK/HCLK/PCLK must match what the RCC registers decode to.
+
+#define RCC_CR_HSERDY       (1U << 17)
+#define RCC_CR_HSEON        (1U << 16)
+#define RCC_CR_PLLON        (1U << 24)
+#define RCC_CR_PLLRDY       (1U << 25)
+#define RCC_CIR_CSSF        (1U << 7)
+
+void NMI_Handler(void);
+
+static uint32_t test_hse_hz;
+
+// Independent decode of RCC_CFGR/RCC_CFGR2 (STM32F051: PLLSRC[1] only)
+static void Test_Decode(uint32_t *sysclk, uint32_t *hclk, uint32_t *pclk) {
+    static const uint8_t ahb_div_log2[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 6, 7, 8, 9 };
+    static const uint8_t apb_div_log2[8] = { 0, 0, 0, 0, 1, 2, 3, 4 };
+    uint32_t cfgr = RCC_CFGR;
+
+    switch ((cfgr >> 2) & 3U) {
+        case 1:
+            *sysclk = test_hse_hz;
+            break;
+        case 2: {
+            uint32_t input = (cfgr & (1U << 16)) ? test_hse_hz / ((RCC_CFGR2 & 0xFU) + 1U)
+                                                 : RCC_HSI_FREQUENCY / 2U;
+            uint32_t multiplier = ((cfgr >> 18) & 0xFU) + 2U;
+
+            *sysclk = input * (multiplier > 16U ? 16U : multiplier);
+            break;
+        }
+        default:
+            *sysclk = RCC_HSI_FREQUENCY;
+            break;
+    }
+    *hclk = *sysclk >> ahb_div_log2[(cfgr >> 4) & 0xFU];
+    *pclk = *hclk >> apb_div_log2[(cfgr >> 8) & 0x7U];
+}
+
+// Cache matches the registers
+#define CHECK_CACHE()   Test_CheckCache(__LINE__)
+
+static void Test_CheckCache(int line) {
+    uint32_t sysclk, hclk, pclk;
+
+    Test_Decode(&sysclk, &hclk, &pclk);
+    test_checks++;
+    if (RCC_GetSystemClockFrequency() != sysclk || RCC_GetHCLKFrequency() != hclk ||
+        RCC_GetPCLKFrequency() != pclk) {
+        test_failures++;
+        printf("%s:%d: cache %lu/%lu/%lu, registers %lu/%lu/%lu\n", __FILE__, line,
+               (unsigned long)RCC_GetSystemClockFrequency(), (unsigned long)RCC_GetHCLKFrequency(),
+               (unsigned long)RCC_GetPCLKFrequency(), (unsigned long)sysclk, (unsigned long)hclk,
+               (unsigned long)pclk);
+    }
+}
+
+static void Test_SetHSE(uint32_t hse_hz) {
+    test_hse_hz = hse_hz;
+    RCC_SetHSEFrequency(hse_hz);
+    CHECK_CACHE();
+}
+
+// Every solvable tree through RCC_Init, then the prescaler setters
+static void Test_InitAndPrescalers(void) {
+    static const uint32_t hse_list[] = { 8000000UL, 12000000UL, 16000000UL, 25000000UL };
+    static const uint32_t sysclk_list[] = {
+        8000000UL, 12000000UL, 16000000UL, 24000000UL, 25000000UL, 36000000UL, 42000000UL, 45000000UL, 48000000UL
+    };
+    static const uint16_t ahb_div[] = { 1, 2, 4, 8, 16, 64, 128, 256, 512 };
+    static const uint8_t apb_div[] = { 1, 2, 4, 8, 16 };
+    uint32_t solved = 0;
+
+    for (uint32_t h = 0; h < sizeof(hse_list) / sizeof(hse_list[0]); h++) {
+        Test_SetHSE(hse_list[h]);
+        for (uint32_t s = 0; s < sizeof(sysclk_list) / sizeof(sysclk_list[0]); s++) {
+            for (uint32_t a = 0; a < sizeof(ahb_div) / sizeof(ahb_div[0]); a++) {
+                for (uint32_t p = 0; p < sizeof(apb_div) / sizeof(apb_div[0]); p++) {
+                    uint32_t sysclk = sysclk_list[s];
+                    RCC_ClockRequest request = {
+                        sysclk, sysclk / ahb_div[a], sysclk / ahb_div[a] / apb_div[p], hse_list[h]
+                    };
+                    RCC_Config config;
+
+                    if (sysclk % ahb_div[a] != 0 || (sysclk / ahb_div[a]) % apb_div[p] != 0 ||
+                        !RCC_SolveConfig(&request, &config, NULL)) {
+                        continue;
+                    }
+                    solved++;
+                    CHECK(RCC_Init(&config));
+                    CHECK_CACHE();
+                    CHECK_EQ(RCC_GetPCLKFrequency(), request.pclk_hz);
+
+                    RCC_SetAPBPrescaler(APB_PRESCALER_1);
+                    CHECK_CACHE();
+                    RCC_SetAHBPrescaler(AHB_PRESCALER_1);
+                    CHECK_CACHE();
+                    CHECK_EQ(RCC_GetHCLKFrequency(), sysclk);
+                }
+            }
+        }
+    }
+    CHECK(solved > 100);
+}
+
+// A solved tree carries its HSE: no RCC_SetHSEFrequency() call needed for
+// the flash latency or the cache. Runs first, with the driver's HSE still at
+// RCC_HSE_DEFAULT.
+static void Test_SolvedHSE(void) {
+    static const RCC_ClockRequest requests[] = {
+        { 45000000UL, 0, 0, 25000000UL },   // PLL from HSE 25 MHz /5 x9
+        { 32000000UL, 0, 0, 32000000UL },   // HSE direct
+        { 20000000UL, 0, 0, 20000000UL },
+    };
+
+    for (uint32_t i = 0; i < sizeof(requests) / sizeof(requests[0]); i++) {
+        RCC_Config config;
+        uint8_t latency = 0xFF;
+
+        CHECK(RCC_SolveConfig(&requests[i], &config, &latency));
+        CHECK_EQ(latency, RCC_GetFlashLatency(requests[i].sysclk_hz));
+        CHECK(RCC_Init(&config));
+        test_hse_hz = requests[i].hse_hz;
+        CHECK_EQ(Sim_Read(FLASH_BASE, 0x0) & 0x7U, latency);
+        CHECK_EQ(RCC_GetSystemClockFrequency(), requests[i].sysclk_hz);
+        CHECK_CACHE();
+    }
+}
+
+// Individual setters: source switch, PLL reprogramming, HSE change
+static void Test_Setters(void) {
+    Test_SetHSE(8000000UL);
+    CHECK(RCC_EnableHSE());
+    CHECK(RCC_SetSystemClockSource(CLOCK_SOURCE_HSE));
+    CHECK_CACHE();
+    Test_SetHSE(16000000UL);            // Running from HSE: SYSCLK follows
+
+    CHECK(RCC_SetSystemClockSource(CLOCK_SOURCE_HSI));
+    CHECK_CACHE();
+    RCC_SetPLLConfig(PLL_SOURCE_HSI_DIV2, 10);
+    CHECK(RCC_EnablePLL());
+    CHECK(RCC_SetSystemClockSource(CLOCK_SOURCE_PLL));
+    CHECK_CACHE();
+    CHECK_EQ(RCC_GetSystemClockFrequency(), 40000000UL);
+
+    CHECK(RCC_SetSystemClockSource(CLOCK_SOURCE_HSI));
+    RCC_SetPLLConfig(PLL_SOURCE_HSE_DIV2, 4);
+    CHECK(RCC_SetSystemClockSource(CLOCK_SOURCE_PLL));
+    CHECK_CACHE();
+    CHECK_EQ(RCC_GetSystemClockFrequency(), 32000000UL);
+    CHECK(RCC_SetSystemClockSource(CLOCK_SOURCE_HSI));
+    CHECK_CACHE();
+}
+
+// Bring-up timeouts: HSE that never starts, PLL that never locks
+static void Test_Fallbacks(void) {
+    RCC_ClockRequest request = { 48000000UL, 0, 0, 12000000UL };
+    RCC_Config config;
+
+    Test_SetHSE(12000000UL);
+    CHECK(RCC_SolveConfig(&request, &config, NULL));
+    config.system_clock_source = CLOCK_SOURCE_PLL;  // Force the HSE-fed PLL
+    config.hse_enabled = true;
+    config.pll_source = PLL_SOURCE_HSE;
+    config.pll_multiplier = 4;
+
+    Sim_FailOscillator(RCC_CR_HSERDY);
+    CHECK(!RCC_Init(&config));
+    CHECK_CACHE();
+    CHECK_EQ(RCC_GetSystemClockFrequency(), 48000000UL);   // HSI/2 x 12
+
+    Sim_FailOscillator(RCC_CR_PLLRDY);
+    CHECK(!RCC_Init(&config));
+    CHECK_CACHE();
+    CHECK_EQ(RCC_GetSystemClockFrequency(), RCC_HSI_FREQUENCY);
+    Sim_FailOscillator(0);
+}
+
+// CSS: NMI parks on HSI, RCC_ServiceCSS applies the fallback
+static void Test_CSS(void) {
+    RCC_ClockRequest request = { 45000000UL, 0, 0, 25000000UL };
+    RCC_Config config;
+
+    Test_SetHSE(25000000UL);
+    CHECK(RCC_SolveConfig(&request, &config, NULL));
+    config.css_enabled = true;
+    CHECK(RCC_Init(&config));
+    CHECK_CACHE();
+
+    // What the hardware does on an HSE failure
+    RCC_CR &= ~(RCC_CR_HSEON | RCC_CR_PLLON);
+    RCC_CFGR &= ~3U;
+    RCC_CIR |= RCC_CIR_CSSF;
+    NMI_Handler();
+    RCC_CIR &= ~RCC_CIR_CSSF;
+    CHECK_CACHE();
+    CHECK_EQ(RCC_GetSystemClockFrequency(), RCC_HSI_FREQUENCY);
+
+    CHECK(RCC_ServiceCSS());
+    CHECK_CACHE();
+    CHECK_EQ(RCC_GetSystemClockFrequency(), 44000000UL);   // Rounded down, never up
+}
+
+// STOP: wake on HSI, restore the snapshot
+static void Test_Restore(void) {
+    RCC_ClockRequest request = { 48000000UL, 24000000UL, 12000000UL, 0 };
+    RCC_Config config;
+    RCC_Snapshot snapshot;
+
+    CHECK(RCC_SolveConfig(&request, &config, NULL));
+    CHECK(RCC_Init(&config));
+    RCC_SaveSnapshot(&snapshot);
+
+    RCC_CFGR &= ~3U;                    // Wake-up state: HSI, PLL and HSE off
+    RCC_CR &= ~(RCC_CR_PLLON | RCC_CR_HSEON);
+    *(volatile uint32_t *)(SYSTICK_BASE + 0x0) = 0;
+    RCC_RestoreBegin(&snapshot);
+    CHECK_EQ(Sim_Read(SYSTICK_BASE, 0x0) & 5U, 5U);   // Started to time it
+    CHECK(RCC_RestoreComplete());
+    CHECK_CACHE();
+    CHECK_EQ(RCC_GetPCLKFrequency(), 12000000UL);
+
+    Sim_FailOscillator(RCC_CR_PLLRDY);  // PLL lost: restore falls back to HSI
+    RCC_CFGR &= ~3U;
+    RCC_CR &= ~RCC_CR_PLLON;
+    RCC_RestoreBegin(&snapshot);
+    CHECK(!RCC_RestoreComplete());
+    CHECK_CACHE();
+    Sim_FailOscillator(0);
+
+    // Switch never completes: SW goes back to HSI before 0 WS
+    Sim_HoldClockSwitch(true);
+    RCC_CFGR &= ~3U;
+    RCC_CR &= ~RCC_CR_PLLON;
+    RCC_RestoreBegin(&snapshot);
+    CHECK(!RCC_RestoreComplete());
+    CHECK_EQ(RCC_CFGR & 0xFU, CLOCK_SOURCE_HSI);
+    CHECK_EQ(Sim_Read(FLASH_BASE, 0x0) & 0x7U, 0U);
+    CHECK_CACHE();
+    Sim_HoldClockSwitch(false);
+}
+
+int main(void) {
+    Sim_Reset();
+    test_hse_hz = RCC_HSE_DEFAULT;
+    CHECK_CACHE();
+
+    Test_SolvedHSE();
+    Test_InitAndPrescalers();
+    Test_Setters();
+    Test_Fallbacks();
+    Test_CSS();
+    Test_Restore();
+    return Test_Done("test_rcc_cache");
+}
@@ -0,0 +1,172 @@
+#include "sim_test.h"
+#include "gpio.h"
+#include "rcc.h"
+
+// Register models in Host_Sim/Src/sim_regs.c
+
+#define GPIO_ODR_OFFSET     0x14U
+#define RCC_CR_HSIRDY       (1U << 1)
+#define RCC_CR_HSEON        (1U << 16)
+#define RCC_CR_HSERDY       (1U << 17)
+#define RCC_CFGR_SW_HSE     0x1U
+#define RCC_CFGR_SWS_HSE    (0x1U << 2)
+
+// Reset state of the blocks the drivers depend on
+static void Test_Reset(void) {
+    Sim_Reset();
+    CHECK_EQ(Sim_Read(GPIOA_BASE, 0x00), 0x28000000UL);     // PA13/PA14 alternate (SWD)
+    CHECK_EQ(Sim_Read(GPIOA_BASE, 0x0C), 0x24000000UL);     // PA13 pull-up, PA14 pull-down
+    CHECK(RCC_CR & RCC_CR_HSIRDY);
+    CHECK(!(RCC_CR & RCC_CR_HSERDY));
+}
+
+// Ready bits follow their enables, SWS follows SW to a ready source
+static void Test_RccModel(void) {
+    Sim_Reset();
+    RCC_CFGR = (RCC_CFGR & ~0x3U) | RCC_CFGR_SW_HSE;
+    CHECK_EQ(RCC_CFGR & 0xCU, 0U);      // HSE not running: still on HSI
+    RCC_CR |= RCC_CR_HSEON;
+    CHECK(RCC_CR & RCC_CR_HSERDY);
+    CHECK_EQ(RCC_CFGR & 0xCU, RCC_CFGR_SWS_HSE);
+    RCC_CR &= ~RCC_CR_HSEON;
+    CHECK(!(RCC_CR & RCC_CR_HSERDY));
+    RCC_CFGR &= ~0x3U;
+}
+
+// Back-to-back stores through one cached pointer all reach the port
+static void Test_CachedPointer(void) {
+    GPIO_TypeDef *port;
+
+    if (!Sim_GpioStoresApplied()) {
+        printf("skipped: GPIO stores are not applied one by one on this host\n");
+        return;
+    }
+    Sim_Reset();
+    port = GPIOC;
+    port->MODER = 0x00050000UL;         // PC8, PC9 outputs
+    port->BSRR = 1U << 8;
+    port->BSRR = 1U << 9;
+    CHECK_EQ(port->ODR, 0x0300U);
+    CHECK_EQ(port->IDR & 0x0300U, 0x0300U);  // Read back without a base evaluation
+    CHECK_EQ(port->BSRR, 0U);
+
+    port->BRR = 1U << 8;
+    port->BSRR = (1U << (9 + 16)) | (1U << 8);
+    CHECK_EQ(port->ODR, 0x0100U);
+
+    port->BSRR = (1U << 8) | (1U << (8 + 16));  // Set wins over reset
+    CHECK_EQ(port->ODR, 0x0100U);
+}
+
+// Inputs show on IDR except where the pin drives an output
+static void Test_Inputs(void) {
+    Sim_Reset();
+    GPIOB->MODER = 0x00000001UL;        // PB0 output
+    Sim_SetInput(1, 0x0003U);
+    CHECK_EQ(GPIOB->IDR & 0x3U, 0x2U);
+    GPIOB->BSRR = 1U;
+    CHECK_EQ(GPIOB->IDR & 0x3U, 0x3U);
+    CHECK_EQ(Sim_Read(GPIOB_BASE, GPIO_ODR_OFFSET), 0x1U);
+}
+
+// GPIO_DeInitMask only resets pins the driver configured: SWD survives
+static void Test_DeInitUnclaimed(void) {
+    GPIO_Config config = {
+        .mode = GPIO_MODE_OUTPUT,
+        .output_type = GPIO_OUTPUT_PUSH_PULL,
+        .speed = GPIO_SPEED_LOW,
+        .pull = GPIO_PULL_UP,
+        .alternate = GPIO_AF0
+    };
+
+    Sim_Reset();
+    GPIO_InitMask(GPIOA, GPIO_PIN_MASK(GPIO_PIN_0), &config);
+    GPIO_DeInitMask(GPIOA, GPIO_PIN_MASK_ALL);
+    CHECK_EQ(Sim_Read(GPIOA_BASE, 0x00), 0x28000000UL);
+    CHECK_EQ(Sim_Read(GPIOA_BASE, 0x0C), 0x24000000UL);
+    CHECK_EQ(GPIO_GetPinsInUse(GPIOA), 0U);
+
+    // Nothing held: a second call touches nothing
+    GPIOA->MODER |= 1U;
+    GPIO_DeInitMask(GPIOA, GPIO_PIN_MASK(GPIO_PIN_0));
+    CHECK_EQ(Sim_Read(GPIOA_BASE, 0x00) & 0x3U, 1U);
+}
+
+// GPIO_EnableClock/GPIO_DisableClock share the pin refcount: a hand-clocked
+// port survives its last GPIO_DeInitMask, held pins survive GPIO_DisableClock
+static void Test_ClockHold(void) {
+    GPIO_Config config = {
+        .mode = GPIO_MODE_INPUT,
+        .output_type = GPIO_OUTPUT_PUSH_PULL,
+        .speed = GPIO_SPEED_LOW,
+        .pull = GPIO_NO_PULL,
+        .alternate = GPIO_AF0
+    };
+    uint32_t gpioc_en = 1U << 19;
+
+    Sim_Reset();
+    GPIO_EnableClock(GPIOC);
+    GPIO_InitMask(GPIOC, GPIO_PIN_MASK(GPIO_PIN_3), &config);
+    GPIO_DeInitMask(GPIOC, GPIO_PIN_MASK(GPIO_PIN_3));
+    CHECK(RCC_AHBENR & gpioc_en);
+    GPIO_DisableClock(GPIOC);
+    CHECK(!(RCC_AHBENR & gpioc_en));
+
+    GPIO_InitMask(GPIOC, GPIO_PIN_MASK(GPIO_PIN_3), &config);
+    GPIO_EnableClock(GPIOC);
+    GPIO_DisableClock(GPIOC);
+    CHECK(RCC_AHBENR & gpioc_en);
+    GPIO_DeInitMask(GPIOC, GPIO_PIN_MASK(GPIO_PIN_3));
+    CHECK(!(RCC_AHBENR & gpioc_en));
+}
+
+// Observer: flash latency must cover the SYSCLK SWS reports at every access
+static uint32_t test_latency_faults;
+
+static void Test_CheckLatency(void) {
+    uint32_t sysclk = RCC_GetSystemClockFrequency();
+
+    if ((Sim_Read(FLASH_BASE, 0x00) & 0x7U) < RCC_GetFlashLatency(sysclk)) {
+        test_latency_faults++;
+    }
+}
+
+// RCC_Init sets the wait states: raised before 32 MHz, lowered after 8 MHz
+static void Test_RccLatency(void) {
+    RCC_Config config = {
+        .system_clock_source = CLOCK_SOURCE_PLL,
+        .target_frequency = SYSTEM_CLOCK_32MHZ,
+        .pll_enabled = true,
+        .pll_source = PLL_SOURCE_HSI_DIV2,
+        .pll_multiplier = 8,
+        .ahb_prescaler = AHB_PRESCALER_1,
+        .apb_prescaler = APB_PRESCALER_1
+    };
+
+    Sim_Reset();
+    Sim_SetObserver(Test_CheckLatency);
+    RCC_Init(&config);
+    CHECK_EQ(RCC_GetSystemClockFrequency(), 32000000UL);
+    CHECK_EQ(Sim_Read(FLASH_BASE, 0x00) & 0x7U, 1U);
+
+    config.system_clock_source = CLOCK_SOURCE_HSI;
+    config.target_frequency = SYSTEM_CLOCK_8MHZ;
+    config.pll_enabled = false;
+    RCC_Init(&config);
+    CHECK_EQ(RCC_GetSystemClockFrequency(), 8000000UL);
+    CHECK_EQ(Sim_Read(FLASH_BASE, 0x00) & 0x7U, 0U);
+    CHECK_EQ(Sim_Read(FLASH_BASE, 0x00) & 0x30U, 0x30U);    // Prefetch kept
+    Sim_SetObserver(NULL);
+    CHECK_EQ(test_latency_faults, 0U);
+}
+
+int main(void) {
+    Test_Reset();
+    Test_RccModel();
+    Test_CachedPointer();
+    Test_Inputs();
+    Test_DeInitUnclaimed();
+    Test_ClockHold();
+    Test_RccLatency();
+    return Test_Done("test_sim_regs");
+}